@@ -9,11 +9,14 @@
 #include "mcp_manager.hpp"
 #include "memory.hpp"
 #include "memory_search.hpp"
+#include "thread_pool.hpp"
 #include <iostream>
+#include <iomanip>
 #include <thread>
 #include <chrono>
 #include <algorithm>
 #include <set>
+#include <mutex>
 
 namespace minidragon {
 
@@ -71,11 +74,35 @@ bool is_retryable_error(ProviderErrorKind kind) {
 Agent::Agent(const Config& config, ToolRegistry& tools)
     : config_(config)
     , tools_(tools)
-    , session_(config.workspace_path() + "/sessions")
-    , provider_chain_(config)
+    , sessions_dir_(config.workspace_path() + "/sessions")
+    , session_(sessions_dir_)
+    , provider_chain_(std::make_shared<ProviderChain>(config))
+    , tokenizer_(&tokenizer_for_model(config.model, config.tokenizer))
 {
+    register_config_hooks();
+}
+
+Agent::Agent(const Config& config, ToolRegistry& tools,
+             std::shared_ptr<ProviderChain> provider_chain,
+             const std::string& conversation_id)
+    : config_(config)
+    , tools_(tools)
+    , sessions_dir_(config.workspace_path() + "/sessions")
+    , session_(sessions_dir_, conversation_id)
+    , provider_chain_(std::move(provider_chain))
+    , tokenizer_(&tokenizer_for_model(config.model, config.tokenizer))
+{
+    register_config_hooks();
+}
+
+Agent::~Agent() {
+    compact_cancel_.cancel("conversation closed");
+    wait_background_compaction();
+}
+
+void Agent::register_config_hooks() {
     // Register configured hooks
-    for (auto& hc : config.hooks) {
+    for (auto& hc : config_.hooks) {
         HookEntry entry;
         entry.name = hc.type + ":" + hc.command;
         entry.type = parse_hook_type(hc.type);
@@ -85,6 +112,11 @@ Agent::Agent(const Config& config, ToolRegistry& tools)
     }
 }
 
+void Agent::set_model(const std::string& model) {
+    config_.model = model;
+    tokenizer_ = &tokenizer_for_model(model, config_.tokenizer);
+}
+
 void Agent::set_team(std::shared_ptr<TeamManager> team, const std::string& my_name) {
     team_ = std::move(team);
     my_name_ = my_name;
@@ -101,10 +133,14 @@ int Agent::effective_max_tool_output() const {
 }
 
 std::string Agent::build_system_prompt() {
-    // Cache: rebuild only every 60 seconds
+    // Cache: rebuild only every 60 seconds. In cache-aware mode keep it
+    // byte-stable until the history window moves instead: any edit (e.g. to
+    // today's memory file) would invalidate the whole provider prompt cache.
     int64_t now = epoch_now();
-    if (!cached_system_prompt_.empty() && (now - system_prompt_built_at_) < 60) {
-        return cached_system_prompt_;
+    if (!cached_system_prompt_.empty()) {
+        bool fresh = config_.prune_cache_aware ? system_prompt_epoch_ == history_epoch_
+                                               : (now - system_prompt_built_at_) < 60;
+        if (fresh) return cached_system_prompt_;
     }
 
     std::string ws = config_.workspace_path();
@@ -182,9 +218,61 @@ std::string Agent::build_system_prompt() {
 
     cached_system_prompt_ = prompt;
     system_prompt_built_at_ = now;
+    system_prompt_epoch_ = history_epoch_;
     return prompt;
 }
 
+// Today's recent history. The plain window slides one message per turn;
+// in cache-aware mode it starts on a multiple of prune_block, so its head
+// (and everything after it) shifts only once per block.
+std::vector<Message> Agent::load_history() {
+    if (!config_.prune_cache_aware) return session_.load_recent(config_.context_window);
+
+    int total = session_.count();
+    int block = std::clamp(config_.prune_block, 1, std::max(1, config_.context_window));
+    int start = 0;
+    if (total > config_.context_window) {
+        start = (total - config_.context_window + block - 1) / block * block;
+    }
+    history_epoch_ = today_str() + ":" + std::to_string(start);
+    return session_.load_recent(total - start);
+}
+
+// Largest block start <= index (index 0 is the system prompt)
+int Agent::block_boundary(int index) const {
+    if (index <= 1) return index;
+    return 1 + (index - 1) / config_.prune_block * config_.prune_block;
+}
+
+// Tokens of this request that repeat the previous request's prefix, i.e.
+// what an upstream prompt/KV prefix cache can reuse. Tools come first in
+// the prompt, so a tool change makes nothing reusable.
+int Agent::track_prefix(const std::vector<Message>& messages, uint64_t tools_version, int tool_spec_tokens) {
+    std::hash<std::string> h;
+    std::vector<size_t> sigs;
+    sigs.reserve(messages.size());
+
+    bool matching = !last_request_sigs_.empty() && tools_version != 0 && tools_version == last_tools_version_;
+    int prompt = tool_spec_tokens;
+    int cacheable = matching ? tool_spec_tokens : 0;
+    for (size_t i = 0; i < messages.size(); i++) {
+        sigs.push_back(h(messages[i].json_fragment()));
+        int tokens = estimate_tokens(messages[i], *tokenizer_);
+        prompt += tokens;
+        matching = matching && i < last_request_sigs_.size() && last_request_sigs_[i] == sigs[i];
+        if (matching) cacheable += tokens;
+    }
+
+    last_request_sigs_ = std::move(sigs);
+    last_tools_version_ = tools_version;
+    prefix_stats_.requests++;
+    prefix_stats_.prompt_tokens += prompt;
+    prefix_stats_.cacheable_tokens += cacheable;
+    prefix_stats_.last_prompt_tokens = prompt;
+    prefix_stats_.last_cacheable_tokens = cacheable;
+    return cacheable;
+}
+
 // ── Truncate at line boundary ──────────────────────────────────────────
 
 std::string Agent::truncate_at_boundary(const std::string& text, int max_chars) const {
@@ -218,19 +306,13 @@ std::string Agent::truncate_at_boundary(const std::string& text, int max_chars)
 // ── Context-aware pruning (openclaw-compatible) ────────────────────────
 
 void Agent::prune_context(std::vector<Message>& messages) {
-    int context_chars = config_.context_tokens * 4; // approximate char budget
-    int soft_threshold = static_cast<int>(context_chars * config_.prune_soft_ratio);
-    int hard_threshold = static_cast<int>(context_chars * config_.prune_hard_ratio);
+    int soft_threshold = static_cast<int>(config_.context_tokens * config_.prune_soft_ratio);
+    int hard_threshold = static_cast<int>(config_.context_tokens * config_.prune_hard_ratio);
 
-    // Calculate total context size
-    int total_chars = 0;
-    for (auto& m : messages) {
-        total_chars += static_cast<int>(m.content.size());
-        for (auto& tc : m.tool_calls)
-            total_chars += static_cast<int>(tc.arguments.size());
-    }
+    // Calculate total context size (per-message counts are cached)
+    int total_tokens = estimate_tokens(messages, *tokenizer_);
 
-    if (total_chars < soft_threshold) return;
+    if (total_tokens < soft_threshold) return;
 
     // Find the index of the last N assistant messages to protect
     int protect_from = static_cast<int>(messages.size());
@@ -245,20 +327,46 @@ void Agent::prune_context(std::vector<Message>& messages) {
         }
     }
 
+    // Cache-aware: prune only up to a block boundary and treat every message
+    // before it alike (no early exit), so the rewritten prefix is the same on
+    // each request and changes only when the boundary advances a whole block
+    if (config_.prune_cache_aware) {
+        protect_from = block_boundary(protect_from);
+        for (int i = 1; i < protect_from; i++) {
+            if (messages[i].role != "tool") continue;
+            if (static_cast<int>(messages[i].content.size()) <=
+                config_.prune_head_chars + config_.prune_tail_chars + 100) continue;
+            int old_tokens = estimate_tokens(messages[i], *tokenizer_);
+            messages[i].content = truncate_at_boundary(messages[i].content,
+                                                        config_.prune_head_chars + config_.prune_tail_chars);
+            messages[i].touch();
+            total_tokens += estimate_tokens(messages[i], *tokenizer_) - old_tokens;
+        }
+        if (total_tokens < hard_threshold) return;
+        for (int i = 1; i < protect_from; i++) {
+            if (messages[i].role != "tool" || messages[i].content.size() <= 100) continue;
+            messages[i].content = "[tool result cleared: " +
+                std::to_string(messages[i].content.size()) + " chars]";
+            messages[i].touch();
+        }
+        return;
+    }
+
     // Phase 1: Soft trim — keep head+tail of old large tool results
     for (int i = 0; i < protect_from; i++) {
         if (messages[i].role != "tool") continue;
         int sz = static_cast<int>(messages[i].content.size());
         if (sz <= config_.prune_head_chars + config_.prune_tail_chars + 100) continue;
 
-        int old_sz = static_cast<int>(messages[i].content.size());
+        int old_tokens = estimate_tokens(messages[i], *tokenizer_);
         messages[i].content = truncate_at_boundary(messages[i].content,
                                                     config_.prune_head_chars + config_.prune_tail_chars);
-        total_chars += static_cast<int>(messages[i].content.size()) - old_sz;
-        if (total_chars < soft_threshold) return;
+        messages[i].touch();
+        total_tokens += estimate_tokens(messages[i], *tokenizer_) - old_tokens;
+        if (total_tokens < soft_threshold) return;
     }
 
-    if (total_chars < hard_threshold) return;
+    if (total_tokens < hard_threshold) return;
 
     // Phase 2: Hard clear — replace old tool results with placeholder
     for (int i = 0; i < protect_from; i++) {
@@ -266,6 +374,7 @@ void Agent::prune_context(std::vector<Message>& messages) {
         if (messages[i].content.size() <= 100) continue;
         messages[i].content = "[tool result cleared: " +
             std::to_string(messages[i].content.size()) + " chars]";
+        messages[i].touch();
     }
 }
 
@@ -300,12 +409,13 @@ void Agent::repair_tool_pairing(std::vector<Message>& messages) {
     }
     for (auto& m : messages) {
         if (m.role == "assistant" && !m.tool_calls.empty()) {
-            m.tool_calls.erase(
-                std::remove_if(m.tool_calls.begin(), m.tool_calls.end(), [&](const ToolCall& tc) {
-                    return !tc.id.empty() && result_ids.find(tc.id) == result_ids.end();
-                }),
-                m.tool_calls.end()
-            );
+            auto kept_end = std::remove_if(m.tool_calls.begin(), m.tool_calls.end(), [&](const ToolCall& tc) {
+                return !tc.id.empty() && result_ids.find(tc.id) == result_ids.end();
+            });
+            if (kept_end != m.tool_calls.end()) {
+                m.tool_calls.erase(kept_end, m.tool_calls.end());
+                m.touch();
+            }
         }
     }
 }
@@ -344,7 +454,7 @@ static std::string build_structural_summary(const std::vector<Message>& messages
 bool Agent::try_auto_compact(std::vector<Message>& messages) {
     if (!config_.auto_compact) return false;
 
-    int total_tokens = estimate_tokens(messages);
+    int total_tokens = estimate_tokens(messages, *tokenizer_);
     int budget = config_.context_tokens - config_.compact_reserve_tokens;
     if (total_tokens < budget) return false;
 
@@ -352,51 +462,61 @@ bool Agent::try_auto_compact(std::vector<Message>& messages) {
     int keep_count = config_.prune_keep_recent * 3; // keep last ~9 messages
     if (keep_count >= static_cast<int>(messages.size())) return false;
 
-    int compact_end = static_cast<int>(messages.size()) - keep_count;
-    if (compact_end <= 1) return false; // nothing to compact (just system)
-
-    // Fire pre_compaction hook
-    if (hooks_.has_hooks(HookType::pre_compaction)) {
-        nlohmann::json hook_data;
-        hook_data["message_count"] = compact_end - 1;
-        hook_data["total_tokens"] = total_tokens;
-        hooks_.run(HookType::pre_compaction, std::move(hook_data));
+    // A summary prepared in the background is swapped in without a model call.
+    // It may cover only an old part of the history; compact the rest as
+    // usual if that is not enough.
+    bool swapped = swap_in_summary(messages);
+    if (swapped) {
+        total_tokens = estimate_tokens(messages, *tokenizer_);
+        if (total_tokens < budget || keep_count >= static_cast<int>(messages.size())) return true;
     }
 
-    // Build conversation text for summarization
-    std::string conv_text = build_structural_summary(messages, 1, compact_end);
-    int chars_to_summarize = 0;
-    for (int i = 1; i < compact_end; i++)
-        chars_to_summarize += static_cast<int>(messages[i].content.size());
+    int compact_end = static_cast<int>(messages.size()) - keep_count;
+    if (config_.prune_cache_aware) compact_end = block_boundary(compact_end);
+    if (compact_end <= 1) return swapped; // nothing to compact (just system)
+
+    // Cache-aware: compacting the same span again reuses its summary, so
+    // the compacted prefix stays byte-identical from request to request
+    size_t span_sig = 0;
+    if (config_.prune_cache_aware) {
+        std::hash<std::string> h;
+        for (int i = 1; i < compact_end; i++) span_sig = span_sig * 31 + h(messages[i].json_fragment());
+    }
 
     std::string compacted;
+    if (config_.prune_cache_aware && !compacted_summary_.empty() && span_sig == compacted_span_sig_) {
+        compacted = compacted_summary_;
+    } else {
+        // Fire pre_compaction hook
+        if (hooks_.has_hooks(HookType::pre_compaction)) {
+            nlohmann::json hook_data;
+            hook_data["message_count"] = compact_end - 1;
+            hook_data["total_tokens"] = total_tokens;
+            hooks_.run(HookType::pre_compaction, std::move(hook_data));
+        }
 
-    // Try LLM-based summarization
-    try {
-        std::vector<Message> compact_msgs;
-        Message sys;
-        sys.role = "system";
-        sys.content = "Summarize the following conversation concisely. "
-                      "Preserve key decisions, file paths, code changes, and action items. "
-                      "Keep the summary under 2000 chars.";
-        compact_msgs.push_back(sys);
-
-        Message user;
-        user.role = "user";
-        user.content = conv_text;
-        compact_msgs.push_back(user);
-
-        nlohmann::json no_tools = nlohmann::json::array();
-        auto resp = provider_chain_.chat(compact_msgs, no_tools,
-                                          config_.model, 1024, 0.3);
-
-        compacted = "[Compacted: " + std::to_string(compact_end - 1) +
-                    " messages → LLM summary]\n" + resp.content;
-    } catch (...) {
-        // Fallback to structural summary
-        compacted = "[Compacted conversation summary (" +
-            std::to_string(compact_end - 1) + " messages, ~" +
-            std::to_string(chars_to_summarize / 4) + " tokens)]\n" + conv_text;
+        // Build conversation text for summarization
+        std::string conv_text = build_structural_summary(messages, 1, compact_end);
+        int chars_to_summarize = 0;
+        for (int i = 1; i < compact_end; i++)
+            chars_to_summarize += static_cast<int>(messages[i].content.size());
+
+        // Try LLM-based summarization
+        try {
+            compacted = "[Compacted: " + std::to_string(compact_end - 1) +
+                        " messages → LLM summary]\n" +
+                        summarize(conv_text, config_.compact_model.empty() ? config_.model : config_.compact_model);
+        } catch (...) {
+            // Fallback to structural summary
+            compacted = "[Compacted conversation summary (" +
+                std::to_string(compact_end - 1) + " messages, ~" +
+                std::to_string(chars_to_summarize / 4) + " tokens)]\n" + conv_text;
+        }
+
+        if (config_.prune_cache_aware) {
+            compacted_span_sig_ = span_sig;
+            compacted_summary_ = compacted;
+        }
     }
 
     // Replace old messages with compaction summary
@@ -419,6 +539,131 @@ bool Agent::try_auto_compact(std::vector<Message>& messages) {
     return true;
 }
 
+// LLM summary of conversation text; throws on provider errors
+std::string Agent::summarize(const std::string& conv_text, const std::string& model, CancelToken* cancel) {
+    std::vector<Message> compact_msgs;
+    Message sys;
+    sys.role = "system";
+    sys.content = "Summarize the following conversation concisely. "
+                  "Preserve key decisions, file paths, code changes, and action items. "
+                  "Keep the summary under 2000 chars.";
+    compact_msgs.push_back(sys);
+
+    Message user;
+    user.role = "user";
+    user.content = conv_text;
+    compact_msgs.push_back(user);
+
+    nlohmann::json no_tools = nlohmann::json::array();
+    ChatOptions opts;
+    opts.cancel = cancel;
+    auto resp = provider_chain_->chat(compact_msgs, no_tools, model, 1024, 0.3, opts);
+    return resp.content;
+}
+
+// ── Background compaction ──────────────────────────────────────────────
+
+// Today's persisted rolling summary, once per day
+void Agent::load_summary() {
+    if (!config_.compact_background) return;
+    std::string day = today_str();
+    std::lock_guard<std::mutex> lock(summary_mutex_);
+    if (summary_day_ == day) return;
+    summary_ = session_.load_summary();
+    summary_day_ = day;
+}
+
+// Past the watermark, summarize the loaded messages the rolling summary does
+// not cover yet (minus the recent ones that always stay verbatim) on a
+// worker thread. The result is folded into the summary and persisted, ready
+// for try_auto_compact() to swap in when the hard threshold is reached.
+void Agent::start_background_compaction(const std::vector<Message>& messages) {
+    if (!config_.compact_background || !config_.auto_compact || compact_busy_) return;
+    int budget = config_.context_tokens - config_.compact_reserve_tokens;
+    if (estimate_tokens(messages, *tokenizer_) < budget * config_.compact_watermark) return;
+
+    SessionSummary prev;
+    std::string day;
+    {
+        std::lock_guard<std::mutex> lock(summary_mutex_);
+        prev = summary_;
+        day = summary_day_;
+    }
+
+    int keep_count = config_.prune_keep_recent * 3;
+    int span_end = static_cast<int>(messages.size()) - keep_count;
+    std::vector<Message> span;
+    int64_t upto = 0;
+    for (int i = 1; i < span_end; i++) {
+        if (messages[i].seq == 0 || messages[i].seq <= prev.upto_seq) continue;
+        span.push_back(messages[i]);
+        upto = messages[i].seq;
+    }
+    if (span.empty()) return;
+
+    std::string conv_text;
+    if (!prev.text.empty()) conv_text = "Summary of the conversation so far:\n" + prev.text + "\n\nContinued:\n";
+    conv_text += build_structural_summary(span, 0, static_cast<int>(span.size()));
+
+    // The model is captured here: /model may change config_.model meanwhile
+    std::string model = config_.compact_model.empty() ? config_.model : config_.compact_model;
+
+    wait_background_compaction();  // previous job has finished; reap it
+    compact_busy_ = true;
+    compact_thread_ = std::thread([this, conv_text = std::move(conv_text), model = std::move(model), upto, day] {
+        try {
+            SessionSummary next;
+            next.upto_seq = upto;
+            next.text = summarize(conv_text, model, &compact_cancel_);
+            session_.save_summary(next, day);
+            std::lock_guard<std::mutex> lock(summary_mutex_);
+            if (summary_day_ == day) summary_ = std::move(next);
+        } catch (const std::exception& e) {
+            std::cerr << "[compact] Background summary failed: " << e.what() << "\n";
+        }
+        compact_busy_ = false;
+    });
+}
+
+// Replace the messages the rolling summary covers with the summary itself
+bool Agent::swap_in_summary(std::vector<Message>& messages) {
+    if (!config_.compact_background) return false;
+    SessionSummary summary;
+    {
+        std::lock_guard<std::mutex> lock(summary_mutex_);
+        summary = summary_;
+    }
+    if (summary.upto_seq == 0) return false;
+
+    auto covered = [&](const Message& m) { return m.seq != 0 && m.seq <= summary.upto_seq; };
+    auto first = std::find_if(messages.begin() + 1, messages.end(), covered);
+    if (first == messages.end()) return false;
+    size_t at = static_cast<size_t>(first - messages.begin());
+    messages.erase(std::remove_if(first, messages.end(), covered), messages.end());
+
+    Message compaction_msg;
+    compaction_msg.role = "user";
+    compaction_msg.content = "[Compacted: earlier conversation → LLM summary]\n" + summary.text;
+    messages.insert(messages.begin() + at, std::move(compaction_msg));
+    repair_tool_pairing(messages);
+
+    hooks_.fire(HookType::post_compaction, {{"compacted_size", summary.text.size()}});
+    return true;
+}
+
+// /new: drop today's history and everything derived from it
+void Agent::reset_session() {
+    wait_background_compaction();  // a late summary must not outlive the reset
+    session_.reset();
+    cached_system_prompt_.clear();
+    std::lock_guard<std::mutex> lock(summary_mutex_);
+    summary_ = SessionSummary{};
+}
+
+void Agent::wait_background_compaction() {
+    if (compact_thread_.joinable()) compact_thread_.join();
+}
+
 void Agent::inject_inbox_messages(std::vector<Message>& messages) {
     if (!team_ || !team_->team_exists()) return;
 
@@ -458,15 +703,32 @@ void Agent::inject_inbox_messages(std::vector<Message>& messages) {
 
 // ── Main agent run loop ────────────────────────────────────────────────
 
-std::string Agent::run(const std::string& user_message) {
+std::string Agent::run(const std::string& user_message, const RunOptions& opts) {
+    return run_loop(user_message, nullptr, opts);
+}
+
+std::string Agent::run_stream(const std::string& user_message, const AgentEventSink& sink,
+                              const RunOptions& opts) {
+    std::string reply = run_loop(user_message, &sink, opts);
+    AgentEvent ev;
+    ev.kind = AgentEvent::Kind::final;
+    ev.text = reply;
+    sink(ev);
+    return reply;
+}
+
+std::string Agent::run_loop(const std::string& user_message, const AgentEventSink* sink,
+                             const RunOptions& opts) {
     std::vector<Message> messages;
 
+    auto recent = load_history();  // first: the system prompt may be keyed on it
+    load_summary();
+
     Message sys;
     sys.role = "system";
     sys.content = build_system_prompt();
     messages.push_back(sys);
 
-    auto recent = session_.load_recent(config_.context_window);
     for (auto& m : recent) {
         messages.push_back(m);
     }
@@ -489,25 +751,37 @@ std::string Agent::run(const std::string& user_message) {
     repair_tool_pairing(messages);
     try_auto_compact(messages);
 
+    // The caller's token, or a private one when only a deadline applies
+    CancelToken own_cancel;
+    CancelToken* cancel = opts.cancel ? opts.cancel : &own_cancel;
+    int timeout = opts.timeout > 0 ? opts.timeout : config_.run_timeout;
+    std::unique_ptr<CancelDeadline> deadline;
+    if (timeout > 0) deadline = std::make_unique<CancelDeadline>(*cancel, std::chrono::seconds(timeout));
+
+    ChatOptions chat_opts;
+    chat_opts.tools_version = tools_.version();  // read first: never newer than the spec
+    chat_opts.bypass_cache = opts.bypass_cache;
+    chat_opts.cancel = cancel;
     auto tools_spec = tools_.tools_spec();
-    int tool_spec_tokens = estimate_tokens(tools_spec.dump());
+    int tool_spec_tokens = estimate_tokens(tools_spec.dump(), *tokenizer_);
 
     int iterations = 0;
     int max_iter = config_.max_iterations;
     int max_output = effective_max_tool_output();
 
     while (iterations < max_iter) {
+        if (cancel->cancelled()) return "[cancelled] Run aborted: " + cancel->reason();
         inject_inbox_messages(messages);
         iterations++;
 
         // Pre-flight token check
-        int msg_tokens = estimate_tokens(messages) + tool_spec_tokens;
+        int msg_tokens = estimate_tokens(messages, *tokenizer_) + tool_spec_tokens;
         if (msg_tokens > config_.context_tokens - config_.max_tokens) {
             // Try compaction before giving up
             if (try_auto_compact(messages)) {
                 prune_context(messages);
                 repair_tool_pairing(messages);
-                msg_tokens = estimate_tokens(messages) + tool_spec_tokens;
+                msg_tokens = estimate_tokens(messages, *tokenizer_) + tool_spec_tokens;
             }
             if (msg_tokens > config_.context_tokens - config_.max_tokens) {
                 // Still too big - aggressive pruning
@@ -515,12 +789,18 @@ std::string Agent::run(const std::string& user_message) {
             }
         }
 
+        start_background_compaction(messages);
+
+        int cacheable_tokens = track_prefix(messages, chat_opts.tools_version, tool_spec_tokens);
+
         // pre_api_call hook
         if (hooks_.has_hooks(HookType::pre_api_call)) {
             nlohmann::json api_data;
             api_data["message_count"] = messages.size();
+            api_data["prompt_tokens"] = prefix_stats_.last_prompt_tokens;
+            api_data["cacheable_prefix_tokens"] = cacheable_tokens;
             api_data["model"] = config_.model;
-            api_data["provider"] = provider_chain_.active_provider_name();
+            api_data["provider"] = provider_chain_->active_provider_name();
             hooks_.run(HookType::pre_api_call, std::move(api_data));
         }
 
@@ -528,22 +808,41 @@ std::string Agent::run(const std::string& user_message) {
         bool success = false;
         std::string last_error;
 
+        bool streamed = false;  // tokens already reached the sink; retry would duplicate them
+
         for (int retry = 0; retry <= config_.max_retries; retry++) {
             try {
-                resp = provider_chain_.chat(messages, tools_spec,
-                                             config_.model,
-                                             config_.max_tokens,
-                                             config_.temperature);
+                if (sink) {
+                    resp = provider_chain_->chat_stream(messages, tools_spec,
+                                                        config_.model,
+                                                        config_.max_tokens,
+                                                        config_.temperature,
+                        [&](const std::string& token, bool done) {
+                            if (done || token.empty()) return;
+                            streamed = true;
+                            AgentEvent ev;
+                            ev.kind = AgentEvent::Kind::token;
+                            ev.text = token;
+                            (*sink)(ev);
+                        }, chat_opts);
+                } else {
+                    resp = provider_chain_->chat(messages, tools_spec,
+                                                 config_.model,
+                                                 config_.max_tokens,
+                                                 config_.temperature,
+                                                 chat_opts);
+                }
                 success = true;
                 break;
             } catch (const std::exception& e) {
                 last_error = e.what();
+                if (streamed || cancel->cancelled()) break;
                 auto kind = classify_provider_error(last_error);
 
                 // post_provider_error hook
                 hooks_.fire(HookType::post_provider_error, {
                     {"error", last_error},
-                    {"provider", provider_chain_.active_provider_name()},
+                    {"provider", provider_chain_->active_provider_name()},
                     {"retry", retry}
                 });
 
@@ -561,11 +860,12 @@ std::string Agent::run(const std::string& user_message) {
 
                 // Exponential backoff: 1s, 2s, 4s
                 int delay_ms = 1000 * (1 << retry);
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+                if (cancel->wait_for(std::chrono::milliseconds(delay_ms))) break;
             }
         }
 
         if (!success) {
+            if (cancel->cancelled()) return "[cancelled] Run aborted: " + cancel->reason();
             return std::string("[error] Provider call failed: ") + last_error;
         }
 
@@ -574,7 +874,7 @@ std::string Agent::run(const std::string& user_message) {
             nlohmann::json resp_data;
             resp_data["content_length"] = resp.content.size();
             resp_data["tool_call_count"] = resp.tool_calls.size();
-            resp_data["provider"] = provider_chain_.active_provider_name();
+            resp_data["provider"] = provider_chain_->active_provider_name();
             hooks_.run(HookType::post_api_call, std::move(resp_data));
         }
 
@@ -598,32 +898,74 @@ std::string Agent::run(const std::string& user_message) {
         messages.push_back(assistant);
         session_.log(assistant);
 
-        for (auto& tc : resp.tool_calls) {
-            // pre_tool_call hook
-            std::string tool_name = tc.name;
-            std::string tool_args = tc.arguments;
-            if (hooks_.has_hooks(HookType::pre_tool_call)) {
+        // Independent calls of one turn run concurrently; serial tools act as
+        // barriers. Results are appended in the original call order.
+        std::mutex sink_mutex;
+        auto emit = [&](const AgentEvent& ev) {
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            (*sink)(ev);
+        };
+
+        // pre_tool_call hooks run first, in call order, so batching below
+        // sees the tool each call will actually run
+        struct PreparedCall {
+            std::string name;
+            std::string args;
+            std::string error;  // the hook failed; reported instead of running the call
+        };
+        const auto& calls = resp.tool_calls;
+        std::vector<PreparedCall> prepared(calls.size());
+        for (size_t i = 0; i < calls.size(); i++) {
+            auto& pc = prepared[i];
+            pc.name = calls[i].name;
+            pc.args = calls[i].arguments;
+            if (!hooks_.has_hooks(HookType::pre_tool_call)) continue;
+            try {
                 auto modified = hooks_.run(HookType::pre_tool_call, {
-                    {"name", tc.name}, {"arguments", tc.arguments}
+                    {"name", calls[i].name}, {"arguments", calls[i].arguments}
                 });
-                if (modified.contains("name")) tool_name = modified["name"].get<std::string>();
-                if (modified.contains("arguments")) tool_args = modified["arguments"].get<std::string>();
+                if (modified.contains("name")) pc.name = modified["name"].get<std::string>();
+                if (modified.contains("arguments")) pc.args = modified["arguments"].get<std::string>();
+            } catch (const std::exception& e) {
+                pc.error = std::string("[error] pre_tool_call hook: ") + e.what();
             }
+        }
 
-            std::string result;
-            try {
-                auto args = tool_args.empty() ? nlohmann::json::object() : nlohmann::json::parse(tool_args);
-                result = tools_.execute(tool_name, args);
-            } catch (const std::exception& e) {
-                result = std::string("[error] ") + e.what();
+        auto run_tool_call = [&](const ToolCall& tc, const PreparedCall& pc) -> std::string {
+            const std::string& tool_name = pc.name;
+            const std::string& tool_args = pc.args;
+
+            if (sink) {
+                AgentEvent ev;
+                ev.kind = AgentEvent::Kind::tool_start;
+                ev.tool_name = tool_name;
+                ev.tool_call_id = tc.id;
+                ev.text = tool_args;
+                emit(ev);
+            }
+
+            // Every call still gets a result so the history stays paired
+            std::string result = pc.error;
+            if (result.empty()) {
+                try {
+                    if (cancel->cancelled()) throw std::runtime_error("Run aborted: " + cancel->reason());
+                    auto args = tool_args.empty() ? nlohmann::json::object() : nlohmann::json::parse(tool_args);
+                    result = tools_.execute(tool_name, args, ToolContext{cancel, session_.conversation()});
+                } catch (const std::exception& e) {
+                    result = std::string("[error] ") + e.what();
+                }
             }
 
             // post_tool_call hook
             if (hooks_.has_hooks(HookType::post_tool_call)) {
-                auto modified = hooks_.run(HookType::post_tool_call, {
-                    {"name", tool_name}, {"result", result}
-                });
-                if (modified.contains("result")) result = modified["result"].get<std::string>();
+                try {
+                    auto modified = hooks_.run(HookType::post_tool_call, {
+                        {"name", tool_name}, {"result", result}
+                    });
+                    if (modified.contains("result")) result = modified["result"].get<std::string>();
+                } catch (const std::exception& e) {
+                    std::cerr << "[agent] post_tool_call hook failed: " << e.what() << "\n";
+                }
             }
 
             // Truncate at line boundary
@@ -631,10 +973,35 @@ std::string Agent::run(const std::string& user_message) {
                 result = truncate_at_boundary(result, max_output);
             }
 
+            if (sink) {
+                AgentEvent ev;
+                ev.kind = AgentEvent::Kind::tool_end;
+                ev.tool_name = tool_name;
+                ev.tool_call_id = tc.id;
+                ev.text = result.size() > 2000 ? result.substr(0, 2000) + "...[truncated]" : result;
+                emit(ev);
+            }
+            return result;
+        };
+
+        std::vector<std::string> results(calls.size());
+        size_t batch_start = 0;
+        while (batch_start < calls.size()) {
+            size_t batch_end = batch_start;
+            while (batch_end < calls.size() && tools_.parallel_safe(prepared[batch_end].name)) batch_end++;
+            if (batch_end == batch_start) batch_end++;  // serial (or unknown) tool runs alone
+
+            parallel_for(batch_end - batch_start, config_.tool_parallelism, [&](size_t i) {
+                results[batch_start + i] = run_tool_call(calls[batch_start + i], prepared[batch_start + i]);
+            });
+            batch_start = batch_end;
+        }
+
+        for (size_t i = 0; i < calls.size(); i++) {
             Message tool_msg;
             tool_msg.role = "tool";
-            tool_msg.tool_call_id = tc.id;
-            tool_msg.content = result;
+            tool_msg.tool_call_id = calls[i].id;
+            tool_msg.content = std::move(results[i]);
             messages.push_back(tool_msg);
             session_.log(tool_msg);
         }
@@ -683,13 +1050,7 @@ void Agent::interactive_loop(bool no_markdown, bool logs) {
 
         // Chat commands (openclaw-compatible)
         if (line == "/new" || line == "/reset") {
-            std::string ws = config_.workspace_path();
-            std::string session_file = ws + "/sessions/" + today_str() + ".jsonl";
-            if (fs::exists(session_file)) {
-                fs::remove(session_file);
-            }
-            session_ = SessionLogger(ws + "/sessions");
-            cached_system_prompt_.clear();
+            reset_session();
             std::cout << "Session reset. Starting fresh.\n";
             continue;
         }
@@ -697,27 +1058,23 @@ void Agent::interactive_loop(bool no_markdown, bool logs) {
             std::string new_model = line.substr(5);
             while (!new_model.empty() && new_model[0] == ' ') new_model.erase(0, 1);
             if (!new_model.empty()) {
-                config_.model = new_model;
+                set_model(new_model);
                 std::cout << "Switched to model: " << new_model << "\n";
             }
-            std::string ws = config_.workspace_path();
-            std::string session_file = ws + "/sessions/" + today_str() + ".jsonl";
-            if (fs::exists(session_file)) fs::remove(session_file);
-            session_ = SessionLogger(ws + "/sessions");
-            cached_system_prompt_.clear();
+            reset_session();
             std::cout << "Session reset.\n";
             continue;
         }
         if (line == "/status") {
-            auto recent = session_.load_recent(config_.context_window);
-            int session_tokens = estimate_tokens(recent);
-            int system_tokens = estimate_tokens(build_system_prompt());
-            int tools_tokens = estimate_tokens(tools_.tools_spec().dump());
+            auto recent = load_history();
+            int session_tokens = estimate_tokens(recent, *tokenizer_);
+            int system_tokens = estimate_tokens(build_system_prompt(), *tokenizer_);
+            int tools_tokens = estimate_tokens(tools_.tools_spec().dump(), *tokenizer_);
             int total = session_tokens + system_tokens + tools_tokens;
 
             std::cout << "Model    : " << config_.model << "\n"
-                      << "Provider : " << provider_chain_.active_provider_name()
-                      << " (" << provider_chain_.provider_count() << " configured";
+                      << "Provider : " << provider_chain_->active_provider_name()
+                      << " (" << provider_chain_->provider_count() << " configured";
             if (config_.fallback.enabled) std::cout << ", fallback ON";
             std::cout << ")\n"
                       << "Tokens   : " << config_.max_tokens << " (output)\n"
@@ -728,24 +1085,71 @@ void Agent::interactive_loop(bool no_markdown, bool logs) {
                       << "  System : ~" << system_tokens << " tokens\n"
                       << "  Tools  : ~" << tools_tokens << " tokens (" << tools_.tool_names().size() << " tools)\n"
                       << "  History: ~" << session_tokens << " tokens (" << recent.size() << " messages)\n"
+                      << "Tokenizer: " << tokenizer_->name() << "\n"
                       << "Retries  : " << config_.max_retries << "\n"
-                      << "Compact  : " << (config_.auto_compact ? "auto (LLM)" : "manual") << "\n"
+                      << "Compact  : " << (!config_.auto_compact ? "manual"
+                                           : config_.compact_background ? "auto (LLM, background)"
+                                                                        : "auto (LLM)") << "\n"
                       << "Hooks    : " << hooks_.hook_count() << " registered\n"
                       << "Embedding: " << (config_.embedding.enabled ? "enabled" : "disabled") << "\n";
+            if (auto* cache = provider_chain_->embedding_cache()) {
+                auto cs = cache->stats();
+                std::cout << "EmbCache : hits=" << (cs.memory_hits + cs.disk_hits)
+                          << " (memory " << cs.memory_hits << ", disk " << cs.disk_hits << ")"
+                          << " misses=" << cs.misses
+                          << " hit rate " << static_cast<int>(cs.hit_rate() * 100) << "%\n";
+            }
+            if (auto* batcher = provider_chain_->embed_batcher()) {
+                auto bs = batcher->stats();
+                std::cout << "EmbBatch : " << bs.batches << " calls, " << bs.texts << " texts, avg "
+                          << std::fixed << std::setprecision(1) << bs.average() << std::defaultfloat
+                          << " max " << bs.largest << " [1:" << bs.size_hist[0] << " 2-4:" << bs.size_hist[1]
+                          << " 5-16:" << bs.size_hist[2] << " 17+:" << bs.size_hist[3] << "]\n";
+            }
+            if (prefix_stats_.requests > 0) {
+                std::cout << "Prefix   : ~" << prefix_stats_.last_cacheable_tokens << "/"
+                          << prefix_stats_.last_prompt_tokens << " tokens cacheable last request, "
+                          << static_cast<int>(prefix_stats_.hit_rate() * 100) << "% over "
+                          << prefix_stats_.requests << " requests"
+                          << (config_.prune_cache_aware ? " (cache-aware pruning)" : "") << "\n";
+            }
+            if (auto* rc = provider_chain_->response_cache()) {
+                auto rs = rc->stats();
+                std::cout << "RespCache: hits=" << rs.hits << " misses=" << rs.misses
+                          << " stored=" << rs.stores << " entries=" << rs.entries << "\n";
+            }
+            if (config_.fallback.enabled && provider_chain_->provider_count() > 1) {
+                std::cout << "Routing  : " << (provider_chain_->adaptive() ? "adaptive" : "ordered")
+                          << (provider_chain_->hedging() ? ", hedging" : "") << "\n";
+                for (auto& h : provider_chain_->health()) {
+                    std::cout << "  " << h.name << ": " << circuit_state_name(h.state)
+                              << std::fixed << std::setprecision(0)
+                              << " lat=" << (h.has_latency ? h.latency_ms : 0) << "ms"
+                              << " ttft=" << (h.has_ttft ? h.ttft_ms : 0) << "ms"
+                              << " err=" << h.error_rate * 100 << "%" << std::defaultfloat
+                              << " n=" << h.requests;
+                    if (provider_chain_->hedging()) std::cout << " hedges=" << h.hedges << " won=" << h.hedge_wins;
+                    std::cout << "\n";
+                }
+            }
+            for (auto& [name, ps] : provider_chain_->pool_stats()) {
+                std::cout << "Pool     : " << name << " hits=" << ps.hits << " misses=" << ps.misses
+                          << " idle=" << ps.idle << "/" << config_.http_pool.size << "\n";
+            }
             continue;
         }
         if (line.substr(0, 7) == "/model ") {
             std::string new_model = line.substr(7);
             while (!new_model.empty() && new_model[0] == ' ') new_model.erase(0, 1);
             if (!new_model.empty()) {
-                config_.model = new_model;
+                set_model(new_model);
                 std::cout << "Model set to: " << new_model << "\n";
             }
             continue;
         }
         if (line == "/context") {
             std::string prompt = build_system_prompt();
-            int prompt_tokens = estimate_tokens(prompt);
+            int prompt_tokens = estimate_tokens(prompt, *tokenizer_);
             std::cout << "System prompt: " << prompt.size() << " chars (~" << prompt_tokens << " tokens)\n";
             std::string ws = config_.workspace_path();
             for (auto& name : {"SOUL.md", "IDENTITY.md", "USER.md", "AGENTS.md", "TOOLS.md", "MEMORY.md"}) {
@@ -758,25 +1162,25 @@ void Agent::interactive_loop(bool no_markdown, bool logs) {
                               << " | injected " << injected << " chars\n";
                 }
             }
-            auto recent = session_.load_recent(config_.context_window);
+            auto recent = load_history();
             std::cout << "  Session: " << recent.size() << " messages (~"
-                      << estimate_tokens(recent) << " tokens)\n";
+                      << estimate_tokens(recent, *tokenizer_) << " tokens)\n";
             auto tools_json = tools_.tools_spec();
             std::cout << "  Tools: " << tools_.tool_names().size() << " registered (~"
-                      << estimate_tokens(tools_json.dump()) << " tokens)\n";
+                      << estimate_tokens(tools_json.dump(), *tokenizer_) << " tokens)\n";
             std::cout << "  Context window: " << config_.context_tokens << " tokens\n";
             continue;
         }
         if (line == "/compact") {
-            auto recent = session_.load_recent(config_.context_window);
-            int before = estimate_tokens(recent);
+            auto recent = load_history();
+            int before = estimate_tokens(recent, *tokenizer_);
             std::vector<Message> msgs;
             Message sys; sys.role = "system"; sys.content = build_system_prompt();
             msgs.push_back(sys);
             for (auto& m : recent) msgs.push_back(m);
             if (try_auto_compact(msgs)) {
                 std::cout << "Compacted: ~" << before << " tokens -> ~"
-                          << estimate_tokens(msgs) << " tokens\n";
+                          << estimate_tokens(msgs, *tokenizer_) << " tokens\n";
             } else {
                 std::cout << "Nothing to compact (context usage is low).\n";
             }
@@ -898,10 +1302,7 @@ int cmd_agent(const std::string& message, bool no_markdown, bool logs,
 
     // Create memory search store early (needed by both memory tools)
     auto search_store = std::make_shared<MemorySearchStore>(
-        cfg.workspace_path() + "/memory/search.db", cfg.embedding.dimensions);
-
-    // Register memory tool with search store (auto-indexes on save, FTS5 only)
-    register_memory_tool(tools, cfg.workspace_path(), search_store, nullptr, nullptr);
+        cfg.workspace_path() + "/memory/search.db", cfg.embedding.dimensions, cfg.embedding.index);
 
     auto skills = std::make_shared<SkillsLoader>(cfg.workspace_path());
     skills->discover();
@@ -914,7 +1315,9 @@ int cmd_agent(const std::string& message, bool no_markdown, bool logs,
     agent.set_team(team, my_name);
     agent.set_skills(skills);
 
-    // Now register memory_search tool with provider chain (Agent is constructed)
+    // Now register memory tools with provider chain (Agent is constructed);
+    // saves are embedded and indexed, repeated texts hit the embedding cache
+    register_memory_tool(tools, cfg.workspace_path(), search_store, &agent.provider_chain(), &cfg.embedding);
     register_memory_search_tool(tools, search_store, &agent.provider_chain(), cfg.embedding);
 
     if (is_teammate) {
@@ -7,27 +7,38 @@
 #include "hooks.hpp"
 #include "team.hpp"
 #include "skills_loader.hpp"
+#include "agent_event.hpp"
+#include "tokenizer.hpp"
 #include <string>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
 
 namespace minidragon {
 
-// ── Token estimation (4 chars ≈ 1 token, conservative) ──────────────
-inline int estimate_tokens(const std::string& text) {
-    return static_cast<int>((text.size() + 3) / 4);
+// ── Token estimation ────────────────────────────────────────────────
+// Counts use the model's BPE tokenizer when its vocab is installed and
+// fall back to 4 chars ≈ 1 token otherwise.
+inline int estimate_tokens(const std::string& text, const Tokenizer& tok = heuristic_tokenizer()) {
+    return tok.count(text);
 }
 
-inline int estimate_tokens(const Message& msg) {
-    int tokens = estimate_tokens(msg.content) + 4; // role overhead
+inline int estimate_tokens(const Message& msg, const Tokenizer& tok = heuristic_tokenizer()) {
+    if (msg.cached_tokens >= 0 && msg.cached_tokens_tok == tok.id()) return msg.cached_tokens;
+
+    int tokens = tok.count(msg.content) + 4; // role overhead
     for (auto& tc : msg.tool_calls) {
-        tokens += estimate_tokens(tc.name) + estimate_tokens(tc.arguments) + 8;
+        tokens += tok.count(tc.name) + tok.count(tc.arguments) + 8;
     }
+    msg.cached_tokens = tokens;
+    msg.cached_tokens_tok = tok.id();
     return tokens;
 }
 
-inline int estimate_tokens(const std::vector<Message>& msgs) {
+inline int estimate_tokens(const std::vector<Message>& msgs, const Tokenizer& tok = heuristic_tokenizer()) {
     int total = 0;
-    for (auto& m : msgs) total += estimate_tokens(m);
+    for (auto& m : msgs) total += estimate_tokens(m, tok);
     return total;
 }
 
@@ -45,10 +56,43 @@ enum class ProviderErrorKind {
 ProviderErrorKind classify_provider_error(const std::string& error_text);
 bool is_retryable_error(ProviderErrorKind kind);
 
+// Per-run knobs from the caller (e.g. HTTP request fields)
+struct RunOptions {
+    bool bypass_cache = false;  // skip response cache lookups for this run
+    // Aborts the run: the provider request, MCP calls and exec children in
+    // flight are dropped and run() returns a "[cancelled] ..." reply
+    CancelToken* cancel = nullptr;
+    int timeout = 0;            // deadline in seconds (0 = config run_timeout)
+};
+
+// Estimated prompt-cache reuse: tokens of each request that repeat the
+// previous request's prefix byte for byte (tools, system, history)
+struct PrefixStats {
+    uint64_t requests = 0;
+    uint64_t prompt_tokens = 0;
+    uint64_t cacheable_tokens = 0;
+    int last_prompt_tokens = 0;
+    int last_cacheable_tokens = 0;
+
+    double hit_rate() const {
+        return prompt_tokens ? static_cast<double>(cacheable_tokens) / prompt_tokens : 0.0;
+    }
+};
+
 class Agent {
 public:
     Agent(const Config& config, ToolRegistry& tools);
-    std::string run(const std::string& user_message);
+    // Conversation-scoped agent: shares the provider chain with other agents
+    // and keeps its session history under <conversation_id> in sessions.db.
+    Agent(const Config& config, ToolRegistry& tools,
+          std::shared_ptr<ProviderChain> provider_chain,
+          const std::string& conversation_id);
+    ~Agent();
+    std::string run(const std::string& user_message, const RunOptions& opts = {});
+    // Same as run(), but streams provider tokens and tool start/finish events
+    // to sink as they happen, ending with a final event carrying the reply.
+    std::string run_stream(const std::string& user_message, const AgentEventSink& sink,
+                           const RunOptions& opts = {});
     void interactive_loop(bool no_markdown, bool logs);
 
     // Team support
@@ -60,13 +104,15 @@ public:
 
     // Hook access
     HookRunner& hooks() { return hooks_; }
-    ProviderChain& provider_chain() { return provider_chain_; }
+    ProviderChain& provider_chain() { return *provider_chain_; }
 
 private:
     Config config_;
     ToolRegistry& tools_;
+    std::string sessions_dir_;
     SessionLogger session_;
-    ProviderChain provider_chain_;
+    std::shared_ptr<ProviderChain> provider_chain_;
+    const Tokenizer* tokenizer_;   // resolved from config_.model
     HookRunner hooks_;
 
     // Team context (optional)
@@ -80,7 +126,34 @@ private:
     std::string cached_system_prompt_;
     int64_t system_prompt_built_at_ = 0;
 
+    // Cache-aware pruning: the history window start ("day:first message"),
+    // and the epoch the system prompt was built for
+    std::string history_epoch_;
+    std::string system_prompt_epoch_;
+    // Last compacted span (signature) and its summary, reused verbatim
+    size_t compacted_span_sig_ = 0;
+    std::string compacted_summary_;
+
+    // Background compaction: rolling summary of today's oldest messages,
+    // written by compact_thread_ and persisted in the session store
+    std::mutex summary_mutex_;
+    SessionSummary summary_;         // guarded by summary_mutex_
+    std::string summary_day_;        // day summary_ belongs to; guarded by summary_mutex_
+    std::thread compact_thread_;
+    std::atomic<bool> compact_busy_{false};
+    CancelToken compact_cancel_;     // aborts the summary call when the agent is destroyed
+
+    // Prefix of the previous request, one signature per message
+    std::vector<size_t> last_request_sigs_;
+    uint64_t last_tools_version_ = 0;
+    PrefixStats prefix_stats_;
+
+    void register_config_hooks();
+    void set_model(const std::string& model);
+    std::string run_loop(const std::string& user_message, const AgentEventSink* sink,
+                         const RunOptions& opts);
     std::string build_system_prompt();
+    std::vector<Message> load_history();
     void inject_inbox_messages(std::vector<Message>& messages);
 
     // ── Token optimization ──────────────────────────────────────────
@@ -88,6 +161,14 @@ private:
     void prune_context(std::vector<Message>& messages);
     void repair_tool_pairing(std::vector<Message>& messages);
     bool try_auto_compact(std::vector<Message>& messages);
+    std::string summarize(const std::string& conv_text, const std::string& model, CancelToken* cancel = nullptr);
+    void load_summary();
+    void start_background_compaction(const std::vector<Message>& messages);
+    bool swap_in_summary(std::vector<Message>& messages);
+    void wait_background_compaction();
+    void reset_session();
+    int block_boundary(int index) const;
+    int track_prefix(const std::vector<Message>& messages, uint64_t tools_version, int tool_spec_tokens);
     std::string truncate_at_boundary(const std::string& text, int max_chars) const;
 };
 
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <functional>
+
+namespace minidragon {
+
+// Incremental progress of an agent run, delivered to streaming consumers.
+struct AgentEvent {
+    enum class Kind {
+        token,       // text: content delta from the provider
+        tool_start,  // tool_name/tool_call_id/text=arguments
+        tool_end,    // tool_name/tool_call_id/text=result (possibly truncated)
+        final        // text: the reply run() returns
+    };
+
+    Kind kind = Kind::token;
+    std::string text;
+    std::string tool_name;
+    std::string tool_call_id;
+};
+
+using AgentEventSink = std::function<void(const AgentEvent&)>;
+
+inline const char* agent_event_kind_name(AgentEvent::Kind k) {
+    switch (k) {
+    case AgentEvent::Kind::token:      return "token";
+    case AgentEvent::Kind::tool_start: return "tool_start";
+    case AgentEvent::Kind::tool_end:   return "tool_end";
+    case AgentEvent::Kind::final:      return "final";
+    }
+    return "token";
+}
+
+} // namespace minidragon
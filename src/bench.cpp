@@ -0,0 +1,238 @@
+#include "bench.hpp"
+#include "tokenizer.hpp"
+#include "vec_kernels.hpp"
+#include "response_parser.hpp"
+#include "config.hpp"
+#include "utils.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+namespace minidragon {
+
+// ── Synthetic corpora ────────────────────────────────────────────────
+
+static std::string make_code_corpus(size_t target) {
+    static const char* snippet =
+        "int Agent::prune_context(std::vector<Message>& messages) {\n"
+        "    for (int i = 0; i < protect_from; i++) {\n"
+        "        if (messages[i].role != \"tool\") continue;\n"
+        "        total += estimate_tokens(messages[i], *tokenizer_); // 42\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n\n";
+    std::string out;
+    while (out.size() < target) out += snippet;
+    return out;
+}
+
+static std::string make_json_corpus(size_t target) {
+    std::string out = "[";
+    for (int i = 0; out.size() < target; i++) {
+        out += "{\"id\":\"call_" + std::to_string(i) + "\",\"type\":\"function\","
+               "\"function\":{\"name\":\"read_file\",\"arguments\":\"{\\\"path\\\":\\\"src/agent.cpp\\\","
+               "\\\"offset\\\":" + std::to_string(i * 100) + "}\"}},";
+    }
+    out += "]";
+    return out;
+}
+
+static std::string make_cjk_corpus(size_t target) {
+    static const char* snippet =
+        "迷你龍是一個輕量級的人工智慧代理程式，支援多種模型供應商。"
+        "它可以讀取檔案、執行指令，並記住之前的對話內容。\n";
+    std::string out;
+    while (out.size() < target) out += snippet;
+    return out;
+}
+
+static void bench_one(const Tokenizer& tok, const std::string& label, const std::string& text) {
+    using clock = std::chrono::steady_clock;
+    int iterations = 0;
+    long long tokens = 0;
+    auto start = clock::now();
+    double elapsed = 0;
+    // Run for at least ~0.5s so short corpora still give stable numbers
+    while (elapsed < 0.5) {
+        tokens += tok.count(text);
+        iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    double mb = static_cast<double>(text.size()) * iterations / (1024.0 * 1024.0);
+    std::cout << "  " << std::left << std::setw(10) << tok.name()
+              << std::setw(6) << label
+              << std::right << std::setw(10) << (tokens / iterations) << " tokens"
+              << std::setw(12) << std::fixed << std::setprecision(0) << (tokens / elapsed) << " tok/s"
+              << std::setw(9) << std::setprecision(1) << (mb / elapsed) << " MB/s\n";
+}
+
+// ── Subcommands ──────────────────────────────────────────────────────
+
+static int bench_tokenizer(const std::vector<std::string>& args) {
+    std::string vocab;
+    size_t size = 256 * 1024;
+    for (size_t i = 1; i < args.size(); i++) {
+        if (args[i] == "--vocab" && i + 1 < args.size()) {
+            vocab = expand_path(args[++i]);
+        } else if (args[i] == "--size" && i + 1 < args.size()) {
+            size = static_cast<size_t>(std::stoul(args[++i])) * 1024;
+        }
+    }
+    if (vocab.empty()) {
+        Config cfg = Config::load(default_config_path());
+        vocab = expand_path(cfg.tokenizer.vocab_dir) + "/cl100k_base.tiktoken";
+    }
+
+    std::vector<std::pair<std::string, std::string>> corpora = {
+        {"code", make_code_corpus(size)},
+        {"json", make_json_corpus(size)},
+        {"cjk", make_cjk_corpus(size)},
+    };
+
+    std::vector<const Tokenizer*> tokenizers = {&heuristic_tokenizer()};
+    auto bpe = BpeTokenizer::load(vocab, fs::path(vocab).stem().string());
+    if (bpe) {
+        tokenizers.push_back(bpe.get());
+        std::cout << "Vocab: " << vocab << " (" << bpe->vocab_size() << " tokens)\n";
+    } else {
+        std::cout << "Vocab: " << vocab << " not found — heuristic only\n";
+    }
+
+    std::cout << "Corpus size: " << size / 1024 << " KiB each\n";
+    for (auto* tok : tokenizers) {
+        for (auto& [label, text] : corpora) bench_one(*tok, label, text);
+    }
+    return 0;
+}
+
+// Score a query against a block of stored vectors, as hybrid search does
+static int bench_vectors(const std::vector<std::string>& args) {
+    size_t rows = 20000;
+    for (size_t i = 1; i < args.size(); i++) {
+        if (args[i] == "--rows" && i + 1 < args.size()) rows = std::stoul(args[++i]);
+    }
+
+    std::cout << "Dispatched kernel: " << dot_kernel_name() << "\n";
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist;
+    using clock = std::chrono::steady_clock;
+
+    for (size_t dims : {1536, 3072}) {
+        std::vector<float> data(rows * dims);
+        for (auto& x : data) x = dist(rng);
+        std::vector<float> query(dims);
+        for (auto& x : query) x = dist(rng);
+
+        std::cout << "\n" << dims << " dims, " << rows << " rows:\n";
+        auto kernels = available_dot_kernels();
+        for (auto& k : kernels) {
+            // Agreement with the scalar kernel on a sample of rows
+            float max_err = 0;
+            for (size_t r = 0; r < std::min<size_t>(rows, 100); r++) {
+                const float* row = data.data() + r * dims;
+                float want = kernels.front().fn(query.data(), row, dims);
+                max_err = std::max(max_err, std::abs(k.fn(query.data(), row, dims) - want) /
+                                            std::max(1.0f, std::abs(want)));
+            }
+
+            volatile float sink = 0;
+            size_t scored = 0;
+            auto start = clock::now();
+            double elapsed = 0;
+            while (elapsed < 0.5) {
+                float sum = 0;
+                for (size_t r = 0; r < rows; r++) sum += k.fn(query.data(), data.data() + r * dims, dims);
+                sink = sink + sum;
+                scored += rows;
+                elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            }
+            double ns_per = elapsed * 1e9 / scored;
+            double gbps = static_cast<double>(scored) * dims * sizeof(float) / elapsed / 1e9;
+            std::cout << "  " << std::left << std::setw(9) << k.name << std::right
+                      << std::setw(9) << std::fixed << std::setprecision(1) << ns_per << " ns/vector"
+                      << std::setw(8) << std::setprecision(2) << gbps << " GB/s"
+                      << "   max rel err " << std::scientific << std::setprecision(1) << max_err << "\n"
+                      << std::defaultfloat;
+        }
+    }
+    return 0;
+}
+
+// Hand-rolled fast path vs full DOM parse on synthetic provider responses
+static int bench_responses(const std::vector<std::string>& args) {
+    size_t batch = 64;
+    for (size_t i = 1; i < args.size(); i++) {
+        if (args[i] == "--batch" && i + 1 < args.size()) batch = std::stoul(args[++i]);
+    }
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 0.05f);
+    nlohmann::json emb = {{"object", "list"}, {"model", "text-embedding-3-small"}};
+    for (size_t i = 0; i < batch; i++) {
+        std::vector<float> v(1536);
+        for (auto& x : v) x = dist(rng);
+        emb["data"].push_back({{"object", "embedding"}, {"index", i}, {"embedding", v}});
+    }
+    emb["usage"] = {{"prompt_tokens", 8 * batch}, {"total_tokens", 8 * batch}};
+
+    nlohmann::json chat = {{"id", "chatcmpl-1"}, {"object", "chat.completion"}};
+    nlohmann::json msg = {{"role", "assistant"}, {"content", make_code_corpus(16 * 1024)}};
+    for (int i = 0; i < 4; i++) {
+        msg["tool_calls"].push_back({{"id", "call_" + std::to_string(i)}, {"type", "function"},
+            {"function", {{"name", "read_file"}, {"arguments", make_json_corpus(2048)}}}});
+    }
+    chat["choices"].push_back({{"index", 0}, {"message", msg}, {"finish_reason", "tool_calls"}});
+
+    using clock = std::chrono::steady_clock;
+    auto run = [&](const char* label, const std::string& body, auto&& fn) {
+        size_t iters = 0;
+        auto start = clock::now();
+        double elapsed = 0;
+        while (elapsed < 0.5) {
+            fn(body);
+            iters++;
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        }
+        double ms = elapsed * 1e3 / iters;
+        std::cout << "  " << std::left << std::setw(16) << label << std::right
+                  << std::setw(9) << std::fixed << std::setprecision(3) << ms << " ms"
+                  << std::setw(9) << std::setprecision(1) << body.size() / (ms * 1e3) << " MB/s\n"
+                  << std::defaultfloat;
+    };
+
+    std::string emb_body = emb.dump();
+    std::string chat_body = chat.dump();
+    EmbeddingResponse er;
+    ProviderResponse pr;
+    bool emb_ok = parse_embeddings_fast(emb_body, er) && er.embeddings == parse_embeddings_dom(emb_body).embeddings;
+    bool chat_ok = parse_chat_fast(chat_body, pr) && pr.content == parse_chat_dom(chat_body).content &&
+                   pr.tool_calls.size() == 4;
+
+    std::cout << "Embeddings: " << batch << " x 1536, " << emb_body.size() / 1024 << " KiB"
+              << (emb_ok ? "" : "  [MISMATCH]") << "\n";
+    run("dom", emb_body, [](const std::string& b) { parse_embeddings_dom(b); });
+    run("fast", emb_body, [&](const std::string& b) { parse_embeddings_fast(b, er); });
+    std::cout << "Chat completion: " << chat_body.size() / 1024 << " KiB"
+              << (chat_ok ? "" : "  [MISMATCH]") << "\n";
+    run("dom", chat_body, [](const std::string& b) { parse_chat_dom(b); });
+    run("fast", chat_body, [&](const std::string& b) { parse_chat_fast(b, pr); });
+    return emb_ok && chat_ok ? 0 : 1;
+}
+
+int cmd_bench(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "Usage: minidragon bench tokenizer [--vocab FILE] [--size KIB]\n"
+                  << "       minidragon bench vectors [--rows N]\n"
+                  << "       minidragon bench responses [--batch N]\n";
+        return 1;
+    }
+    if (args[0] == "tokenizer") return bench_tokenizer(args);
+    if (args[0] == "vectors") return bench_vectors(args);
+    if (args[0] == "responses") return bench_responses(args);
+    std::cerr << "Unknown benchmark: " << args[0] << "\n";
+    return 1;
+}
+
+} // namespace minidragon
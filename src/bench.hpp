@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace minidragon {
+// Micro-benchmarks for hot paths: minidragon bench <tokenizer|vectors> [options]
+int cmd_bench(const std::vector<std::string>& args);
+} // namespace minidragon
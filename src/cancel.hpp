@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <cstddef>
+
+namespace minidragon {
+
+// Cooperative cancellation flag shared between the owner of a request and
+// the code doing the work. cancel() is sticky; callbacks registered with
+// on_cancel() run once, on the cancelling thread, so blocking I/O can be
+// interrupted (e.g. by shutting down a socket).
+class CancelToken {
+public:
+    bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+    // reason is kept from the first call ("client disconnected", ...)
+    void cancel(const std::string& reason = "cancelled") {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (cancelled()) return;
+            reason_ = reason;
+            cancelled_.store(true, std::memory_order_release);
+            for (auto& [id, fn] : callbacks_) fn();
+        }
+        cv_.notify_all();
+    }
+
+    // "" until cancelled. Lock-free (reason_ is written once, before the
+    // flag is published), so cancel callbacks may call it too.
+    std::string reason() const {
+        return cancelled() ? reason_ : std::string();
+    }
+
+    // Returns 0 (and runs nothing) if already cancelled
+    size_t on_cancel(std::function<void()> fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled()) return 0;
+        callbacks_[++next_id_] = std::move(fn);
+        return next_id_;
+    }
+
+    // Once this returns the callback is not running and never will
+    void remove(size_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callbacks_.erase(id);
+    }
+
+    // Sleeps up to d; true if cancelled (possibly before the call)
+    template <typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> d) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, d, [&] { return cancelled(); });
+    }
+
+private:
+    std::atomic<bool> cancelled_{false};
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<size_t, std::function<void()>> callbacks_;
+    size_t next_id_ = 0;
+    std::string reason_;
+};
+
+// Registers an interrupt callback for the lifetime of a blocking call.
+// Null token = no-op.
+class CancelScope {
+public:
+    CancelScope(CancelToken* token, std::function<void()> fn)
+        : token_(token), id_(token ? token->on_cancel(std::move(fn)) : 0) {}
+    ~CancelScope() { release(); }
+
+    CancelScope(const CancelScope&) = delete;
+    CancelScope& operator=(const CancelScope&) = delete;
+
+    void release() {
+        if (token_ && id_) token_->remove(id_);
+        id_ = 0;
+    }
+
+    bool cancelled() const { return token_ && token_->cancelled(); }
+
+private:
+    CancelToken* token_;
+    size_t id_;
+};
+
+// Cancels the token with "deadline exceeded" once `after` has elapsed,
+// unless destroyed first. One timer thread per deadline.
+class CancelDeadline {
+public:
+    template <typename Rep, typename Period>
+    CancelDeadline(CancelToken& token, std::chrono::duration<Rep, Period> after)
+        : thread_([this, &token, at = std::chrono::steady_clock::now() + after] {
+              std::unique_lock<std::mutex> lock(mutex_);
+              if (!cv_.wait_until(lock, at, [&] { return done_; })) token.cancel("deadline exceeded");
+          }) {}
+
+    ~CancelDeadline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    CancelDeadline(const CancelDeadline&) = delete;
+    CancelDeadline& operator=(const CancelDeadline&) = delete;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_ = false;
+    std::thread thread_;  // last: starts after the members it uses
+};
+
+} // namespace minidragon
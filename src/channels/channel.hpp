@@ -1,4 +1,6 @@
 #pragma once
+#include "../agent_event.hpp"
+#include "../cancel.hpp"
 #include <string>
 #include <functional>
 
@@ -8,10 +10,16 @@ struct InboundMessage {
     std::string channel;
     std::string user;
     std::string text;
+    bool bypass_cache = false;  // "cache": "bypass" in the request
+    CancelToken* cancel = nullptr;  // set by channels that notice abandoned requests
+    int timeout = 0;                // run deadline in seconds (0 = default)
 };
 
 using MessageHandler = std::function<std::string(const InboundMessage&)>;
 
+// Streaming handler: emits AgentEvents to the sink while producing the reply
+using StreamMessageHandler = std::function<std::string(const InboundMessage&, const AgentEventSink&)>;
+
 class Channel {
 public:
     virtual ~Channel() = default;
@@ -5,6 +5,9 @@
 #include <httplib.h>
 #include <nlohmann/json.hpp>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <iostream>
 
 namespace minidragon {
@@ -140,6 +143,7 @@ async function send(){
   autoGrow();
   addMsg('user',text);
   status.className='wait';
+  thinking.firstChild.textContent='Thinking';
   thinking.className='show';
 
   let fullText='';
@@ -168,6 +172,12 @@ async function send(){
         if(payload==='[DONE]')continue;
         try{
           const j=JSON.parse(payload);
+          if(j.type==='tool_start'){thinking.firstChild.textContent='Running '+j.name;continue;}
+          if(j.type==='tool_end'){thinking.firstChild.textContent='Thinking';continue;}
+          if(j.type==='final'){
+            if(!fullText&&j.content){fullText=j.content;content.innerHTML=renderMd(fullText);scrollBottom();}
+            continue;
+          }
           const delta=j.choices&&j.choices[0]&&j.choices[0].delta;
           if(delta&&delta.content){
             fullText+=delta.content;
@@ -269,21 +279,39 @@ public:
             msg.channel = j.value("channel", "http");
             msg.user = j.value("user", "anonymous");
             msg.text = j.value("text", "");
-
-            std::string reply;
-            try {
-                reply = handler_(msg);
-            } catch (const std::exception& e) {
-                std::cerr << "[http] /chat handler error: " << e.what() << "\n";
-                reply = std::string("[error] ") + e.what();
-            } catch (...) {
-                std::cerr << "[http] /chat handler unknown error\n";
-                reply = "[error] Unknown internal error";
-            }
-
-            nlohmann::json resp;
-            resp["reply"] = reply;
-            res.set_content(resp.dump(), "application/json");
+            msg.bypass_cache = j.value("cache", "") == "bypass";
+            msg.timeout = j.value("timeout", 0);
+
+            // Chunked so keep-alive newlines (valid before a JSON value) can
+            // notice a client that hung up and cancel its run
+            res.set_chunked_content_provider("application/json",
+                [this, msg](size_t, httplib::DataSink& sink) {
+                    CancelToken cancel;
+                    InboundMessage run_msg = msg;
+                    run_msg.cancel = &cancel;
+                    std::mutex write_mutex;
+
+                    std::string reply;
+                    watch_disconnect(sink, write_mutex, "\n", cancel, [&] {
+                        try {
+                            reply = handler_(run_msg);
+                        } catch (const std::exception& e) {
+                            std::cerr << "[http] /chat handler error: " << e.what() << "\n";
+                            reply = std::string("[error] ") + e.what();
+                        } catch (...) {
+                            std::cerr << "[http] /chat handler unknown error\n";
+                            reply = "[error] Unknown internal error";
+                        }
+                    });
+                    if (cancel.cancelled()) return false;
+
+                    nlohmann::json resp;
+                    resp["reply"] = reply;
+                    std::string body = resp.dump();
+                    sink.write(body.data(), body.size());
+                    sink.done();
+                    return true;
+                });
         });
 
         server_.Post("/chat/stream", [this](const httplib::Request& req, httplib::Response& res) {
@@ -303,36 +331,65 @@ public:
             msg.channel = j.value("channel", "http");
             msg.user = j.value("user", "anonymous");
             msg.text = j.value("text", "");
+            msg.bypass_cache = j.value("cache", "") == "bypass";
+            msg.timeout = j.value("timeout", 0);
 
-            std::string reply;
-            try {
-                reply = handler_(msg);
-            } catch (const std::exception& e) {
-                std::cerr << "[http] /chat/stream handler error: " << e.what() << "\n";
-                reply = std::string("[error] ") + e.what();
-            } catch (...) {
-                std::cerr << "[http] /chat/stream handler unknown error\n";
-                reply = "[error] Unknown internal error";
-            }
-
-            res.set_header("Content-Type", "text/event-stream");
             res.set_header("Cache-Control", "no-cache");
-            res.set_header("Connection", "keep-alive");
-
-            // Stream the reply as SSE events in chunks
-            std::string body;
-            size_t chunk_size = 20;
-            for (size_t i = 0; i < reply.size(); i += chunk_size) {
-                std::string chunk = reply.substr(i, std::min(chunk_size, reply.size() - i));
-                nlohmann::json event;
-                event["choices"] = nlohmann::json::array();
-                nlohmann::json choice;
-                choice["delta"]["content"] = chunk;
-                event["choices"].push_back(choice);
-                body += "data: " + event.dump() + "\n\n";
-            }
-            body += "data: [DONE]\n\n";
-            res.set_content(body, "text/event-stream");
+            res.set_header("X-Accel-Buffering", "no");
+
+            // The agent runs inside the chunked provider, so every event is
+            // written to the socket as soon as it is produced.
+            res.set_chunked_content_provider("text/event-stream",
+                [this, msg](size_t, httplib::DataSink& sink) {
+                    CancelToken cancel;
+                    InboundMessage run_msg = msg;
+                    run_msg.cancel = &cancel;
+                    std::mutex write_mutex;
+
+                    auto write_event = [&](const nlohmann::json& ev) {
+                        std::string frame = "data: " +
+                            ev.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n\n";
+                        std::lock_guard<std::mutex> lock(write_mutex);
+                        if (sink.write(frame.data(), frame.size())) return true;
+                        cancel.cancel("client disconnected");
+                        return false;
+                    };
+
+                    AgentEventSink on_event = [&](const AgentEvent& ev) {
+                        nlohmann::json out;
+                        if (ev.kind == AgentEvent::Kind::token) {
+                            // OpenAI chunk shape, so plain SSE clients keep working
+                            nlohmann::json choice;
+                            choice["delta"]["content"] = ev.text;
+                            out["choices"] = nlohmann::json::array({choice});
+                        } else {
+                            out["type"] = agent_event_kind_name(ev.kind);
+                            if (!ev.tool_name.empty()) out["name"] = ev.tool_name;
+                            if (!ev.tool_call_id.empty()) out["id"] = ev.tool_call_id;
+                            out["content"] = ev.text;
+                        }
+                        write_event(out);
+                    };
+
+                    // SSE comments keep the connection probed between events
+                    watch_disconnect(sink, write_mutex, ": keepalive\n\n", cancel, [&] {
+                        try {
+                            stream_reply(run_msg, on_event);
+                        } catch (const std::exception& e) {
+                            std::cerr << "[http] /chat/stream handler error: " << e.what() << "\n";
+                            write_event({{"type", "final"}, {"content", std::string("[error] ") + e.what()}});
+                        } catch (...) {
+                            std::cerr << "[http] /chat/stream handler unknown error\n";
+                            write_event({{"type", "final"}, {"content", "[error] Unknown internal error"}});
+                        }
+                    });
+                    if (cancel.cancelled()) return false;
+
+                    static const std::string done_frame = "data: [DONE]\n\n";
+                    sink.write(done_frame.data(), done_frame.size());
+                    sink.done();
+                    return true;
+                });
         });
 
         thread_ = std::thread([this]() {
@@ -341,6 +398,12 @@ public:
         });
     }
 
+    // Optional: token-level streaming for /chat/stream. Without it the
+    // reply from the plain handler is sent as a single final event.
+    void set_stream_handler(StreamMessageHandler handler) {
+        stream_handler_ = std::move(handler);
+    }
+
     void stop() override {
         server_.stop();
         if (thread_.joinable()) thread_.join();
@@ -351,10 +414,62 @@ private:
     int port_;
     HTTPChannelConfig config_;
     MessageHandler handler_;
+    StreamMessageHandler stream_handler_;
     httplib::Server server_;
     std::thread thread_;
     RateLimiter rate_limiter_;
 
+    static constexpr int kKeepaliveSeconds = 5;
+
+    // Runs fn while a watchdog writes `ping` every few seconds. A failed
+    // write means the client went away: the token is cancelled, which
+    // aborts the agent run and frees its slot. Other writes to the sink
+    // must hold write_mutex.
+    template <typename Fn>
+    static void watch_disconnect(httplib::DataSink& sink, std::mutex& write_mutex, const std::string& ping,
+                                 CancelToken& cancel, Fn&& fn) {
+        std::mutex m;
+        std::condition_variable cv;
+        bool done = false;
+        std::thread watchdog([&] {
+            std::unique_lock<std::mutex> lock(m);
+            while (!cv.wait_for(lock, std::chrono::seconds(kKeepaliveSeconds), [&] { return done; })) {
+                std::lock_guard<std::mutex> write_lock(write_mutex);
+                if (!sink.write(ping.data(), ping.size())) {
+                    std::cerr << "[http] Client disconnected — cancelling its run\n";
+                    cancel.cancel("client disconnected");
+                    return;
+                }
+            }
+        });
+        struct Stop {
+            std::mutex& m;
+            std::condition_variable& cv;
+            bool& done;
+            std::thread& watchdog;
+            ~Stop() {
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    done = true;
+                }
+                cv.notify_all();
+                watchdog.join();
+            }
+        } stop{m, cv, done, watchdog};
+        fn();
+    }
+
+    void stream_reply(const InboundMessage& msg, const AgentEventSink& sink) {
+        if (stream_handler_) {
+            stream_handler_(msg, sink);
+            return;
+        }
+        AgentEvent ev;
+        ev.kind = AgentEvent::Kind::final;
+        ev.text = handler_(msg);
+        sink(ev);
+    }
+
     bool check_auth(const httplib::Request& req, httplib::Response& res) {
         if (config_.api_key.empty()) return true;
 
@@ -1,6 +1,7 @@
 #include "config.hpp"
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 
 namespace minidragon {
 
@@ -47,6 +48,8 @@ nlohmann::json Config::to_json() const {
     j["max_tool_output"] = max_tool_output;
     j["max_retries"] = max_retries;
     j["auto_compact"] = auto_compact;
+    j["tool_parallelism"] = tool_parallelism;
+    if (run_timeout > 0) j["run_timeout"] = run_timeout;
 
     // Providers
     for (auto& [k, v] : providers) {
@@ -96,6 +99,16 @@ nlohmann::json Config::to_json() const {
         fb["billing_cooldown"] = fallback.billing_cooldown;
         fb["auth_cooldown"] = fallback.auth_cooldown;
         fb["timeout_cooldown"] = fallback.timeout_cooldown;
+        fb["routing"] = fallback.routing;
+        if (!fallback.preferred.empty()) fb["preferred"] = fallback.preferred;
+        fb["failure_threshold"] = fallback.failure_threshold;
+        fb["ewma_alpha"] = fallback.ewma_alpha;
+        fb["hedge"] = fallback.hedge;
+        fb["hedge_percentile"] = fallback.hedge_percentile;
+        fb["hedge_delay_ms"] = fallback.hedge_delay_ms;
+        fb["hedge_min_delay_ms"] = fallback.hedge_min_delay_ms;
+        fb["hedge_budget"] = fallback.hedge_budget;
+        if (!fallback.hedge_budgets.empty()) fb["hedge_budgets"] = fallback.hedge_budgets;
     }
 
     // Embedding
@@ -105,6 +118,47 @@ nlohmann::json Config::to_json() const {
         if (!embedding.provider.empty()) emb["provider"] = embedding.provider;
         emb["model"] = embedding.model;
         emb["dimensions"] = embedding.dimensions;
+        auto& idx = emb["index"];
+        idx["m"] = embedding.index.m;
+        idx["ef_construction"] = embedding.index.ef_construction;
+        idx["ef_search"] = embedding.index.ef_search;
+        emb["cache"] = embedding.cache;
+        emb["cache_entries"] = embedding.cache_entries;
+        emb["batch_size"] = embedding.batch_size;
+        emb["batch_wait_ms"] = embedding.batch_wait_ms;
+        emb["batch_in_flight"] = embedding.batch_in_flight;
+    }
+
+    // HTTP pool
+    {
+        auto& hp = j["http_pool"];
+        hp["size"] = http_pool.size;
+        hp["idle_timeout"] = http_pool.idle_timeout;
+    }
+
+    // Conversations
+    {
+        auto& cv = j["conversations"];
+        cv["max_concurrent"] = conversations.max_concurrent;
+        cv["max_conversations"] = conversations.max_conversations;
+        cv["idle_timeout"] = conversations.idle_timeout;
+        if (conversations.supersede) cv["supersede"] = true;
+    }
+
+    // Response cache
+    if (response_cache.enabled) {
+        auto& rc = j["response_cache"];
+        rc["enabled"] = response_cache.enabled;
+        rc["max_temperature"] = response_cache.max_temperature;
+        rc["ttl"] = response_cache.ttl;
+        rc["max_entries"] = response_cache.max_entries;
+    }
+
+    // Tokenizer
+    {
+        auto& tk = j["tokenizer"];
+        tk["vocab_dir"] = tokenizer.vocab_dir;
+        if (!tokenizer.models.empty()) tk["models"] = tokenizer.models;
     }
 
     // Hooks
@@ -175,6 +229,8 @@ Config Config::from_json(const nlohmann::json& j) {
     c.max_tool_output = j.value("max_tool_output", c.max_tool_output);
     c.max_retries = j.value("max_retries", c.max_retries);
     c.auto_compact = j.value("auto_compact", c.auto_compact);
+    c.tool_parallelism = j.value("tool_parallelism", c.tool_parallelism);
+    c.run_timeout = j.value("run_timeout", c.run_timeout);
 
     // Pruning settings
     if (j.contains("pruning")) {
@@ -184,7 +240,12 @@ Config Config::from_json(const nlohmann::json& j) {
         c.prune_head_chars = p.value("head_chars", c.prune_head_chars);
         c.prune_tail_chars = p.value("tail_chars", c.prune_tail_chars);
         c.prune_keep_recent = p.value("keep_recent", c.prune_keep_recent);
+        c.prune_cache_aware = p.value("mode", std::string("default")) == "cache_aware";
+        c.prune_block = std::max(1, p.value("block", c.prune_block));
         c.compact_reserve_tokens = p.value("compact_reserve_tokens", c.compact_reserve_tokens);
+        c.compact_background = p.value("background_compact", c.compact_background);
+        c.compact_watermark = p.value("compact_watermark", c.compact_watermark);
+        c.compact_model = p.value("compact_model", c.compact_model);
     }
 
     // Providers
@@ -258,6 +319,22 @@ Config Config::from_json(const nlohmann::json& j) {
         c.fallback.billing_cooldown = fb.value("billing_cooldown", c.fallback.billing_cooldown);
         c.fallback.auth_cooldown = fb.value("auth_cooldown", c.fallback.auth_cooldown);
         c.fallback.timeout_cooldown = fb.value("timeout_cooldown", c.fallback.timeout_cooldown);
+        c.fallback.routing = fb.value("routing", c.fallback.routing);
+        if (fb.contains("preferred") && fb["preferred"].is_array()) {
+            c.fallback.preferred = parse_string_array(fb["preferred"]);
+        }
+        c.fallback.failure_threshold = fb.value("failure_threshold", c.fallback.failure_threshold);
+        c.fallback.ewma_alpha = fb.value("ewma_alpha", c.fallback.ewma_alpha);
+        c.fallback.hedge = fb.value("hedge", c.fallback.hedge);
+        c.fallback.hedge_percentile = fb.value("hedge_percentile", c.fallback.hedge_percentile);
+        c.fallback.hedge_delay_ms = fb.value("hedge_delay_ms", c.fallback.hedge_delay_ms);
+        c.fallback.hedge_min_delay_ms = fb.value("hedge_min_delay_ms", c.fallback.hedge_min_delay_ms);
+        c.fallback.hedge_budget = fb.value("hedge_budget", c.fallback.hedge_budget);
+        if (fb.contains("hedge_budgets") && fb["hedge_budgets"].is_object()) {
+            for (auto& [name, n] : fb["hedge_budgets"].items()) {
+                if (n.is_number_integer()) c.fallback.hedge_budgets[name] = n.get<int>();
+            }
+        }
     }
 
     // Embedding config
@@ -267,6 +344,53 @@ Config Config::from_json(const nlohmann::json& j) {
         c.embedding.provider = emb.value("provider", "");
         c.embedding.model = emb.value("model", c.embedding.model);
         c.embedding.dimensions = emb.value("dimensions", c.embedding.dimensions);
+        if (emb.contains("index")) {
+            auto& idx = emb["index"];
+            c.embedding.index.m = idx.value("m", c.embedding.index.m);
+            c.embedding.index.ef_construction = idx.value("ef_construction", c.embedding.index.ef_construction);
+            c.embedding.index.ef_search = idx.value("ef_search", c.embedding.index.ef_search);
+        }
+        c.embedding.cache = emb.value("cache", c.embedding.cache);
+        c.embedding.cache_entries = emb.value("cache_entries", c.embedding.cache_entries);
+        c.embedding.batch_size = emb.value("batch_size", c.embedding.batch_size);
+        c.embedding.batch_wait_ms = emb.value("batch_wait_ms", c.embedding.batch_wait_ms);
+        c.embedding.batch_in_flight = emb.value("batch_in_flight", c.embedding.batch_in_flight);
+    }
+
+    // HTTP pool config
+    if (j.contains("http_pool")) {
+        auto& hp = j["http_pool"];
+        c.http_pool.size = hp.value("size", c.http_pool.size);
+        c.http_pool.idle_timeout = hp.value("idle_timeout", c.http_pool.idle_timeout);
+    }
+
+    // Conversation manager config
+    if (j.contains("conversations")) {
+        auto& cv = j["conversations"];
+        c.conversations.max_concurrent = cv.value("max_concurrent", c.conversations.max_concurrent);
+        c.conversations.max_conversations = cv.value("max_conversations", c.conversations.max_conversations);
+        c.conversations.idle_timeout = cv.value("idle_timeout", c.conversations.idle_timeout);
+        c.conversations.supersede = cv.value("supersede", c.conversations.supersede);
+    }
+
+    // Response cache config
+    if (j.contains("response_cache")) {
+        auto& rc = j["response_cache"];
+        c.response_cache.enabled = rc.value("enabled", false);
+        c.response_cache.max_temperature = rc.value("max_temperature", c.response_cache.max_temperature);
+        c.response_cache.ttl = rc.value("ttl", c.response_cache.ttl);
+        c.response_cache.max_entries = rc.value("max_entries", c.response_cache.max_entries);
+    }
+
+    // Tokenizer config
+    if (j.contains("tokenizer")) {
+        auto& tk = j["tokenizer"];
+        c.tokenizer.vocab_dir = tk.value("vocab_dir", c.tokenizer.vocab_dir);
+        if (tk.contains("models") && tk["models"].is_object()) {
+            for (auto& [prefix, enc] : tk["models"].items()) {
+                if (enc.is_string()) c.tokenizer.models[prefix] = enc.get<std::string>();
+            }
+        }
     }
 
     // Hooks config
@@ -55,6 +55,28 @@ struct FallbackConfig {
     int billing_cooldown = 18000;     // 5 hours
     int auth_cooldown = 3600;         // 1 hour
     int timeout_cooldown = 30;        // seconds
+    // Routing: "ordered" walks provider_order; "adaptive" picks the best
+    // scoring healthy provider (EWMA latency/TTFT x error rate) from
+    // `preferred` (empty = all), then falls back to the rest in order.
+    std::string routing = "ordered";
+    std::vector<std::string> preferred;
+    int failure_threshold = 1;        // consecutive failures before the circuit opens
+    double ewma_alpha = 0.2;          // weight of the newest latency/error sample
+    // Hedging: when the primary has not answered (or, streaming, produced a
+    // first token) by its hedge_percentile latency, race the same request on
+    // the next admissible provider, keep the first answer, cancel the other.
+    bool hedge = false;
+    int hedge_percentile = 95;
+    int hedge_delay_ms = 2000;        // deadline until the primary has enough samples
+    int hedge_min_delay_ms = 200;
+    int hedge_budget = 10;            // hedges a provider may receive per minute
+    std::map<std::string, int> hedge_budgets;  // per-provider overrides
+};
+
+struct VectorIndexConfig {
+    int m = 16;                  // HNSW links per node (level 0 keeps 2*m)
+    int ef_construction = 200;   // beam width while inserting
+    int ef_search = 64;          // beam width while querying (>= result count)
 };
 
 struct EmbeddingConfig {
@@ -62,6 +84,36 @@ struct EmbeddingConfig {
     std::string provider;      // key into providers map (separate from main)
     std::string model = "text-embedding-3-small";
     int dimensions = 1536;
+    VectorIndexConfig index;   // ANN index over stored embeddings
+    bool cache = true;         // reuse embeddings of identical text (memory/embed_cache.db)
+    int cache_entries = 4096;  // in-memory LRU entries in front of the cache table
+    int batch_size = 64;       // max texts coalesced into one /embeddings call (1 = no batching)
+    int batch_wait_ms = 5;     // how long the first queued text waits for company
+    int batch_in_flight = 4;   // batched calls allowed upstream at once
+};
+
+struct HttpPoolConfig {
+    int size = 4;              // max idle keep-alive clients per provider
+    int idle_timeout = 60;     // seconds before an idle connection is dropped
+};
+
+struct ConversationConfig {
+    int max_concurrent = 4;       // agent runs allowed in parallel (gateway)
+    int max_conversations = 64;   // live per-conversation agents kept in memory
+    int idle_timeout = 3600;      // seconds before an idle conversation is evicted
+    bool supersede = false;       // a new message cancels the conversation's running one
+};
+
+struct TokenizerConfig {
+    std::string vocab_dir = "~/.minidragon/tokenizers";  // <encoding>.tiktoken files
+    std::map<std::string, std::string> models;  // model prefix -> encoding ("heuristic" = chars/4)
+};
+
+struct ResponseCacheConfig {
+    bool enabled = false;         // opt-in: replay identical requests from workspace/cache/responses.db
+    double max_temperature = 0.0; // only requests at or below this temperature are cached
+    int ttl = 86400;              // seconds an entry stays valid
+    int max_entries = 2000;       // least recently used entries are evicted beyond this
 };
 
 struct HookConfig {
@@ -88,9 +140,16 @@ struct Config {
     int prune_head_chars = 1500;     // keep first N chars of pruned tool result
     int prune_tail_chars = 1500;     // keep last N chars of pruned tool result
     int prune_keep_recent = 3;       // protect last N assistant messages from pruning
+    bool prune_cache_aware = false;  // prefix-stable history for provider prompt caching
+    int prune_block = 16;            // cache-aware: history is cut/pruned in blocks of N messages
     bool auto_compact = true;        // auto-compaction when context is near limit
     int compact_reserve_tokens = 20000; // reserve tokens for compaction prompt
+    bool compact_background = false; // summarize ahead of time on a worker thread
+    double compact_watermark = 0.7;  // ...once usage reaches this fraction of the compaction budget
+    std::string compact_model;       // model for summaries ("" = main model)
     int max_retries = 3;             // provider error retries
+    int tool_parallelism = 4;        // max tool calls of one turn run concurrently (1 = sequential)
+    int run_timeout = 0;             // deadline for one agent run in seconds (0 = none)
 
     std::map<std::string, ProviderConfig> providers;
 
@@ -100,6 +159,18 @@ struct Config {
     // Embedding config (for hybrid memory search)
     EmbeddingConfig embedding;
 
+    // Provider HTTP connection pooling
+    HttpPoolConfig http_pool;
+
+    // Gateway per-conversation agents
+    ConversationConfig conversations;
+
+    // Token counting for context budgets
+    TokenizerConfig tokenizer;
+
+    // Replay cache for deterministic requests
+    ResponseCacheConfig response_cache;
+
     // Hook configs
     std::vector<HookConfig> hooks;
 
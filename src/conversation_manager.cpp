@@ -0,0 +1,201 @@
+#include "conversation_manager.hpp"
+#include "sha256.hpp"
+#include <iostream>
+
+namespace minidragon {
+
+ConversationManager::ConversationManager(const Config& cfg, ToolRegistry& tools,
+                                         std::shared_ptr<ProviderChain> provider_chain,
+                                         std::shared_ptr<SkillsLoader> skills)
+    : config_(cfg)
+    , tools_(tools)
+    , provider_chain_(std::move(provider_chain))
+    , skills_(std::move(skills))
+{
+    if (config_.conversations.max_concurrent < 1) config_.conversations.max_concurrent = 1;
+    if (config_.conversations.max_conversations < 1) config_.conversations.max_conversations = 1;
+}
+
+std::string ConversationManager::key_for(const std::string& channel, const std::string& user) {
+    std::string ch = channel.empty() ? "default" : channel;
+    std::string us = user.empty() ? "anonymous" : user;
+    std::string key = ch + "_" + us;
+    // Plain keys stay as they always were; anything sanitizing would make
+    // ambiguous (replaced bytes, truncation, '_' in the channel) gets a hash
+    // of the raw pair after a '~', which no plain key contains
+    bool exact = ch.find('_') == std::string::npos && key.size() <= 120;
+    for (auto& c : key) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                  (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+        if (!ok) {
+            c = '_';
+            exact = false;
+        }
+    }
+    if (exact) return key;
+    if (key.size() > 100) key.resize(100);
+    return key + "~" + sha256_hex(ch + '\0' + us).substr(0, 16);
+}
+
+std::shared_ptr<ConversationManager::Conversation>
+ConversationManager::checkout(const std::string& key) {
+    std::vector<std::shared_ptr<Conversation>> evicted;  // destroyed after the lock is released
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = conversations_.find(key);
+    if (it == conversations_.end()) {
+        evict_idle_locked(evicted);
+        auto conv = std::make_shared<Conversation>();
+        conv->agent = std::make_unique<Agent>(config_, tools_, provider_chain_, key);
+        if (skills_) conv->agent->set_skills(skills_);
+        it = conversations_.emplace(key, std::move(conv)).first;
+    }
+    it->second->in_use++;
+    it->second->last_used = std::chrono::steady_clock::now();
+    return it->second;
+}
+
+void ConversationManager::checkin(const std::shared_ptr<Conversation>& conv) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    conv->in_use--;
+    conv->last_used = std::chrono::steady_clock::now();
+}
+
+void ConversationManager::evict_idle_locked(std::vector<std::shared_ptr<Conversation>>& evicted) {
+    auto now = std::chrono::steady_clock::now();
+    auto ttl = std::chrono::seconds(config_.conversations.idle_timeout);
+
+    // Drop conversations idle past the timeout
+    for (auto it = conversations_.begin(); it != conversations_.end();) {
+        if (it->second->in_use == 0 && now - it->second->last_used > ttl) {
+            evicted.push_back(std::move(it->second));
+            it = conversations_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Still full: evict least recently used idle conversations
+    while (static_cast<int>(conversations_.size()) >= config_.conversations.max_conversations) {
+        auto lru = conversations_.end();
+        for (auto it = conversations_.begin(); it != conversations_.end(); ++it) {
+            if (it->second->in_use != 0) continue;
+            if (lru == conversations_.end() || it->second->last_used < lru->second->last_used) lru = it;
+        }
+        if (lru == conversations_.end()) break;  // everything busy; allow temporary overshoot
+        evicted.push_back(std::move(lru->second));
+        conversations_.erase(lru);
+    }
+}
+
+void ConversationManager::pass_turn_locked(Conversation& conv) {
+    conv.next_to_run++;
+    while (conv.abandoned.erase(conv.next_to_run)) conv.next_to_run++;
+    conv.turn_cv.notify_all();
+}
+
+template <typename Fn>
+std::string ConversationManager::with_agent(const std::string& key, const RunOptions& opts, Fn&& fn) {
+    auto conv = checkout(key);
+    struct Checkin {
+        ConversationManager* mgr;
+        std::shared_ptr<Conversation> conv;
+        ~Checkin() { mgr->checkin(conv); }
+    } guard{this, conv};
+
+    // Our own token, so a newer message can cancel this run; the caller's
+    // token (client disconnect, ...) feeds into it
+    auto token = std::make_shared<CancelToken>();
+    CancelScope link(opts.cancel, [tok = token.get(), caller = opts.cancel] { tok->cancel(caller->reason()); });
+    RunOptions run_opts = opts;
+    run_opts.cancel = token.get();
+
+    uint64_t ticket;
+    std::shared_ptr<CancelToken> superseded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ticket = ++conv->arrivals;
+        if (config_.conversations.supersede) superseded = conv->active;
+    }
+    if (superseded) superseded->cancel("superseded by a newer message");
+
+    // Same conversation: one message at a time, in arrival order. Then the
+    // global concurrency limit (taken after our turn so a queued follow-up
+    // message does not hold a slot while it waits). A cancelled message
+    // stops waiting.
+    struct Turn {
+        ConversationManager* mgr;
+        Conversation* conv;
+        bool held = false;
+        ~Turn() {
+            if (!held) return;
+            std::lock_guard<std::mutex> lock(mgr->mutex_);
+            mgr->pass_turn_locked(*conv);
+        }
+    } turn{this, conv.get()};
+    {
+        CancelScope wake(token.get(), [this, c = conv.get()] {
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            c->turn_cv.notify_all();
+            slot_cv_.notify_all();
+        });
+        std::unique_lock<std::mutex> lock(mutex_);
+        conv->turn_cv.wait(lock, [&] { return conv->next_to_run == ticket || token->cancelled(); });
+        if (conv->next_to_run != ticket) {
+            conv->abandoned.insert(ticket);
+            lock.unlock();
+            return "[cancelled] Run aborted: " + token->reason();
+        }
+        turn.held = true;
+
+        if (config_.conversations.supersede && conv->arrivals != ticket) {
+            lock.unlock();
+            token->cancel("superseded by a newer message");
+            lock.lock();
+        }
+        slot_cv_.wait(lock, [&] {
+            return running_ < config_.conversations.max_concurrent || token->cancelled();
+        });
+        if (token->cancelled()) {
+            lock.unlock();
+            return "[cancelled] Run aborted: " + token->reason();
+        }
+        running_++;
+        conv->active = token;
+    }
+    struct Slot {
+        ConversationManager* mgr;
+        Conversation* conv;
+        ~Slot() {
+            {
+                std::lock_guard<std::mutex> lock(mgr->mutex_);
+                mgr->running_--;
+                conv->active.reset();
+            }
+            mgr->slot_cv_.notify_all();  // a woken waiter may be cancelled and leave
+        }
+    } slot{this, conv.get()};
+
+    return fn(*conv->agent, run_opts);
+}
+
+std::string ConversationManager::run(const std::string& key, const std::string& text,
+                                     const RunOptions& opts) {
+    return with_agent(key, opts, [&](Agent& agent, const RunOptions& o) { return agent.run(text, o); });
+}
+
+std::string ConversationManager::run_stream(const std::string& key, const std::string& text,
+                                            const AgentEventSink& sink, const RunOptions& opts) {
+    return with_agent(key, opts, [&](Agent& agent, const RunOptions& o) { return agent.run_stream(text, sink, o); });
+}
+
+size_t ConversationManager::conversation_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return conversations_.size();
+}
+
+int ConversationManager::running_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+} // namespace minidragon
@@ -0,0 +1,79 @@
+#pragma once
+#include "agent.hpp"
+#include <string>
+#include <map>
+#include <set>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+namespace minidragon {
+
+// Owns one Agent per conversation (channel + user) for the gateway.
+// Providers, tool registry and memory store are shared; history, session
+// files and compaction state stay per conversation. Messages within one
+// conversation run in order; different conversations run in parallel up
+// to max_concurrent. Idle conversations are evicted least-recently-used
+// first — their history lives on in the session store. With supersede
+// on, a new message cancels the conversation's running one (and skips any
+// still queued) so abandoned work stops holding a slot.
+class ConversationManager {
+public:
+    ConversationManager(const Config& cfg, ToolRegistry& tools,
+                        std::shared_ptr<ProviderChain> provider_chain,
+                        std::shared_ptr<SkillsLoader> skills);
+
+    ConversationManager(const ConversationManager&) = delete;
+    ConversationManager& operator=(const ConversationManager&) = delete;
+
+    std::string run(const std::string& key, const std::string& text,
+                    const RunOptions& opts = {});
+    std::string run_stream(const std::string& key, const std::string& text,
+                           const AgentEventSink& sink, const RunOptions& opts = {});
+
+    // "telegram_alice" style key, sanitized so it can name a directory;
+    // distinct (channel, user) pairs always get distinct keys
+    static std::string key_for(const std::string& channel, const std::string& user);
+
+    size_t conversation_count() const;
+    int running_count() const;
+
+private:
+    struct Conversation {
+        std::unique_ptr<Agent> agent;
+        int in_use = 0;         // guarded by ConversationManager::mutex_
+        // Messages run one at a time in ticket (arrival) order; all guarded
+        // by mutex_. Tickets cancelled while queued are skipped over.
+        uint64_t arrivals = 0;     // tickets handed out
+        uint64_t next_to_run = 1;  // ticket whose turn it is
+        std::set<uint64_t> abandoned;
+        std::condition_variable turn_cv;
+        std::shared_ptr<CancelToken> active;  // running message's token; guarded by mutex_
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    Config config_;
+    ToolRegistry& tools_;
+    std::shared_ptr<ProviderChain> provider_chain_;
+    std::shared_ptr<SkillsLoader> skills_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable slot_cv_;
+    std::map<std::string, std::shared_ptr<Conversation>> conversations_;
+    int running_ = 0;
+
+    std::shared_ptr<Conversation> checkout(const std::string& key);
+    void checkin(const std::shared_ptr<Conversation>& conv);
+    // Evicted conversations are moved to evicted, to be destroyed after
+    // mutex_ is released (an Agent may be waiting for a summary call)
+    void evict_idle_locked(std::vector<std::shared_ptr<Conversation>>& evicted);
+    // Hands the turn to the next ticket still waiting
+    void pass_turn_locked(Conversation& conv);
+
+    template <typename Fn>
+    std::string with_agent(const std::string& key, const RunOptions& opts, Fn&& fn);
+};
+
+} // namespace minidragon
@@ -44,6 +44,7 @@ void CronStore::init_db() {
 }
 
 int64_t CronStore::add(const CronJob& job) {
+    std::lock_guard<std::mutex> lock(mutex_);
     const char* sql = "INSERT INTO cron_jobs (name, message, schedule_type, interval_seconds, cron_expr, last_run, created_at) VALUES (?, ?, ?, ?, ?, ?, ?)";
     sqlite3_stmt* stmt = nullptr;
     sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
@@ -66,6 +67,7 @@ int64_t CronStore::add(const CronJob& job) {
 }
 
 std::vector<CronJob> CronStore::list() {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<CronJob> jobs;
     const char* sql = "SELECT id, name, message, schedule_type, interval_seconds, cron_expr, last_run, created_at FROM cron_jobs ORDER BY id";
     sqlite3_stmt* stmt = nullptr;
@@ -87,6 +89,7 @@ std::vector<CronJob> CronStore::list() {
 }
 
 bool CronStore::remove(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
     const char* sql = "DELETE FROM cron_jobs WHERE id = ?";
     sqlite3_stmt* stmt = nullptr;
     sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
@@ -156,6 +159,7 @@ std::vector<CronJob> CronStore::due_jobs() {
 }
 
 void CronStore::update_last_run(int64_t id, int64_t ts) {
+    std::lock_guard<std::mutex> lock(mutex_);
     const char* sql = "UPDATE cron_jobs SET last_run = ? WHERE id = ?";
     sqlite3_stmt* stmt = nullptr;
     sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
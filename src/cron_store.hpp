@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <mutex>
 #include <sqlite3.h>
 
 namespace minidragon {
@@ -33,6 +34,7 @@ public:
 
 private:
     sqlite3* db_ = nullptr;
+    std::mutex mutex_;  // shared by the cron tool and the gateway runner
     void init_db();
 };
 
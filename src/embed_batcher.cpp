@@ -0,0 +1,122 @@
+#include "embed_batcher.hpp"
+#include <algorithm>
+
+namespace minidragon {
+
+EmbedBatcher::EmbedBatcher(EmbedFn fn, int max_batch, int max_wait_ms, int max_in_flight)
+    : fn_(std::move(fn))
+    , max_batch_(static_cast<size_t>(std::max(max_batch, 1)))
+    , max_wait_(std::max(max_wait_ms, 0))
+{
+    int workers = std::max(max_in_flight, 1);
+    workers_.reserve(workers);
+    for (int i = 0; i < workers; i++) workers_.emplace_back([this] { run(); });
+}
+
+EmbedBatcher::~EmbedBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+std::future<std::vector<float>> EmbedBatcher::submit(const std::string& text, const std::string& model) {
+    Request req;
+    req.text = text;
+    req.model = model;
+    auto fut = req.promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            req.promise.set_exception(std::make_exception_ptr(
+                std::runtime_error("Embedding dispatcher is shutting down")));
+            return fut;
+        }
+        queue_.push_back(std::move(req));
+    }
+    cv_.notify_all();  // idle workers and the one holding the window share cv_
+    return fut;
+}
+
+EmbeddingResponse EmbedBatcher::embed(const std::vector<std::string>& texts, const std::string& model) {
+    std::vector<std::future<std::vector<float>>> futures;
+    futures.reserve(texts.size());
+    for (auto& t : texts) futures.push_back(submit(t, model));
+
+    EmbeddingResponse resp;
+    resp.embeddings.reserve(texts.size());
+    for (auto& f : futures) resp.embeddings.push_back(f.get());  // rethrows batch errors
+    return resp;
+}
+
+void EmbedBatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Idle workers wait their turn to form a batch; busy ones are upstream
+        cv_.wait(lock, [&] { return (stopping_ || !queue_.empty()) && !forming_; });
+        if (queue_.empty()) return;  // stopping with nothing left
+
+        // Hold the window open for more requests unless the batch is full
+        forming_ = true;
+        auto deadline = std::chrono::steady_clock::now() + max_wait_;
+        cv_.wait_until(lock, deadline, [&] { return stopping_ || queue_.size() >= max_batch_; });
+
+        // Take up to max_batch texts for the model at the head of the queue
+        std::vector<Request> batch;
+        std::string model = queue_.front().model;
+        for (auto it = queue_.begin(); it != queue_.end() && batch.size() < max_batch_;) {
+            if (it->model == model) {
+                batch.push_back(std::move(*it));
+                it = queue_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        forming_ = false;
+
+        lock.unlock();
+        cv_.notify_all();  // the next idle worker may start a window
+        dispatch(batch);
+        lock.lock();
+    }
+}
+
+void EmbedBatcher::dispatch(std::vector<Request>& batch) {
+    std::vector<std::string> texts;
+    texts.reserve(batch.size());
+    for (auto& r : batch) texts.push_back(r.text);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.batches++;
+        stats_.texts += batch.size();
+        stats_.largest = std::max(stats_.largest, batch.size());
+        size_t n = batch.size();
+        stats_.size_hist[n <= 1 ? 0 : n <= 4 ? 1 : n <= 16 ? 2 : 3]++;
+    }
+
+    try {
+        auto resp = fn_(texts, batch.front().model);
+        if (resp.embeddings.size() != batch.size()) {
+            throw std::runtime_error("Embedding response has " + std::to_string(resp.embeddings.size()) +
+                                     " vectors for " + std::to_string(batch.size()) + " inputs");
+        }
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch[i].promise.set_value(std::move(resp.embeddings[i]));
+        }
+    } catch (...) {
+        auto err = std::current_exception();
+        for (auto& r : batch) r.promise.set_exception(err);
+    }
+}
+
+EmbedBatchStats EmbedBatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace minidragon
@@ -0,0 +1,71 @@
+#pragma once
+#include "provider.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+namespace minidragon {
+
+struct EmbedBatchStats {
+    uint64_t batches = 0;   // upstream /embeddings calls
+    uint64_t texts = 0;     // texts sent in them
+    size_t largest = 0;     // biggest batch so far
+    uint64_t size_hist[4] = {0, 0, 0, 0};  // batches of 1, 2-4, 5-16, 17+
+
+    double average() const { return batches ? static_cast<double>(texts) / batches : 0.0; }
+};
+
+// Coalesces concurrent embed requests into batched /embeddings calls. The
+// first queued text opens a window of max_wait_ms; everything queued for
+// the same model before it closes (up to max_batch texts) goes out in one
+// request. Up to max_in_flight batches run upstream at once, each on its own
+// worker; one worker at a time holds the window open, and while all of them
+// are busy new requests keep queueing, so busy periods batch naturally.
+// Callers block on per-text futures.
+class EmbedBatcher {
+public:
+    using EmbedFn = std::function<EmbeddingResponse(const std::vector<std::string>&, const std::string&)>;
+
+    EmbedBatcher(EmbedFn fn, int max_batch, int max_wait_ms, int max_in_flight = 4);
+    ~EmbedBatcher();
+
+    EmbedBatcher(const EmbedBatcher&) = delete;
+    EmbedBatcher& operator=(const EmbedBatcher&) = delete;
+
+    std::future<std::vector<float>> submit(const std::string& text, const std::string& model);
+
+    // Submit every text and wait for all of them (order preserved)
+    EmbeddingResponse embed(const std::vector<std::string>& texts, const std::string& model);
+
+    EmbedBatchStats stats() const;
+
+private:
+    struct Request {
+        std::string text;
+        std::string model;
+        std::promise<std::vector<float>> promise;
+    };
+
+    EmbedFn fn_;
+    size_t max_batch_;
+    std::chrono::milliseconds max_wait_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Request> queue_;
+    bool stopping_ = false;
+    bool forming_ = false;  // a worker is holding the window open
+    EmbedBatchStats stats_;
+    std::vector<std::thread> workers_;
+
+    void run();
+    void dispatch(std::vector<Request>& batch);
+};
+
+} // namespace minidragon
@@ -0,0 +1,124 @@
+#include "embedding_cache.hpp"
+#include "sha256.hpp"
+#include "utils.hpp"
+#include <sqlite3.h>
+#include <cstring>
+#include <iostream>
+
+namespace minidragon {
+
+EmbeddingCache::EmbeddingCache(const std::string& db_path, size_t memory_entries)
+    : capacity_(memory_entries) {
+    fs::create_directories(fs::path(db_path).parent_path());
+    if (sqlite3_open(db_path.c_str(), &db_) != SQLITE_OK) {
+        std::cerr << "[embed_cache] Failed to open database: " << sqlite3_errmsg(db_) << "\n";
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return;
+    }
+
+    const char* sql = R"SQL(
+        PRAGMA journal_mode=WAL;
+        PRAGMA synchronous=NORMAL;
+        CREATE TABLE IF NOT EXISTS embeddings (
+            key TEXT PRIMARY KEY,
+            embedding BLOB NOT NULL,
+            created_at INTEGER
+        ) WITHOUT ROWID;
+    )SQL";
+    char* err = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "[embed_cache] Schema init error: " << (err ? err : "unknown") << "\n";
+        sqlite3_free(err);
+    }
+}
+
+EmbeddingCache::~EmbeddingCache() {
+    if (db_) sqlite3_close(db_);
+}
+
+std::string EmbeddingCache::key_for(const std::string& model, int dimensions, const std::string& text) {
+    return model + ":" + std::to_string(dimensions) + ":" + sha256_hex(text);
+}
+
+void EmbeddingCache::remember_locked(const std::string& key, const std::vector<float>& embedding) {
+    if (capacity_ == 0) return;
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    lru_.emplace_front(key, embedding);
+    index_[key] = lru_.begin();
+    if (lru_.size() > capacity_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+bool EmbeddingCache::get(const std::string& key, std::vector<float>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        out = it->second->second;
+        memory_hits_++;
+        return true;
+    }
+
+    if (db_) {
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(db_, "SELECT embedding FROM embeddings WHERE key = ?", -1, &stmt, nullptr);
+        sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+        bool found = false;
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const void* blob = sqlite3_column_blob(stmt, 0);
+            size_t dims = sqlite3_column_bytes(stmt, 0) / sizeof(float);
+            if (blob && dims > 0) {
+                out.resize(dims);
+                std::memcpy(out.data(), blob, dims * sizeof(float));
+                found = true;
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (found) {
+            remember_locked(key, out);
+            disk_hits_++;
+            return true;
+        }
+    }
+
+    misses_++;
+    return false;
+}
+
+void EmbeddingCache::put(const std::string& key, const std::vector<float>& embedding) {
+    if (embedding.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    remember_locked(key, embedding);
+    if (!db_) return;
+
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO embeddings (key, embedding, created_at) VALUES (?, ?, ?)",
+                       -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_blob(stmt, 2, embedding.data(), static_cast<int>(embedding.size() * sizeof(float)),
+                      SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, epoch_now());
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "[embed_cache] Write failed: " << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+}
+
+EmbeddingCacheStats EmbeddingCache::stats() const {
+    EmbeddingCacheStats s;
+    s.memory_hits = memory_hits_;
+    s.disk_hits = disk_hits_;
+    s.misses = misses_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.memory_entries = lru_.size();
+    return s;
+}
+
+} // namespace minidragon
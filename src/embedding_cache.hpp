@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+struct sqlite3;
+
+namespace minidragon {
+
+struct EmbeddingCacheStats {
+    uint64_t memory_hits = 0;
+    uint64_t disk_hits = 0;
+    uint64_t misses = 0;
+    size_t memory_entries = 0;
+
+    double hit_rate() const {
+        uint64_t total = memory_hits + disk_hits + misses;
+        return total ? static_cast<double>(memory_hits + disk_hits) / total : 0.0;
+    }
+};
+
+// Embeddings keyed by (model, dimensions, sha256(text)). An in-memory LRU
+// sits in front of a SQLite table so repeated queries and duplicate saves
+// skip the provider round-trip, across restarts too. Thread-safe.
+class EmbeddingCache {
+public:
+    EmbeddingCache(const std::string& db_path, size_t memory_entries);
+    ~EmbeddingCache();
+
+    EmbeddingCache(const EmbeddingCache&) = delete;
+    EmbeddingCache& operator=(const EmbeddingCache&) = delete;
+
+    static std::string key_for(const std::string& model, int dimensions, const std::string& text);
+
+    bool get(const std::string& key, std::vector<float>& out);
+    void put(const std::string& key, const std::vector<float>& embedding);
+
+    EmbeddingCacheStats stats() const;
+
+private:
+    using LruList = std::list<std::pair<std::string, std::vector<float>>>;
+
+    sqlite3* db_ = nullptr;
+    size_t capacity_;
+
+    mutable std::mutex mutex_;
+    LruList lru_;  // most recent first
+    std::unordered_map<std::string, LruList::iterator> index_;
+
+    std::atomic<uint64_t> memory_hits_{0};
+    std::atomic<uint64_t> disk_hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+    void remember_locked(const std::string& key, const std::vector<float>& embedding);
+};
+
+} // namespace minidragon
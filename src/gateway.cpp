@@ -11,6 +11,7 @@
 #include "skills_loader.hpp"
 #include "mcp_manager.hpp"
 #include "agent.hpp"
+#include "conversation_manager.hpp"
 #include "cron_store.hpp"
 #include "cron_runner.hpp"
 #include "heartbeat.hpp"
@@ -20,7 +21,6 @@
 #include <iostream>
 #include <csignal>
 #include <atomic>
-#include <mutex>
 
 namespace minidragon {
 
@@ -41,9 +41,8 @@ int cmd_gateway(const std::string& host, int port) {
 
     // Create memory search store (needed by both memory tools)
     auto search_store = std::make_shared<MemorySearchStore>(
-        ws + "/memory/search.db", cfg.embedding.dimensions);
+        ws + "/memory/search.db", cfg.embedding.dimensions, cfg.embedding.index);
 
-    register_memory_tool(tools, ws, search_store, nullptr, nullptr);
     register_subagent_tool(tools, cfg);
 
     // Skills: discover from workspace and global directories
@@ -55,17 +54,21 @@ int cmd_gateway(const std::string& host, int port) {
     mcp.connect_all();
     mcp.register_tools(tools);
 
-    Agent agent(cfg, tools);
-    agent.set_skills(skills);
+    // Providers are shared by every conversation; each conversation gets
+    // its own Agent (history, session file) from the manager.
+    auto provider_chain = std::make_shared<ProviderChain>(cfg);
 
-    // Register memory_search tool with provider chain
-    register_memory_search_tool(tools, search_store, &agent.provider_chain(), cfg.embedding);
+    // Memory tools embed through the chain (and its embedding cache)
+    register_memory_tool(tools, ws, search_store, provider_chain.get(), &cfg.embedding);
+    register_memory_search_tool(tools, search_store, provider_chain.get(), cfg.embedding);
 
-    std::mutex agent_mutex;
+    ConversationManager conversations(cfg, tools, provider_chain, skills);
+    std::cerr << "[gateway] Conversations: up to " << cfg.conversations.max_concurrent
+              << " concurrent, " << cfg.conversations.max_conversations << " cached\n";
 
     auto handle_message = [&](const InboundMessage& msg) -> std::string {
-        std::lock_guard<std::mutex> lock(agent_mutex);
-        return agent.run(msg.text);
+        return conversations.run(ConversationManager::key_for(msg.channel, msg.user), msg.text,
+                                 RunOptions{msg.bypass_cache, msg.cancel, msg.timeout});
     };
 
     // Cron runner
@@ -73,8 +76,8 @@ int cmd_gateway(const std::string& host, int port) {
     CronStore cron_store(db_path);
     CronRunner cron_runner(cron_store, [&](const CronJob& job) {
         std::cerr << "[cron] Firing job: " << job.name << " - " << job.message << "\n";
-        std::lock_guard<std::mutex> lock(agent_mutex);
-        std::string reply = agent.run("[cron:" + job.name + "] " + job.message);
+        std::string reply = conversations.run(ConversationManager::key_for("cron", job.name),
+                                              "[cron:" + job.name + "] " + job.message);
         std::cerr << "[cron] Reply: " << reply << "\n";
     });
     cron_runner.start();
@@ -82,8 +85,7 @@ int cmd_gateway(const std::string& host, int port) {
 
     // Heartbeat service
     HeartbeatService heartbeat(ws, [&](const std::string& msg) -> std::string {
-        std::lock_guard<std::mutex> lock(agent_mutex);
-        return agent.run(msg);
+        return conversations.run(ConversationManager::key_for("heartbeat", "main"), msg);
     });
     heartbeat.start();
     std::cerr << "[gateway] Heartbeat service started\n";
@@ -94,6 +96,10 @@ int cmd_gateway(const std::string& host, int port) {
     }
 
     HTTPChannel http_ch(host, port, cfg.http_channel);
+    http_ch.set_stream_handler([&](const InboundMessage& msg, const AgentEventSink& sink) {
+        return conversations.run_stream(ConversationManager::key_for(msg.channel, msg.user),
+                                        msg.text, sink, RunOptions{msg.bypass_cache, msg.cancel, msg.timeout});
+    });
     if (http_ch.enabled()) {
         http_ch.start(handle_message);
         std::cerr << "[gateway] HTTP channel started on " << host << ":" << port << "\n";
@@ -0,0 +1,162 @@
+#include "gitignore.hpp"
+#include "utils.hpp"
+
+namespace minidragon {
+
+// ── wildmatch ───────────────────────────────────────────────────────
+
+// [...] at p (just past '['); advances p past the class
+static bool match_class(const char*& p, char c) {
+    bool negate = (*p == '!' || *p == '^');
+    if (negate) p++;
+    bool hit = false;
+    bool first = true;
+    while (*p && (first || *p != ']')) {
+        first = false;
+        char lo = *p;
+        if (lo == '\\' && p[1]) lo = *++p;
+        char hi = lo;
+        if (p[1] == '-' && p[2] && p[2] != ']') {
+            hi = p[2];
+            p += 2;
+        }
+        if (c >= lo && c <= hi) hit = true;
+        p++;
+    }
+    if (*p == ']') p++;
+    return hit != negate;
+}
+
+bool wildmatch(const char* p, const char* s) {
+    while (*p) {
+        if (*p == '*') {
+            if (p[1] == '*') {
+                while (*p == '*') p++;
+                if (!*p) return true;  // trailing "**": everything below
+                if (*p == '/') {
+                    // "**/": zero or more whole directories
+                    for (const char* t = s;; t++) {
+                        if ((t == s || t[-1] == '/') && wildmatch(p + 1, t)) return true;
+                        if (!*t) return false;
+                    }
+                }
+                // "**" inside a component behaves like "*"
+            } else {
+                p++;
+            }
+            for (const char* t = s;; t++) {
+                if (wildmatch(p, t)) return true;
+                if (!*t || *t == '/') return false;
+            }
+        }
+        if (!*s) return false;
+        if (*p == '?') {
+            if (*s == '/') return false;
+        } else if (*p == '[') {
+            if (*s == '/') return false;
+            p++;
+            if (!match_class(p, *s)) return false;
+            s++;
+            continue;
+        } else {
+            if (*p == '\\' && p[1]) p++;
+            if (*p != *s) return false;
+        }
+        p++;
+        s++;
+    }
+    return !*s;
+}
+
+// ── IgnoreRules ─────────────────────────────────────────────────────
+
+std::vector<IgnoreRules::Rule> IgnoreRules::parse(const std::string& text) {
+    std::vector<Rule> rules;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) eol = text.size();
+        std::string line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        // Trailing spaces are dropped unless escaped
+        while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') continue;
+
+        Rule r;
+        if (line[0] == '!') {
+            r.negate = true;
+            line.erase(0, 1);
+        } else if (line[0] == '\\' && line.size() > 1 && (line[1] == '#' || line[1] == '!')) {
+            line.erase(0, 1);
+        }
+        if (!line.empty() && line.back() == '/') {
+            r.dir_only = true;
+            line.pop_back();
+        }
+        if (line.empty()) continue;
+        r.anchored = line.find('/') != std::string::npos;
+        if (line[0] == '/') line.erase(0, 1);
+        r.pattern = std::move(line);
+        rules.push_back(std::move(r));
+    }
+    return rules;
+}
+
+IgnoreRules::Ptr IgnoreRules::load(const std::string& dir, Ptr parent) {
+    std::error_code ec;
+    std::string file = dir + "/.gitignore";
+    if (!fs::is_regular_file(file, ec)) return parent;
+    auto rules = parse(read_file(file));
+    if (rules.empty()) return parent;
+
+    auto node = std::make_shared<IgnoreRules>();
+    node->dir_ = dir;
+    node->rules_ = std::move(rules);
+    node->parent_ = std::move(parent);
+    return node;
+}
+
+IgnoreRules::Ptr IgnoreRules::for_root(const std::string& root) {
+    std::error_code ec;
+
+    // Directories from root up to the work tree top (if any)
+    std::vector<fs::path> dirs;
+    bool in_repo = false;
+    for (fs::path d = fs::path(root); !d.empty(); d = d.parent_path()) {
+        dirs.push_back(d);
+        if (fs::exists(d / ".git", ec)) {
+            in_repo = true;
+            break;
+        }
+        if (d == d.parent_path()) break;
+    }
+    if (!in_repo) dirs.resize(1);
+
+    Ptr rules;
+    for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+        rules = load(it->generic_string(), std::move(rules));
+    }
+    return rules;
+}
+
+bool IgnoreRules::ignored(const Ptr& rules, const std::string& path, bool is_dir) {
+    for (const IgnoreRules* node = rules.get(); node; node = node->parent_.get()) {
+        const std::string& dir = node->dir_;
+        if (path.size() <= dir.size() || path.compare(0, dir.size(), dir) != 0 || path[dir.size()] != '/') continue;
+        std::string rel = path.substr(dir.size() + 1);
+        size_t slash = rel.rfind('/');
+        const char* base = rel.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+
+        for (auto it = node->rules_.rbegin(); it != node->rules_.rend(); ++it) {
+            if (it->dir_only && !is_dir) continue;
+            if (wildmatch(it->pattern.c_str(), it->anchored ? rel.c_str() : base)) return !it->negate;
+        }
+    }
+    return false;
+}
+
+} // namespace minidragon
@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace minidragon {
+
+// Shell-style match as git does it: '*', '?' and '[...]' stay within one
+// path component, '**' spans components ("**/x", "a/**", "a/**/b").
+bool wildmatch(const char* pattern, const char* text);
+
+// The .gitignore rules of one directory, chained to those of its parents.
+// Patterns follow git: '#' comments, '!' re-includes, a trailing '/'
+// matches directories only, and a '/' anywhere else anchors the pattern to
+// the directory holding the file (otherwise it matches the name at any
+// depth). Deeper files win, and within a file the last matching line wins.
+// Walkers prune ignored directories, which also gives git's rule that
+// nothing below an excluded directory can be re-included.
+class IgnoreRules {
+public:
+    using Ptr = std::shared_ptr<const IgnoreRules>;
+
+    // Adds <dir>/.gitignore on top of parent; returns parent unchanged when
+    // the directory has none. dir uses '/' separators.
+    static Ptr load(const std::string& dir, Ptr parent);
+
+    // Rules in effect for root: every .gitignore from the enclosing git
+    // work tree's top down to root itself (just root's outside a repo).
+    // root must be canonical ('/'-separated, absolute, no trailing '/') and
+    // so must the paths later checked against the result.
+    static Ptr for_root(const std::string& root);
+
+    // path: '/'-separated, below this chain's directory
+    static bool ignored(const Ptr& rules, const std::string& path, bool is_dir);
+
+private:
+    struct Rule {
+        std::string pattern;
+        bool negate = false;
+        bool dir_only = false;
+        bool anchored = false;
+    };
+
+    std::string dir_;
+    std::vector<Rule> rules_;
+    Ptr parent_;
+
+    static std::vector<Rule> parse(const std::string& text);
+};
+
+} // namespace minidragon
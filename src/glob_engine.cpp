@@ -0,0 +1,242 @@
+#include "glob_engine.hpp"
+#include "gitignore.hpp"
+#include "utils.hpp"
+#include <algorithm>
+
+namespace minidragon {
+
+// ── Compiling ───────────────────────────────────────────────────────
+
+// Appends every expansion of the {a,b} groups in p; false past the limit
+static bool expand_braces(const std::string& p, std::vector<std::string>& out) {
+    for (size_t i = 0; i < p.size(); i++) {
+        if (p[i] == '\\') {
+            i++;
+            continue;
+        }
+        if (p[i] == '[') {
+            // Braces inside a character class are plain characters
+            size_t j = i + 1;
+            if (j < p.size() && (p[j] == '!' || p[j] == '^')) j++;
+            if (j < p.size() && p[j] == ']') j++;
+            while (j < p.size() && p[j] != ']') j++;
+            if (j < p.size()) i = j;
+            continue;
+        }
+        if (p[i] != '{') continue;
+
+        int depth = 0;
+        size_t close = std::string::npos;
+        std::vector<size_t> commas;
+        for (size_t j = i; j < p.size(); j++) {
+            if (p[j] == '\\') {
+                j++;
+            } else if (p[j] == '{') {
+                depth++;
+            } else if (p[j] == '}') {
+                if (--depth == 0) {
+                    close = j;
+                    break;
+                }
+            } else if (p[j] == ',' && depth == 1) {
+                commas.push_back(j);
+            }
+        }
+        if (close == std::string::npos) break;  // unbalanced: the rest is literal
+        if (commas.empty()) continue;           // "{x}" is literal too
+
+        std::string prefix = p.substr(0, i), suffix = p.substr(close + 1);
+        commas.push_back(close);
+        size_t from = i + 1;
+        for (size_t c : commas) {
+            if (!expand_braces(prefix + p.substr(from, c - from) + suffix, out)) return false;
+            from = c + 1;
+        }
+        return true;
+    }
+    if (out.size() >= GlobPattern::kMaxAlternatives) return false;
+    out.push_back(p);
+    return true;
+}
+
+std::unique_ptr<GlobPattern> GlobPattern::compile(const std::string& pattern, std::string& error) {
+    std::vector<std::string> expanded;
+    if (!expand_braces(pattern, expanded)) {
+        error = "more than " + std::to_string(kMaxAlternatives) + " {...} alternatives";
+        return nullptr;
+    }
+
+    auto glob = std::unique_ptr<GlobPattern>(new GlobPattern());
+    for (auto& alt : expanded) {
+        // Empty and "." components ("./src//x") say nothing
+        std::vector<std::string> comps;
+        size_t pos = 0;
+        while (pos <= alt.size()) {
+            size_t slash = alt.find('/', pos);
+            if (slash == std::string::npos) slash = alt.size();
+            std::string comp = alt.substr(pos, slash - pos);
+            pos = slash + 1;
+            if (comp.empty() || comp == ".") continue;
+            if (comp == "**" && !comps.empty() && comps.back() == "**") continue;
+            if (comp[0] == '.') glob->hidden_ = true;
+            comps.push_back(std::move(comp));
+        }
+        if (comps.empty()) continue;
+        if (alt.find('/') == std::string::npos && comps[0] != "**") comps.insert(comps.begin(), "**");
+        glob->alts_.push_back(std::move(comps));
+    }
+    if (glob->alts_.empty()) {
+        error = "empty pattern";
+        return nullptr;
+    }
+    return glob;
+}
+
+// ── Matching ────────────────────────────────────────────────────────
+
+static inline uint32_t pos_code(size_t alt, size_t comp) { return static_cast<uint32_t>(alt << 16 | comp); }
+static inline size_t pos_alt(uint32_t code) { return code >> 16; }
+static inline size_t pos_comp(uint32_t code) { return code & 0xFFFF; }
+
+// One component; wildcards skip names starting with '.'
+static bool component_match(const std::string& comp, const std::string& name) {
+    if (name[0] == '.' && comp[0] != '.' && comp.compare(0, 2, "\\.") != 0) return false;
+    return wildmatch(comp.c_str(), name.c_str());
+}
+
+// Adds the positions reachable by letting a '**' match nothing
+void GlobPattern::close(State& s) const {
+    for (size_t k = 0; k < s.size(); k++) {
+        size_t a = pos_alt(s[k]), i = pos_comp(s[k]);
+        if (i < alts_[a].size() && alts_[a][i] == "**") s.push_back(pos_code(a, i + 1));
+    }
+    std::sort(s.begin(), s.end());
+    s.erase(std::unique(s.begin(), s.end()), s.end());
+}
+
+GlobPattern::State GlobPattern::start() const {
+    State s;
+    for (size_t a = 0; a < alts_.size(); a++) s.push_back(pos_code(a, 0));
+    close(s);
+    return s;
+}
+
+GlobPattern::State GlobPattern::step(const State& s, const std::string& name) const {
+    State next;
+    if (name.empty()) return next;
+    for (uint32_t code : s) {
+        const auto& comps = alts_[pos_alt(code)];
+        size_t i = pos_comp(code);
+        if (i >= comps.size()) continue;
+        if (comps[i] == "**") {
+            if (name[0] != '.') next.push_back(code);
+        } else if (component_match(comps[i], name)) {
+            next.push_back(code + 1);
+        }
+    }
+    close(next);
+    return next;
+}
+
+bool GlobPattern::accepts(const State& s) const {
+    for (uint32_t code : s) {
+        if (pos_comp(code) == alts_[pos_alt(code)].size()) return true;
+    }
+    return false;
+}
+
+bool GlobPattern::can_descend(const State& s) const {
+    for (uint32_t code : s) {
+        if (pos_comp(code) < alts_[pos_alt(code)].size()) return true;
+    }
+    return false;
+}
+
+bool GlobPattern::match(const std::string& path) const {
+    State s = start();
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t slash = path.find('/', pos);
+        if (slash == std::string::npos) slash = path.size();
+        s = step(s, path.substr(pos, slash - pos));
+        if (s.empty()) return false;
+        pos = slash + 1;
+    }
+    return accepts(s);
+}
+
+bool GlobPattern::mentions(const std::string& name) const {
+    for (auto& comps : alts_) {
+        if (std::find(comps.begin(), comps.end(), name) != comps.end()) return true;
+    }
+    return false;
+}
+
+bool GlobPattern::names(const State& s, const std::string& name) const {
+    for (uint32_t code : s) {
+        const auto& comps = alts_[pos_alt(code)];
+        if (pos_comp(code) < comps.size() && comps[pos_comp(code)] == name) return true;
+    }
+    return false;
+}
+
+// ── Walk ────────────────────────────────────────────────────────────
+
+bool glob_skipped_dir(const std::string& name) {
+    return name == ".git" || name == "node_modules";
+}
+
+static void walk(const std::string& dir, const std::string& rel, const IgnoreRules::Ptr& rules,
+                 const GlobPattern::State& state, const GlobPattern& pattern, const GlobOptions& opts,
+                 std::vector<std::string>& out) {
+    if (opts.cancel && opts.cancel->cancelled()) return;
+
+    struct Entry {
+        std::string name;
+        bool is_dir;
+        GlobPattern::State state;
+    };
+    std::vector<Entry> entries;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name == ".git") continue;
+        // Ask the pattern first: most entries of a pruned walk stop here
+        GlobPattern::State next = pattern.step(state, name);
+        if (next.empty()) continue;
+        std::error_code type_ec;
+        bool is_dir = !it->is_symlink(type_ec) && it->is_directory(type_ec);
+        if (is_dir ? !pattern.can_descend(next) : !pattern.accepts(next) || !it->is_regular_file(type_ec)) continue;
+        entries.push_back({std::move(name), is_dir, std::move(next)});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+    for (auto& e : entries) {
+        std::string path = dir + "/" + e.name;
+        if (e.is_dir) {
+            if (opts.respect_gitignore && ((glob_skipped_dir(e.name) && !pattern.names(state, e.name)) ||
+                                           IgnoreRules::ignored(rules, path, true))) {
+                continue;
+            }
+            walk(path, rel + e.name + "/", opts.respect_gitignore ? IgnoreRules::load(path, rules) : rules, e.state,
+                 pattern, opts, out);
+        } else if (!opts.respect_gitignore || !IgnoreRules::ignored(rules, path, false)) {
+            out.push_back(rel + e.name);
+        }
+    }
+}
+
+std::vector<std::string> glob_search(const std::string& root, const GlobPattern& pattern, const GlobOptions& opts) {
+    // Canonical, so .gitignore files above root line up (see IgnoreRules::for_root)
+    std::error_code ec;
+    std::string dir = fs::weakly_canonical(fs::path(root), ec).generic_string();
+    if (ec || dir.empty()) dir = fs::path(root).generic_string();
+    while (dir.size() > 1 && dir.back() == '/') dir.pop_back();
+
+    std::vector<std::string> out;
+    walk(dir, "", opts.respect_gitignore ? IgnoreRules::for_root(dir) : nullptr, pattern.start(), pattern, opts, out);
+    return out;
+}
+
+} // namespace minidragon
@@ -0,0 +1,66 @@
+#pragma once
+#include "cancel.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace minidragon {
+
+// A compiled glob over '/'-separated relative paths: '*', '?' and '[...]'
+// within one component, '**' for any number of components, '{a,b}'
+// alternatives (nestable), '\' to escape. Like the shell, wildcards do not
+// match a leading '.' of a name, so hidden entries need an explicit '.'.
+// A pattern without '/' matches file names at any depth ("*.cpp" is
+// "**/*.cpp").
+//
+// Matching goes one path component at a time, which lets a walker drop a
+// directory as soon as no file below it can match.
+class GlobPattern {
+public:
+    // nullptr and a message in error if the pattern is empty or expands to
+    // too many alternatives
+    static std::unique_ptr<GlobPattern> compile(const std::string& pattern, std::string& error);
+
+    // Progress through the pattern: the (alternative, component) positions
+    // still alive after the components seen so far
+    using State = std::vector<uint32_t>;
+
+    State start() const;
+    State step(const State& s, const std::string& name) const;
+    bool accepts(const State& s) const;      // a file here matches
+    bool can_descend(const State& s) const;  // something below this directory may match
+
+    bool match(const std::string& path) const;
+    // Whether any component could match a hidden name
+    bool may_match_hidden() const { return hidden_; }
+    // Whether some component is exactly name, no wildcards ("node_modules"
+    // in "node_modules/*/package.json"); names() asks the same at s
+    bool mentions(const std::string& name) const;
+    bool names(const State& s, const std::string& name) const;
+
+    static constexpr size_t kMaxAlternatives = 256;
+
+private:
+    std::vector<std::vector<std::string>> alts_;  // components per alternative; "**" kept as is
+    bool hidden_ = false;
+
+    void close(State& s) const;
+};
+
+struct GlobOptions {
+    // Skip .gitignore'd paths, and node_modules directories the pattern does
+    // not name explicitly (.git always is)
+    bool respect_gitignore = true;
+    CancelToken* cancel = nullptr;
+};
+
+// Files below root matching pattern, relative to root, in sorted walk order
+// (names sorted within each directory). Only directories the pattern can
+// still match are entered; symlinked directories are not followed.
+std::vector<std::string> glob_search(const std::string& root, const GlobPattern& pattern, const GlobOptions& opts);
+
+// Directories glob_search never enters when respecting ignores
+bool glob_skipped_dir(const std::string& name);
+
+} // namespace minidragon
@@ -0,0 +1,358 @@
+#include "grep_engine.hpp"
+#include "text_search.hpp"
+#include "gitignore.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+namespace minidragon {
+
+// ── File contents ───────────────────────────────────────────────────
+
+// A file's bytes for one search, in blocks of whole lines. Files are read
+// rather than mapped: an agent may truncate a file while it is searched,
+// and touching a mapping past the new end raises SIGBUS.
+class FileReader {
+public:
+    FileReader() = default;
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+    ~FileReader() {
+#ifndef _WIN32
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+
+    bool open(const std::string& path) {
+#ifdef _WIN32
+        file_.open(path, std::ios::binary);
+        if (!file_) return false;
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) return false;
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+#endif
+        buffer_.clear();
+        return true;
+    }
+
+    // Next block, ending with '\n' unless it is the end of the file
+    bool next(const char*& data, size_t& n) {
+        buffer_.erase(0, used_);
+        used_ = 0;
+        for (;;) {
+            size_t old = buffer_.size();
+            if (!eof_) fill(kBlockSize);
+            if (eof_) {
+                if (buffer_.empty()) return false;
+                used_ = buffer_.size();
+                break;
+            }
+            // Only the new bytes can hold a newline
+            size_t last = std::string_view(buffer_).substr(old).rfind('\n');
+            if (last != std::string_view::npos) {
+                used_ = old + last + 1;
+                break;
+            }
+        }
+        data = buffer_.data();
+        n = used_;
+        return true;
+    }
+
+    // Whether a NUL shows up in the first kSniffBytes bytes; valid after
+    // the first next()
+    bool binary() const { return binary_; }
+
+private:
+    static constexpr size_t kSniffBytes = 8192;
+    static constexpr size_t kBlockSize = 256 * 1024;
+    std::string& buffer_ = thread_buffer();
+    size_t used_ = 0;  // bytes handed out by the last next()
+    bool eof_ = false;
+    bool sniffed_ = false;
+    bool binary_ = false;
+#ifdef _WIN32
+    std::ifstream file_;
+#else
+    int fd_ = -1;
+#endif
+
+    // Reused across files, so small files cost no allocation
+    static std::string& thread_buffer() {
+        thread_local std::string buffer;
+        return buffer;
+    }
+
+    // Appends up to want bytes; sets eof_ on end of file or a read error
+    void fill(size_t want) {
+        size_t old = buffer_.size();
+        buffer_.resize(old + want);
+        size_t got = 0;
+#ifdef _WIN32
+        file_.read(&buffer_[old], static_cast<std::streamsize>(want));
+        got = static_cast<size_t>(file_.gcount());
+        if (got < want) eof_ = true;
+#else
+        while (got < want) {
+            ssize_t r = read(fd_, &buffer_[old + got], want - got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) {
+                eof_ = true;
+                break;
+            }
+            got += static_cast<size_t>(r);
+        }
+#endif
+        buffer_.resize(old + got);
+        if (!sniffed_) {
+            sniffed_ = true;
+            binary_ = std::memchr(buffer_.data(), 0, std::min(buffer_.size(), kSniffBytes)) != nullptr;
+        }
+    }
+};
+
+// ── Walk ────────────────────────────────────────────────────────────
+
+static void walk(const std::string& dir, size_t root_len, const IgnoreRules::Ptr& rules, const GrepOptions& opts,
+                 std::vector<std::string>& files) {
+    if (opts.cancel && opts.cancel->cancelled()) return;
+
+    struct Entry {
+        std::string name;
+        bool is_dir;
+    };
+    std::vector<Entry> entries;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name == ".git" || (!opts.include_hidden && name[0] == '.')) continue;
+        std::error_code type_ec;
+        if (it->is_symlink(type_ec)) {
+            // Linked files are searched, linked directories are not (cycles)
+            if (it->is_regular_file(type_ec)) entries.push_back({std::move(name), false});
+        } else if (it->is_directory(type_ec)) {
+            entries.push_back({std::move(name), true});
+        } else if (it->is_regular_file(type_ec)) {
+            entries.push_back({std::move(name), false});
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+    for (auto& e : entries) {
+        std::string path = dir + "/" + e.name;
+        if (opts.respect_gitignore && IgnoreRules::ignored(rules, path, e.is_dir)) continue;
+        if (e.is_dir) {
+            walk(path, root_len, opts.respect_gitignore ? IgnoreRules::load(path, rules) : rules, opts, files);
+        } else if (!opts.file_filter || opts.file_filter(path.substr(root_len + 1))) {
+            files.push_back(std::move(path));
+        }
+    }
+}
+
+// ── Search ──────────────────────────────────────────────────────────
+
+// Size of the file's block in format_grep_files()
+static size_t listing_size(const GrepFile& f) {
+    size_t n = f.path.size() + 3;
+    for (auto& l : f.lines) n += std::to_string(l.number).size() + l.text.size() + 5;
+    return n;
+}
+
+// Line text to show: whole, or a window around the match for long lines
+static std::string display_line(const char* line, size_t len, size_t match_off, size_t max_len) {
+    if (len > 0 && line[len - 1] == '\r') len--;
+    if (max_len == 0 || len <= max_len) return std::string(line, len);
+    size_t from = match_off > max_len / 4 ? match_off - max_len / 4 : 0;
+    from = std::min(from, len - max_len);
+    // Do not start or end inside a UTF-8 sequence
+    while (from > 0 && (static_cast<unsigned char>(line[from]) & 0xC0) == 0x80) from--;
+    size_t to = std::min(len, from + max_len);
+    while (to < len && (static_cast<unsigned char>(line[to]) & 0xC0) == 0x80) to++;
+    std::string out;
+    if (from > 0) out += "...";
+    out.append(line + from, to - from);
+    if (to < len) out += "...";
+    return out;
+}
+
+enum class FileStatus : char { pending, searched, binary, unreadable };
+
+// searcher finds candidate lines (every line is one when null); matcher,
+// if set, has the final say on each candidate
+static FileStatus search_file(const std::string& path, const LiteralSearcher* searcher, RegexMatcher* matcher,
+                              const GrepOptions& opts, GrepFile& out) {
+    FileReader file;
+    if (!file.open(path)) return FileStatus::unreadable;
+    const char* data;
+    size_t n;
+    if (!file.next(data, n)) return FileStatus::searched;  // empty
+    if (file.binary()) return FileStatus::binary;
+
+    out.path = path;
+    uint32_t line_no = 1;    // of the line at counted
+    size_t bytes = 0;
+    do {
+        size_t pos = 0;      // always at a line start
+        size_t counted = 0;  // newlines counted up to here
+        while (pos < n) {
+            size_t hit = pos;
+            if (searcher) {
+                hit = searcher->find(data + pos, n - pos);
+                if (hit == n - pos) break;
+                hit += pos;
+            }
+
+            size_t start = hit;
+            while (start > pos && data[start - 1] != '\n') start--;
+            const char* nl = static_cast<const char*>(std::memchr(data + hit, '\n', n - hit));
+            size_t end = nl ? static_cast<size_t>(nl - data) : n;
+            if (matcher) {
+                size_t len = end - start;
+                if (len > 0 && data[end - 1] == '\r') len--;
+                if (!matcher->match_line(data + start, len)) {
+                    pos = end + 1;
+                    continue;
+                }
+            }
+            line_no += static_cast<uint32_t>(std::count(data + counted, data + start, '\n'));
+            counted = start;
+
+            out.lines.push_back({line_no, display_line(data + start, end - start, hit - start, opts.max_line_length)});
+            bytes += out.lines.back().text.size();
+            if (opts.max_output && bytes > opts.max_output) return FileStatus::searched;
+            pos = end + 1;
+        }
+        line_no += static_cast<uint32_t>(std::count(data + counted, data + n, '\n'));
+    } while (file.next(data, n));
+    return FileStatus::searched;
+}
+
+bool grep_search(const std::string& path, const GrepOptions& opts, GrepResult& out) {
+    out = GrepResult{};
+    std::error_code ec;
+    std::unique_ptr<LiteralSearcher> searcher;
+    if (!opts.regex) {
+        searcher = std::make_unique<LiteralSearcher>(opts.pattern, opts.ignore_case);
+    } else if (!opts.regex->required_literal().empty()) {
+        searcher = std::make_unique<LiteralSearcher>(opts.regex->required_literal(), opts.regex->ignore_case());
+    }
+    bool verify = opts.regex && !opts.regex->is_literal();
+
+    std::vector<std::string> files;
+    if (fs::is_regular_file(path, ec)) {
+        files.push_back(path);
+    } else if (fs::is_directory(path, ec)) {
+        std::string shown = path;
+        while (shown.size() > 1 && (shown.back() == '/' || shown.back() == '\\')) shown.pop_back();
+        if (opts.files) {
+            for (auto& rel : *opts.files) {
+                if (opts.file_filter && !opts.file_filter(rel)) continue;
+                files.push_back(shown + "/" + rel);
+            }
+        } else {
+            // Walk the canonical path so .gitignore files above it line up,
+            // but report paths the way the caller spelled the root
+            std::string root = fs::weakly_canonical(fs::path(path), ec).generic_string();
+            if (ec || root.empty()) root = fs::path(path).generic_string();
+            while (root.size() > 1 && root.back() == '/') root.pop_back();
+            auto rules = opts.respect_gitignore ? IgnoreRules::for_root(root) : nullptr;
+            walk(root, root.size(), rules, opts, files);
+            if (shown != root) {
+                for (auto& f : files) f = shown + f.substr(root.size());
+            }
+        }
+    } else {
+        return false;
+    }
+
+    // Workers take files in walk order. Once the finished prefix of the list
+    // fills the output limit, files past it are skipped and later dropped.
+    size_t count = files.size();
+    std::vector<GrepFile> results(count);
+    std::vector<FileStatus> status(count, FileStatus::pending);
+    std::vector<size_t> sizes(count, 0);
+    std::mutex mutex;
+    // Matchers carry their DFA cache from file to file; one per busy worker
+    std::vector<std::unique_ptr<RegexMatcher>> matchers;
+    size_t frontier = 0, prefix_bytes = 0;
+    std::atomic<size_t> stop_at{count};
+    auto stop_before = [&](size_t i) {
+        size_t cur = stop_at.load();
+        while (i < cur && !stop_at.compare_exchange_weak(cur, i)) {}
+    };
+
+    int threads = opts.threads > 0 ? opts.threads
+                                   : static_cast<int>(std::min(16u, std::max(1u, std::thread::hardware_concurrency())));
+    parallel_for(count, threads, [&](size_t i) {
+        if (i >= stop_at.load(std::memory_order_relaxed)) return;
+        if (opts.cancel && opts.cancel->cancelled()) {
+            stop_before(i);
+            return;
+        }
+        std::unique_ptr<RegexMatcher> matcher;
+        if (verify) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!matchers.empty()) {
+                matcher = std::move(matchers.back());
+                matchers.pop_back();
+            }
+        }
+        if (verify && !matcher) matcher = std::make_unique<RegexMatcher>(*opts.regex);
+        FileStatus st = search_file(files[i], searcher.get(), matcher.get(), opts, results[i]);
+        size_t size = results[i].lines.empty() ? 0 : listing_size(results[i]);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (matcher) matchers.push_back(std::move(matcher));
+        status[i] = st;
+        sizes[i] = size;
+        while (frontier < count && status[frontier] != FileStatus::pending) {
+            prefix_bytes += sizes[frontier++];
+            if (opts.max_output && prefix_bytes >= opts.max_output) {
+                stop_before(frontier);
+                break;
+            }
+        }
+    });
+
+    // Every file before the cut has been searched by now
+    size_t end = std::min(stop_at.load(), count);
+    for (size_t i = 0; i < end; i++) {
+        if (status[i] == FileStatus::searched) out.files_searched++;
+        if (status[i] == FileStatus::binary) out.binary_skipped++;
+        if (results[i].lines.empty()) continue;
+        out.match_count += results[i].lines.size();
+        out.files.push_back(std::move(results[i]));
+    }
+    out.truncated = end < count;
+    return true;
+}
+
+std::string format_grep_files(const GrepResult& result) {
+    std::string out;
+    for (auto& f : result.files) {
+        out += "\n" + f.path + ":\n";
+        for (auto& l : f.lines) {
+            out += "  " + std::to_string(l.number) + ": " + l.text + "\n";
+        }
+    }
+    return out;
+}
+
+} // namespace minidragon
@@ -0,0 +1,65 @@
+#pragma once
+#include "cancel.hpp"
+#include "regex_engine.hpp"
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace minidragon {
+
+struct GrepOptions {
+    std::string pattern;  // literal text
+    const Regex* regex = nullptr;  // when set, lines must match it and pattern is unused
+    bool ignore_case = true;
+    // Keeps a file when it returns true for its path relative to the searched
+    // directory (e.g. "src/main.cpp"); empty = all files
+    std::function<bool(const std::string& rel)> file_filter;
+    // Files to search, relative to a directory path, instead of walking it
+    // (e.g. WorkspaceIndex candidates); file_filter still applies
+    const std::vector<std::string>* files = nullptr;
+    bool respect_gitignore = true;
+    bool include_hidden = false;   // dot files and directories
+    size_t max_output = 0;         // stop once the listing reaches this size (0 = no limit)
+    size_t max_line_length = 400;  // longer lines are shown as a window around the match
+    int threads = 0;               // 0 = one per core, at most 16
+    CancelToken* cancel = nullptr;
+};
+
+struct GrepLine {
+    uint32_t number;
+    std::string text;
+};
+
+struct GrepFile {
+    std::string path;
+    std::vector<GrepLine> lines;
+};
+
+struct GrepResult {
+    std::vector<GrepFile> files;  // in path order, only files with matches
+    size_t match_count = 0;
+    size_t files_searched = 0;
+    size_t binary_skipped = 0;
+    bool truncated = false;       // output limit hit (or cancelled) before the end
+};
+
+// Searches one file, or every file below a directory. The tree is walked
+// in sorted order (hidden entries and .gitignore'd paths pruned), then the
+// files are searched in parallel: each worker reads its file in 256 KiB
+// blocks cut at line ends, skips it if the first 8 KiB contain a NUL byte,
+// and scans each block with a LiteralSearcher. A regex search scans for the
+// regex's required literal the same way and runs the automaton only on
+// lines that contain it (on every line when it has none). Results are
+// merged in walk order, and the output limit cuts at the same file a
+// sequential search would, so the listing does not depend on thread
+// timing. Returns false if path does not exist.
+bool grep_search(const std::string& path, const GrepOptions& opts, GrepResult& out);
+
+// The listing grep_file shows, one "<path>:" block per file:
+//   <path>:
+//     <line>: <text>
+std::string format_grep_files(const GrepResult& result);
+
+} // namespace minidragon
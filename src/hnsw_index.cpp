@@ -0,0 +1,320 @@
+#include "hnsw_index.hpp"
+#include "config.hpp"
+#include "vec_kernels.hpp"
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+namespace minidragon {
+
+HnswIndex::HnswIndex(int dimensions, const VectorIndexConfig& cfg)
+    : dims_(dimensions)
+    , m_(std::max(cfg.m, 2))
+    , m0_(2 * std::max(cfg.m, 2))
+    , ef_construction_(std::max(cfg.ef_construction, 1))
+    , level_mult_(1.0 / std::log(static_cast<double>(std::max(cfg.m, 2)))) {}
+
+void HnswIndex::clear() {
+    nodes_.clear();
+    data_.clear();
+    visited_.clear();
+    watermark_ = 0;
+    max_level_ = -1;
+    entry_ = 0;
+}
+
+float HnswIndex::distance(const float* a, const float* b) const {
+    return 1.0f - dot_product(a, b, dims_);
+}
+
+int HnswIndex::random_level() {
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    double r = uni(rng_);
+    if (r <= 0.0) r = 1e-12;
+    return static_cast<int>(-std::log(r) * level_mult_);
+}
+
+// ── Graph search ────────────────────────────────────────────────────
+
+std::vector<HnswIndex::Scored> HnswIndex::search_layer(const float* q, uint32_t entry,
+                                                       size_t ef, int level) const {
+    if (visited_.size() < nodes_.size()) visited_.resize(nodes_.size(), 0);
+    if (++visit_epoch_ == 0) {  // wrapped: reset marks
+        std::fill(visited_.begin(), visited_.end(), 0);
+        visit_epoch_ = 1;
+    }
+
+    // candidates: closest first; results: farthest first (bounded to ef)
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored>> candidates;
+    std::priority_queue<Scored> results;
+
+    float d = distance(q, vec(entry));
+    candidates.push({d, entry});
+    results.push({d, entry});
+    visited_[entry] = visit_epoch_;
+
+    while (!candidates.empty()) {
+        auto [cd, c] = candidates.top();
+        if (cd > results.top().first && results.size() >= ef) break;
+        candidates.pop();
+
+        for (uint32_t nb : nodes_[c].links[level]) {
+            if (visited_[nb] == visit_epoch_) continue;
+            visited_[nb] = visit_epoch_;
+            float nd = distance(q, vec(nb));
+            if (results.size() < ef || nd < results.top().first) {
+                candidates.push({nd, nb});
+                results.push({nd, nb});
+                if (results.size() > ef) results.pop();
+            }
+        }
+    }
+
+    std::vector<Scored> out;
+    out.reserve(results.size());
+    while (!results.empty()) { out.push_back(results.top()); results.pop(); }
+    std::reverse(out.begin(), out.end());  // closest first
+    return out;
+}
+
+// Keep a candidate only if it is closer to the base than to every neighbour
+// already kept — spreads links across directions instead of one cluster.
+void HnswIndex::select_neighbors(std::vector<Scored>& candidates, size_t max_count) const {
+    if (candidates.size() <= max_count) return;
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<Scored> kept;
+    std::vector<Scored> pruned;
+    for (auto& c : candidates) {
+        if (kept.size() >= max_count) break;
+        bool good = true;
+        for (auto& k : kept) {
+            if (distance(vec(c.second), vec(k.second)) < c.first) { good = false; break; }
+        }
+        if (good) kept.push_back(c);
+        else pruned.push_back(c);
+    }
+    // Top up with the closest pruned ones so nodes keep full degree
+    for (auto& p : pruned) {
+        if (kept.size() >= max_count) break;
+        kept.push_back(p);
+    }
+    candidates.swap(kept);
+}
+
+void HnswIndex::connect(uint32_t from, uint32_t to, int level) {
+    auto& links = nodes_[from].links[level];
+    size_t max_links = level == 0 ? m0_ : m_;
+    links.push_back(to);
+    if (links.size() <= max_links) return;
+
+    std::vector<Scored> scored;
+    scored.reserve(links.size());
+    for (uint32_t nb : links) scored.push_back({distance(vec(from), vec(nb)), nb});
+    select_neighbors(scored, max_links);
+    links.clear();
+    for (auto& s : scored) links.push_back(s.second);
+}
+
+// ── Insert / query ──────────────────────────────────────────────────
+
+bool HnswIndex::add(int64_t id, const float* v, size_t dims) {
+    if (static_cast<int>(dims) != dims_ || dims == 0) return false;
+
+    uint32_t node = static_cast<uint32_t>(nodes_.size());
+    size_t off = data_.size();
+    data_.insert(data_.end(), v, v + dims);
+    if (!normalize_vector(data_.data() + off, dims)) {
+        data_.resize(off);
+        return false;
+    }
+
+    int level = random_level();
+    nodes_.push_back({id, std::vector<std::vector<uint32_t>>(level + 1)});
+    watermark_ = std::max(watermark_, id);
+
+    if (max_level_ < 0) {
+        entry_ = node;
+        max_level_ = level;
+        return true;
+    }
+
+    const float* q = vec(node);
+    uint32_t ep = entry_;
+
+    // Greedy descent through levels above the new node's top level
+    for (int l = max_level_; l > level; l--) {
+        bool changed = true;
+        float best = distance(q, vec(ep));
+        while (changed) {
+            changed = false;
+            for (uint32_t nb : nodes_[ep].links[l]) {
+                float d = distance(q, vec(nb));
+                if (d < best) { best = d; ep = nb; changed = true; }
+            }
+        }
+    }
+
+    for (int l = std::min(level, max_level_); l >= 0; l--) {
+        auto candidates = search_layer(q, ep, ef_construction_, l);
+        ep = candidates.front().second;
+        select_neighbors(candidates, m_);
+        for (auto& c : candidates) {
+            nodes_[node].links[l].push_back(c.second);
+            connect(c.second, node, l);
+        }
+    }
+
+    if (level > max_level_) {
+        max_level_ = level;
+        entry_ = node;
+    }
+    return true;
+}
+
+std::vector<std::pair<int64_t, float>> HnswIndex::search(const float* query, size_t dims,
+                                                         size_t k, size_t ef) const {
+    std::vector<std::pair<int64_t, float>> out;
+    if (nodes_.empty() || static_cast<int>(dims) != dims_ || k == 0) return out;
+
+    std::vector<float> q(query, query + dims);
+    if (!normalize_vector(q.data(), dims)) return out;
+
+    uint32_t ep = entry_;
+    for (int l = max_level_; l > 0; l--) {
+        bool changed = true;
+        float best = distance(q.data(), vec(ep));
+        while (changed) {
+            changed = false;
+            for (uint32_t nb : nodes_[ep].links[l]) {
+                float d = distance(q.data(), vec(nb));
+                if (d < best) { best = d; ep = nb; changed = true; }
+            }
+        }
+    }
+
+    auto found = search_layer(q.data(), ep, std::max(ef, k), 0);
+    for (size_t i = 0; i < found.size() && i < k; i++) {
+        out.push_back({nodes_[found[i].second].id, 1.0f - found[i].first});
+    }
+    return out;
+}
+
+// ── Persistence ─────────────────────────────────────────────────────
+
+static constexpr char kMagic[8] = {'M', 'D', 'H', 'N', 'S', 'W', '1', '\0'};
+
+template <typename T>
+static void put(std::string& out, const T& v) { out.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+template <typename T>
+static bool get(std::ifstream& f, T& v) { return static_cast<bool>(f.read(reinterpret_cast<char*>(&v), sizeof(T))); }
+
+std::string HnswIndex::serialize() const {
+    std::string out;
+    size_t links = 0;
+    for (auto& n : nodes_) {
+        for (auto& level : n.links) links += level.size() + 1;
+    }
+    out.reserve(64 + data_.size() * sizeof(float) + nodes_.size() * 12 + links * sizeof(uint32_t));
+    out.append(kMagic, sizeof(kMagic));
+    put(out, static_cast<int32_t>(dims_));
+    put(out, static_cast<int32_t>(m_));
+    put(out, static_cast<uint64_t>(nodes_.size()));
+    put(out, static_cast<int32_t>(max_level_));
+    put(out, entry_);
+    put(out, watermark_);
+    out.append(reinterpret_cast<const char*>(data_.data()), data_.size() * sizeof(float));
+    for (auto& n : nodes_) {
+        put(out, n.id);
+        put(out, static_cast<int32_t>(n.links.size()));
+        for (auto& level : n.links) {
+            put(out, static_cast<uint32_t>(level.size()));
+            out.append(reinterpret_cast<const char*>(level.data()), level.size() * sizeof(uint32_t));
+        }
+    }
+    return out;
+}
+
+bool HnswIndex::write_snapshot(const std::string& path, const std::string& bytes) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        f.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!f) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+bool HnswIndex::save(const std::string& path) const {
+    return write_snapshot(path, serialize());
+}
+
+bool HnswIndex::load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+
+    char magic[8];
+    int32_t dims = 0, m = 0, max_level = -1;
+    uint64_t count = 0;
+    uint32_t entry = 0;
+    int64_t watermark = 0;
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    if (!f.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) return false;
+    if (!get(f, dims) || !get(f, m) || !get(f, count) || !get(f, max_level) ||
+        !get(f, entry) || !get(f, watermark)) return false;
+    // A different M or dimension means the snapshot is stale: rebuild
+    if (dims != dims_ || m != m_ || (count > 0 && entry >= count)) return false;
+    // Check the counts against the bytes left before allocating: a node
+    // takes at least its vector, id, level count and one link count
+    uint64_t header = static_cast<uint64_t>(f.tellg());
+    uint64_t min_node = static_cast<uint64_t>(dims) * sizeof(float) + sizeof(int64_t) + 2 * sizeof(int32_t);
+    if (max_level < -1 || max_level > 64 || file_size < header || count > (file_size - header) / min_node) {
+        return false;
+    }
+
+    std::vector<float> data(count * dims);
+    if (!f.read(reinterpret_cast<char*>(data.data()),
+                static_cast<std::streamsize>(data.size() * sizeof(float)))) return false;
+
+    std::vector<Node> nodes(count);
+    for (auto& n : nodes) {
+        int32_t levels = 0;
+        if (!get(f, n.id) || !get(f, levels) || levels < 1 || levels > 64) return false;
+        n.links.resize(levels);
+        for (auto& level : n.links) {
+            uint32_t sz = 0;
+            if (!get(f, sz) || sz > static_cast<uint32_t>(m0_)) return false;
+            level.resize(sz);
+            if (!f.read(reinterpret_cast<char*>(level.data()),
+                        static_cast<std::streamsize>(sz * sizeof(uint32_t)))) return false;
+            for (uint32_t nb : level) if (nb >= count) return false;
+        }
+    }
+
+    // Every link on level l must point at a node that exists on level l
+    if (count > 0 && nodes[entry].links.size() != static_cast<size_t>(max_level) + 1) return false;
+    for (auto& n : nodes) {
+        for (size_t l = 0; l < n.links.size(); l++) {
+            for (uint32_t nb : n.links[l]) if (nodes[nb].links.size() <= l) return false;
+        }
+    }
+
+    nodes_ = std::move(nodes);
+    data_ = std::move(data);
+    max_level_ = count ? max_level : -1;
+    entry_ = entry;
+    watermark_ = watermark;
+    visited_.clear();
+    return true;
+}
+
+} // namespace minidragon
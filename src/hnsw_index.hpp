@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <random>
+#include <utility>
+
+namespace minidragon {
+
+struct VectorIndexConfig;
+
+// Hierarchical Navigable Small World graph for approximate nearest-neighbour
+// search over embeddings (Malkov & Yashunin). Vectors are L2-normalized on
+// insert so similarity is a plain dot product (= cosine). Not thread-safe;
+// the owner serializes access.
+class HnswIndex {
+public:
+    HnswIndex(int dimensions, const VectorIndexConfig& cfg);
+
+    // Insert one vector under an external id. Vectors of the wrong
+    // dimension are ignored (returns false).
+    bool add(int64_t id, const float* vec, size_t dims);
+
+    // Top-k by cosine similarity, best first. ef widens the beam (>= k).
+    std::vector<std::pair<int64_t, float>> search(const float* query, size_t dims,
+                                                  size_t k, size_t ef) const;
+
+    size_t size() const { return nodes_.size(); }
+    int dimensions() const { return dims_; }
+    void clear();
+
+    // Highest id added so far; lets the owner catch up on rows written
+    // after the index was last saved.
+    int64_t watermark() const { return watermark_; }
+
+    // Binary snapshot; save() writes to a temp file and renames it over path.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    // save() in two steps, so the owner can serialize under its lock and
+    // write the bytes after releasing it
+    std::string serialize() const;
+    static bool write_snapshot(const std::string& path, const std::string& bytes);
+
+private:
+    struct Node {
+        int64_t id;
+        std::vector<std::vector<uint32_t>> links;  // links[level]
+    };
+    using Scored = std::pair<float, uint32_t>;      // (distance, node)
+
+    int dims_;
+    int m_;
+    int m0_;                 // max links on level 0 (2*M)
+    int ef_construction_;
+    double level_mult_;
+
+    std::vector<Node> nodes_;
+    std::vector<float> data_;  // nodes_.size() * dims_, normalized
+    int64_t watermark_ = 0;
+    int max_level_ = -1;
+    uint32_t entry_ = 0;
+    std::mt19937 rng_{0x5eed};
+
+    // Visited marks, reused across searches (epoch trick avoids clearing)
+    mutable std::vector<uint32_t> visited_;
+    mutable uint32_t visit_epoch_ = 0;
+
+    const float* vec(uint32_t n) const { return data_.data() + static_cast<size_t>(n) * dims_; }
+    float distance(const float* a, const float* b) const;
+    int random_level();
+
+    std::vector<Scored> search_layer(const float* q, uint32_t entry, size_t ef, int level) const;
+    void select_neighbors(std::vector<Scored>& candidates, size_t max_count) const;
+    void connect(uint32_t from, uint32_t to, int level);
+};
+
+} // namespace minidragon
@@ -0,0 +1,59 @@
+#include "http_pool.hpp"
+
+namespace minidragon {
+
+HttpClientPool::HttpClientPool(const std::string& base_url, const HttpPoolConfig& cfg)
+    : base_url_(base_url), config_(cfg) {
+    if (config_.size < 1) config_.size = 1;
+}
+
+std::unique_ptr<httplib::Client> HttpClientPool::make_client() const {
+    auto cli = std::make_unique<httplib::Client>(base_url_);
+    cli->set_keep_alive(true);
+    cli->set_tcp_nodelay(true);
+    cli->set_connection_timeout(30);
+    return cli;
+}
+
+HttpClientPool::Lease HttpClientPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        auto max_idle = std::chrono::seconds(config_.idle_timeout);
+
+        // Expired entries sit at the front (least recently used first)
+        size_t expired = 0;
+        while (expired < idle_.size() && now - idle_[expired].last_used > max_idle) expired++;
+        if (expired > 0) idle_.erase(idle_.begin(), idle_.begin() + expired);
+
+        if (!idle_.empty()) {
+            auto cli = std::move(idle_.back().client);
+            idle_.pop_back();
+            hits_++;
+            return Lease(this, std::move(cli));
+        }
+    }
+    misses_++;
+    return Lease(this, make_client());
+}
+
+void HttpClientPool::release(std::unique_ptr<httplib::Client> client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (static_cast<int>(idle_.size()) >= config_.size) {
+        // Pool full — evict the coldest client to keep the warm one
+        idle_.erase(idle_.begin());
+    }
+    idle_.push_back({std::move(client), std::chrono::steady_clock::now()});
+}
+
+HttpPoolStats HttpClientPool::stats() const {
+    HttpPoolStats s;
+    s.hits = hits_;
+    s.misses = misses_;
+    s.discarded = discarded_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.idle = idle_.size();
+    return s;
+}
+
+} // namespace minidragon
@@ -0,0 +1,75 @@
+#pragma once
+#include "config.hpp"
+#include <httplib.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace minidragon {
+
+struct HttpPoolStats {
+    uint64_t hits = 0;       // acquire() served by a warm idle client
+    uint64_t misses = 0;     // acquire() had to open a new client
+    uint64_t discarded = 0;  // clients dropped after a connection error
+    size_t idle = 0;         // clients currently parked in the pool
+};
+
+// Pool of keep-alive httplib clients for one base URL.
+// httplib::Client serializes requests on a single socket, so concurrent
+// callers each lease their own client; returned clients keep their TCP
+// (and TLS) connection open for the next caller.
+class HttpClientPool {
+public:
+    HttpClientPool(const std::string& base_url, const HttpPoolConfig& cfg);
+
+    HttpClientPool(const HttpClientPool&) = delete;
+    HttpClientPool& operator=(const HttpClientPool&) = delete;
+
+    class Lease {
+    public:
+        Lease(HttpClientPool* pool, std::unique_ptr<httplib::Client> client)
+            : pool_(pool), client_(std::move(client)) {}
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease() { if (pool_ && client_) pool_->release(std::move(client_)); }
+
+        httplib::Client* operator->() { return client_.get(); }
+        httplib::Client& operator*() { return *client_; }
+
+        // Drop the client instead of returning it (socket state unknown)
+        void discard() {
+            if (pool_ && client_) pool_->discarded_++;
+            client_.reset();
+        }
+
+    private:
+        HttpClientPool* pool_;
+        std::unique_ptr<httplib::Client> client_;
+    };
+
+    Lease acquire();
+    HttpPoolStats stats() const;
+
+private:
+    struct IdleClient {
+        std::unique_ptr<httplib::Client> client;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    std::string base_url_;
+    HttpPoolConfig config_;
+    mutable std::mutex mutex_;
+    std::vector<IdleClient> idle_;  // most recently used at the back
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> discarded_{0};
+
+    std::unique_ptr<httplib::Client> make_client() const;
+    void release(std::unique_ptr<httplib::Client> client);
+};
+
+} // namespace minidragon
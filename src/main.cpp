@@ -7,6 +7,8 @@
 #include "gateway.hpp"
 #include "status.hpp"
 #include "cron_cmd.hpp"
+#include "bench.hpp"
+#include "memory_cmd.hpp"
 
 static void print_usage() {
     std::cout << "Usage: minidragon <command> [options]\n\n"
@@ -22,6 +24,9 @@ static void print_usage() {
               << "  sessions [list|show DATE|clear]\n"
               << "                              Manage session history\n"
               << "  cron add|list|remove        Manage cron jobs\n"
+              << "  memory stats|reindex        Inspect or rebuild the memory vector index\n"
+              << "  bench tokenizer|vectors|responses\n"
+              << "                              Run micro-benchmarks\n"
               << "  version                     Show version info\n";
 }
 
@@ -95,6 +100,12 @@ int main(int argc, char* argv[]) {
     else if (cmd == "cron") {
         return minidragon::cmd_cron(args);
     }
+    else if (cmd == "memory") {
+        return minidragon::cmd_memory(args);
+    }
+    else if (cmd == "bench") {
+        return minidragon::cmd_bench(args);
+    }
     else if (cmd == "version" || cmd == "--version" || cmd == "-v") {
         std::cout << "minidragon " << MINIDRAGON_VERSION << "\n";
         return 0;
@@ -129,7 +129,9 @@ void McpClient::disconnect() {
     }
 }
 
-std::string McpClient::read_line() {
+std::string McpClient::read_line(CancelToken*) {
+    // Blocking pipe reads cannot be interrupted here; send_request() checks
+    // the token between lines
     std::string line;
     char ch;
     DWORD bytes_read;
@@ -203,6 +205,12 @@ bool McpClient::connect() {
     child_pid_ = pid;
     stdin_fd_ = pipe_stdin[1];
     stdout_fd_ = pipe_stdout[0];
+    if (pipe(wake_fd_) == 0) {
+        fcntl(wake_fd_[0], F_SETFL, O_NONBLOCK);
+        fcntl(wake_fd_[1], F_SETFL, O_NONBLOCK);
+    } else {
+        wake_fd_[0] = wake_fd_[1] = -1;
+    }
 
     // Send initialize
     auto init_result = send_request("initialize", {
@@ -233,6 +241,10 @@ void McpClient::disconnect() {
         close(stdout_fd_);
         stdout_fd_ = -1;
     }
+    for (int& fd : wake_fd_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
     if (child_pid_ > 0) {
         kill(child_pid_, SIGTERM);
         int status;
@@ -250,18 +262,23 @@ void McpClient::disconnect() {
     }
 }
 
-std::string McpClient::read_line() {
+std::string McpClient::read_line(CancelToken* cancel) {
     std::string line;
     char ch;
 
-    // Use poll with a 30s timeout
-    struct pollfd pfd;
-    pfd.fd = stdout_fd_;
-    pfd.events = POLLIN;
+    // Use poll with a 30s timeout; a byte on the wake pipe means cancelled
+    struct pollfd pfds[2];
+    pfds[0].fd = stdout_fd_;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = wake_fd_[0];
+    pfds[1].events = POLLIN;
+    nfds_t nfds = wake_fd_[0] >= 0 ? 2 : 1;
 
     while (true) {
-        int ret = poll(&pfd, 1, 30000);
+        if (cancel && cancel->cancelled()) break;
+        int ret = poll(pfds, nfds, 30000);
         if (ret <= 0) break; // timeout or error
+        if (nfds == 2 && pfds[1].revents) break;
 
         ssize_t n = read(stdout_fd_, &ch, 1);
         if (n <= 0) break;
@@ -285,8 +302,19 @@ void McpClient::write_line(const std::string& json_str) {
 
 // ── Common methods ──
 
-nlohmann::json McpClient::send_request(const std::string& method, const nlohmann::json& params) {
+nlohmann::json McpClient::send_request(const std::string& method, const nlohmann::json& params,
+                                       CancelToken* cancel) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
     int id = next_id_++;
+#ifndef _WIN32
+    char drain[64];
+    while (wake_fd_[0] >= 0 && read(wake_fd_[0], drain, sizeof(drain)) > 0) {}
+    int wake = wake_fd_[1];
+    CancelScope scope(cancel, [wake] {
+        char b = 1;
+        if (wake >= 0) (void)!write(wake, &b, 1);
+    });
+#endif
     nlohmann::json req = {
         {"jsonrpc", "2.0"},
         {"id", id},
@@ -300,7 +328,16 @@ nlohmann::json McpClient::send_request(const std::string& method, const nlohmann
 
     // Read response lines until we get one with matching id
     for (int attempt = 0; attempt < 100; attempt++) {
-        std::string line = read_line();
+        if (cancel && cancel->cancelled()) {
+            // A late reply is skipped by the id match of the next request
+            write_line(nlohmann::json({
+                {"jsonrpc", "2.0"},
+                {"method", "notifications/cancelled"},
+                {"params", {{"requestId", id}, {"reason", cancel->reason()}}}
+            }).dump());
+            return {{"error", {{"message", "request cancelled (" + cancel->reason() + ")"}}}};
+        }
+        std::string line = read_line(cancel);
         if (line.empty()) continue;
 
         try {
@@ -320,6 +357,7 @@ nlohmann::json McpClient::send_request(const std::string& method, const nlohmann
 }
 
 void McpClient::send_notification(const std::string& method, const nlohmann::json& params) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
     nlohmann::json notif = {
         {"jsonrpc", "2.0"},
         {"method", method}
@@ -350,11 +388,12 @@ std::vector<ToolDef> McpClient::list_tools() {
     return tools;
 }
 
-std::string McpClient::call_tool(const std::string& tool_name, const nlohmann::json& args) {
+std::string McpClient::call_tool(const std::string& tool_name, const nlohmann::json& args,
+                                 CancelToken* cancel) {
     auto result = send_request("tools/call", {
         {"name", tool_name},
         {"arguments", args}
-    });
+    }, cancel);
 
     if (result.is_null()) return "[error] MCP tool call returned null";
 
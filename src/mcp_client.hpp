@@ -1,10 +1,12 @@
 #pragma once
 #include "config.hpp"
 #include "tool_registry.hpp"
+#include "cancel.hpp"
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 
 #ifdef _WIN32
@@ -26,7 +28,9 @@ public:
     void disconnect();
 
     std::vector<ToolDef> list_tools();
-    std::string call_tool(const std::string& tool_name, const nlohmann::json& args);
+    // cancel: stop waiting for the reply and tell the server to abandon it
+    std::string call_tool(const std::string& tool_name, const nlohmann::json& args,
+                          CancelToken* cancel = nullptr);
 
     const std::string& name() const { return name_; }
     bool connected() const { return connected_; }
@@ -36,6 +40,7 @@ private:
     McpServerConfig config_;
     bool connected_ = false;
     int next_id_ = 1;
+    std::mutex io_mutex_;  // one request/response exchange on the pipe at a time
 
 #ifdef _WIN32
     HANDLE child_process_ = INVALID_HANDLE_VALUE;
@@ -45,11 +50,13 @@ private:
     pid_t child_pid_ = -1;
     int stdin_fd_ = -1;
     int stdout_fd_ = -1;
+    int wake_fd_[2] = {-1, -1};  // written on cancel to interrupt read_line()'s poll
 #endif
 
-    nlohmann::json send_request(const std::string& method, const nlohmann::json& params);
+    nlohmann::json send_request(const std::string& method, const nlohmann::json& params,
+                                CancelToken* cancel = nullptr);
     void send_notification(const std::string& method, const nlohmann::json& params = {});
-    std::string read_line();
+    std::string read_line(CancelToken* cancel = nullptr);
     void write_line(const std::string& json_str);
 };
 
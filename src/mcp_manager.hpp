@@ -50,8 +50,9 @@ public:
                 def.name = prefixed_name;
                 def.description = "[MCP:" + server_name + "] " + tool.description;
                 def.parameters = tool.parameters;
-                def.func = [client_ptr, orig_name](const nlohmann::json& args) -> std::string {
-                    return client_ptr->call_tool(orig_name, args);
+                def.context_func = [client_ptr, orig_name](const nlohmann::json& args,
+                                                           const ToolContext& ctx) -> std::string {
+                    return client_ptr->call_tool(orig_name, args, ctx.cancel);
                 };
                 reg.register_tool(std::move(def));
                 std::cerr << "[mcp] Registered tool: " << prefixed_name << "\n";
@@ -0,0 +1,44 @@
+#include "memory_cmd.hpp"
+#include "memory_search.hpp"
+#include "config.hpp"
+#include "utils.hpp"
+#include <iostream>
+#include <chrono>
+
+namespace minidragon {
+
+int cmd_memory(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "Usage: minidragon memory <stats|reindex>\n";
+        return 1;
+    }
+
+    Config cfg = Config::load(default_config_path());
+    std::string db_path = cfg.workspace_path() + "/memory/search.db";
+    std::string subcmd = args[0];
+
+    if (subcmd == "stats") {
+        MemorySearchStore store(db_path, cfg.embedding.dimensions, cfg.embedding.index);
+        std::cout << "Database   : " << db_path << "\n"
+                  << "Dimensions : " << cfg.embedding.dimensions << "\n"
+                  << "HNSW       : M=" << cfg.embedding.index.m
+                  << " ef_construction=" << cfg.embedding.index.ef_construction
+                  << " ef_search=" << cfg.embedding.index.ef_search << "\n"
+                  << "Indexed    : " << store.index_size() << " vectors\n";
+        return 0;
+    }
+
+    if (subcmd == "reindex") {
+        MemorySearchStore store(db_path, cfg.embedding.dimensions, cfg.embedding.index);
+        auto start = std::chrono::steady_clock::now();
+        size_t n = store.rebuild_index();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Rebuilt vector index: " << n << " vectors in " << secs << "s\n";
+        return 0;
+    }
+
+    std::cerr << "Unknown memory command: " << subcmd << "\n";
+    return 1;
+}
+
+} // namespace minidragon
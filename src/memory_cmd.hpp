@@ -0,0 +1,7 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace minidragon {
+int cmd_memory(const std::vector<std::string>& args);
+} // namespace minidragon
@@ -1,5 +1,6 @@
 #include "memory_search.hpp"
 #include "utils.hpp"
+#include "vec_kernels.hpp"
 #include <sqlite3.h>
 #include <cmath>
 #include <cstring>
@@ -10,8 +11,9 @@
 
 namespace minidragon {
 
-MemorySearchStore::MemorySearchStore(const std::string& db_path, int dimensions)
-    : dimensions_(dimensions) {
+MemorySearchStore::MemorySearchStore(const std::string& db_path, int dimensions,
+                                     const VectorIndexConfig& index_cfg)
+    : dimensions_(dimensions), index_cfg_(index_cfg) {
     fs::create_directories(fs::path(db_path).parent_path());
 
     sqlite3_initialize();  // Ensure FTS5 extension is registered
@@ -24,12 +26,122 @@ MemorySearchStore::MemorySearchStore(const std::string& db_path, int dimensions)
     }
 
     init_tables();
+    normalize_stored_embeddings();
+
+    index_path_ = (fs::path(db_path).parent_path() / fs::path(db_path).stem()).string() + ".hnsw";
+    index_ = std::make_unique<HnswIndex>(dimensions_, index_cfg_);
+    if (!index_->load(index_path_)) index_->clear();
+    Snapshot snap;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (catch_up_index_locked() == 0 || !snapshot_index_locked(false, snap)) return;
+    }
+    write_snapshot(snap);
 }
 
 MemorySearchStore::~MemorySearchStore() {
+    if (index_ && unsaved_ > 0) index_->save(index_path_);
     if (db_) sqlite3_close(db_);
 }
 
+// ── Vector index ────────────────────────────────────────────────────
+
+// Insert every embedded row newer than the index watermark
+size_t MemorySearchStore::catch_up_index_locked() {
+    if (!db_ || !index_) return 0;
+    const char* sql = "SELECT id, embedding FROM memories WHERE embedding IS NOT NULL AND id > ? ORDER BY id";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return 0;
+    sqlite3_bind_int64(stmt, 1, index_->watermark());
+
+    size_t added = 0;
+    std::vector<float> vec;  // blobs carry no alignment guarantee
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const void* blob = sqlite3_column_blob(stmt, 1);
+        int bytes = sqlite3_column_bytes(stmt, 1);
+        if (!blob || bytes <= 0) continue;
+        vec.resize(bytes / sizeof(float));
+        std::memcpy(vec.data(), blob, vec.size() * sizeof(float));
+        if (index_->add(sqlite3_column_int64(stmt, 0), vec.data(), vec.size())) added++;
+    }
+    sqlite3_finalize(stmt);
+    unsaved_ += added;
+    return added;
+}
+
+bool MemorySearchStore::snapshot_index_locked(bool force, Snapshot& out) {
+    // Snapshot cost grows with the index, so space snapshots out in
+    // proportion; rows added after a snapshot are replayed on next open.
+    if (!force && unsaved_ < std::max<size_t>(256, index_->size() / 8)) return false;
+    out.bytes = index_->serialize();
+    out.seq = ++snapshot_seq_;
+    out.rows = unsaved_;
+    unsaved_ = 0;
+    return true;
+}
+
+void MemorySearchStore::write_snapshot(const Snapshot& snap) {
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(save_mutex_);
+        if (snap.seq < written_seq_) return;  // a newer one is on disk already
+        ok = HnswIndex::write_snapshot(index_path_, snap.bytes);
+        if (ok) written_seq_ = snap.seq;
+    }
+    if (!ok) {
+        std::cerr << "[memory_search] Failed to write " << index_path_ << "\n";
+        std::lock_guard<std::mutex> lock(mutex_);
+        unsaved_ += snap.rows;  // retried with the next snapshot
+    }
+}
+
+size_t MemorySearchStore::rebuild_index() {
+    Snapshot snap;
+    size_t size;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!index_) return 0;
+        index_->clear();
+        catch_up_index_locked();
+        snapshot_index_locked(true, snap);
+        size = index_->size();
+    }
+    write_snapshot(snap);
+    return size;
+}
+
+size_t MemorySearchStore::index_size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_ ? index_->size() : 0;
+}
+
+void MemorySearchStore::save_index() {
+    Snapshot snap;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!index_ || unsaved_ == 0 || !snapshot_index_locked(true, snap)) return;
+    }
+    write_snapshot(snap);
+}
+
+bool MemorySearchStore::fetch_entry_locked(int64_t id, MemoryEntry& out) {
+    const char* sql = "SELECT content, source, created_at FROM memories WHERE id = ?";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    sqlite3_bind_int64(stmt, 1, id);
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        out.id = id;
+        out.content = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        const char* src = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        out.source = src ? src : "";
+        out.created_at = sqlite3_column_int64(stmt, 2);
+        found = true;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
 void MemorySearchStore::init_tables() {
     if (!db_) return;
 
@@ -70,67 +182,102 @@ void MemorySearchStore::init_tables() {
     }
 }
 
+// Schema v1 stores embeddings unit-length. Databases written before that
+// are normalized once in place, tracked through PRAGMA user_version.
+void MemorySearchStore::normalize_stored_embeddings() {
+    sqlite3_stmt* stmt = nullptr;
+    int version = 0;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (version >= 1) return;
+
+    sqlite3_stmt* sel = nullptr;
+    sqlite3_stmt* upd = nullptr;
+    sqlite3_prepare_v2(db_, "SELECT id, embedding FROM memories WHERE embedding IS NOT NULL", -1, &sel, nullptr);
+    sqlite3_prepare_v2(db_, "UPDATE memories SET embedding = ? WHERE id = ?", -1, &upd, nullptr);
+    sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr);
+    std::vector<float> v;
+    while (sqlite3_step(sel) == SQLITE_ROW) {
+        const void* blob = sqlite3_column_blob(sel, 1);
+        size_t dims = sqlite3_column_bytes(sel, 1) / sizeof(float);
+        if (!blob || dims == 0) continue;
+        v.resize(dims);
+        std::memcpy(v.data(), blob, dims * sizeof(float));
+        if (!normalize_vector(v.data(), dims)) continue;
+        sqlite3_reset(upd);
+        sqlite3_bind_blob(upd, 1, v.data(), static_cast<int>(dims * sizeof(float)), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(upd, 2, sqlite3_column_int64(sel, 0));
+        sqlite3_step(upd);
+    }
+    sqlite3_finalize(sel);
+    sqlite3_finalize(upd);
+    sqlite3_exec(db_, "PRAGMA user_version = 1", nullptr, nullptr, nullptr);
+    sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+}
+
 std::vector<uint8_t> MemorySearchStore::vector_to_blob(const std::vector<float>& v) {
     std::vector<uint8_t> blob(v.size() * sizeof(float));
     std::memcpy(blob.data(), v.data(), blob.size());
     return blob;
 }
 
-std::vector<float> MemorySearchStore::blob_to_vector(const void* data, int bytes) {
-    int count = bytes / static_cast<int>(sizeof(float));
-    std::vector<float> v(count);
-    std::memcpy(v.data(), data, count * sizeof(float));
-    return v;
-}
-
-float MemorySearchStore::cosine_similarity(const std::vector<float>& a,
-                                            const std::vector<float>& b) {
-    if (a.size() != b.size() || a.empty()) return 0.0f;
-
-    float dot = 0.0f, norm_a = 0.0f, norm_b = 0.0f;
-    for (size_t i = 0; i < a.size(); i++) {
-        dot += a[i] * b[i];
-        norm_a += a[i] * a[i];
-        norm_b += b[i] * b[i];
-    }
-
-    float denom = std::sqrt(norm_a) * std::sqrt(norm_b);
-    if (denom < 1e-8f) return 0.0f;
-    return dot / denom;
-}
-
 void MemorySearchStore::upsert(const std::string& content, const std::string& source,
                                 const std::vector<float>& embedding) {
     if (!db_) return;
+    Snapshot snap;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!insert_locked(content, source, embedding) || !snapshot_index_locked(false, snap)) return;
+    }
+    write_snapshot(snap);
+}
 
+// Stores one row; true if it also went into the vector index
+bool MemorySearchStore::insert_locked(const std::string& content, const std::string& source,
+                                      const std::vector<float>& embedding) {
     const char* sql = "INSERT INTO memories (content, source, created_at, embedding) VALUES (?, ?, ?, ?)";
     sqlite3_stmt* stmt = nullptr;
     if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "[memory_search] upsert prepare error: " << sqlite3_errmsg(db_) << "\n";
-        return;
+        return false;
     }
 
     sqlite3_bind_text(stmt, 1, content.c_str(), static_cast<int>(content.size()), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 2, source.c_str(), static_cast<int>(source.size()), SQLITE_TRANSIENT);
     sqlite3_bind_int64(stmt, 3, epoch_now());
 
-    if (!embedding.empty()) {
-        auto blob = vector_to_blob(embedding);
+    // Stored unit-length so search scores are a single dot product
+    std::vector<float> unit = embedding;
+    if (!unit.empty() && normalize_vector(unit.data(), unit.size())) {
+        auto blob = vector_to_blob(unit);
         sqlite3_bind_blob(stmt, 4, blob.data(), static_cast<int>(blob.size()), SQLITE_TRANSIENT);
     } else {
+        unit.clear();
         sqlite3_bind_null(stmt, 4);
     }
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "[memory_search] upsert error: " << sqlite3_errmsg(db_) << "\n";
+        sqlite3_finalize(stmt);
+        return false;
     }
     sqlite3_finalize(stmt);
+
+    if (!index_ || unit.empty() || !index_->add(sqlite3_last_insert_rowid(db_), unit.data(), unit.size())) {
+        return false;
+    }
+    unsaved_++;
+    return true;
 }
 
 std::vector<MemoryEntry> MemorySearchStore::search(const std::string& query,
                                                      const std::vector<float>& query_embedding,
                                                      int limit) {
     if (!db_) return {};
+    std::lock_guard<std::mutex> lock(mutex_);
 
     // Step 1: Get candidate rows via FTS5 (top N*3 to have room for re-ranking)
     int candidate_limit = limit * 3;
@@ -147,7 +294,7 @@ std::vector<MemoryEntry> MemorySearchStore::search(const std::string& query,
     sqlite3_stmt* stmt = nullptr;
     if (sqlite3_prepare_v2(db_, fts_sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "[memory_search] FTS prepare error: " << sqlite3_errmsg(db_) << "\n";
-        return search_text(query, limit);  // fallback
+        return search_text_locked(query, limit);  // fallback
     }
 
     sqlite3_bind_text(stmt, 1, query.c_str(), static_cast<int>(query.size()), SQLITE_TRANSIENT);
@@ -159,6 +306,13 @@ std::vector<MemoryEntry> MemorySearchStore::search(const std::string& query,
         float vector_score;
     };
     std::vector<Candidate> candidates;
+    std::vector<float> stored;  // current row's embedding, copied out of the blob
+
+    // Normalize the query once; stored blobs are already unit-length
+    std::vector<float> query_unit = query_embedding;
+    if (!query_unit.empty() && !normalize_vector(query_unit.data(), query_unit.size())) {
+        query_unit.clear();
+    }
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         Candidate c;
@@ -174,14 +328,17 @@ std::vector<MemoryEntry> MemorySearchStore::search(const std::string& query,
 
         // Vector score
         c.vector_score = 0.0f;
-        if (sqlite3_column_type(stmt, 4) == SQLITE_BLOB && !query_embedding.empty()) {
+        if (sqlite3_column_type(stmt, 4) == SQLITE_BLOB && !query_unit.empty()) {
+            // SQLite's blob buffer is not necessarily float-aligned: copy
+            // it into a reused buffer before reading it as floats
             const void* blob_data = sqlite3_column_blob(stmt, 4);
-            int blob_bytes = sqlite3_column_bytes(stmt, 4);
-            if (blob_data && blob_bytes > 0) {
-                auto row_embedding = blob_to_vector(blob_data, blob_bytes);
-                c.vector_score = cosine_similarity(query_embedding, row_embedding);
+            size_t blob_dims = sqlite3_column_bytes(stmt, 4) / sizeof(float);
+            if (blob_data && blob_dims == query_unit.size()) {
+                stored.resize(blob_dims);
+                std::memcpy(stored.data(), blob_data, blob_dims * sizeof(float));
+                float cosine = dot_product(query_unit.data(), stored.data(), blob_dims);
                 // Normalize to [0,1] — cosine similarity is already [-1,1], shift to [0,1]
-                c.vector_score = (c.vector_score + 1.0f) / 2.0f;
+                c.vector_score = (cosine + 1.0f) / 2.0f;
             }
         }
 
@@ -191,41 +348,23 @@ std::vector<MemoryEntry> MemorySearchStore::search(const std::string& query,
     }
     sqlite3_finalize(stmt);
 
-    // Also fetch rows that have embeddings but didn't match FTS (pure vector search)
-    if (!query_embedding.empty()) {
-        const char* vec_sql = "SELECT id, content, source, created_at, embedding FROM memories WHERE embedding IS NOT NULL LIMIT 100";
-        if (sqlite3_prepare_v2(db_, vec_sql, -1, &stmt, nullptr) == SQLITE_OK) {
-            std::set<int64_t> seen;
-            for (auto& c : candidates) seen.insert(c.entry.id);
-
-            while (sqlite3_step(stmt) == SQLITE_ROW) {
-                int64_t id = sqlite3_column_int64(stmt, 0);
-                if (seen.count(id)) continue;
-
-                Candidate c;
-                c.entry.id = id;
-                c.entry.content = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-                const char* src = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-                c.entry.source = src ? src : "";
-                c.entry.created_at = sqlite3_column_int64(stmt, 3);
-                c.fts_score = 0.0f;
-
-                const void* blob_data = sqlite3_column_blob(stmt, 4);
-                int blob_bytes = sqlite3_column_bytes(stmt, 4);
-                if (blob_data && blob_bytes > 0) {
-                    auto row_embedding = blob_to_vector(blob_data, blob_bytes);
-                    c.vector_score = cosine_similarity(query_embedding, row_embedding);
-                    c.vector_score = (c.vector_score + 1.0f) / 2.0f;
-                } else {
-                    c.vector_score = 0.0f;
-                }
-
-                c.entry.score = 0.7f * c.vector_score + 0.3f * c.fts_score;
-                if (c.entry.score > 0.3f) {  // threshold to avoid noise
-                    candidates.push_back(std::move(c));
-                }
-            }
-            sqlite3_finalize(stmt);
+    // Pure vector candidates from the HNSW index (rows FTS did not match)
+    if (!query_unit.empty() && index_ && index_->size() > 0) {
+        std::set<int64_t> seen;
+        for (auto& c : candidates) seen.insert(c.entry.id);
+
+        size_t ef = std::max<size_t>(index_cfg_.ef_search, candidate_limit);
+        auto hits = index_->search(query_unit.data(), query_unit.size(), candidate_limit, ef);
+        for (auto& [id, sim] : hits) {
+            if (seen.count(id)) continue;
+
+            Candidate c;
+            c.fts_score = 0.0f;
+            c.vector_score = (sim + 1.0f) / 2.0f;
+            c.entry.score = 0.7f * c.vector_score + 0.3f * c.fts_score;
+            if (c.entry.score <= 0.3f) continue;  // threshold to avoid noise
+            if (!fetch_entry_locked(id, c.entry)) continue;  // row deleted since indexing
+            candidates.push_back(std::move(c));
         }
     }
 
@@ -242,6 +381,11 @@ std::vector<MemoryEntry> MemorySearchStore::search(const std::string& query,
 
 std::vector<MemoryEntry> MemorySearchStore::search_text(const std::string& query, int limit) {
     if (!db_) return {};
+    std::lock_guard<std::mutex> lock(mutex_);
+    return search_text_locked(query, limit);
+}
+
+std::vector<MemoryEntry> MemorySearchStore::search_text_locked(const std::string& query, int limit) {
 
     const char* sql = R"SQL(
         SELECT m.id, m.content, m.source, m.created_at, rank
@@ -2,6 +2,10 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <mutex>
+#include <memory>
+#include "config.hpp"
+#include "hnsw_index.hpp"
 
 struct sqlite3;
 
@@ -17,7 +21,11 @@ struct MemoryEntry {
 
 class MemorySearchStore {
 public:
-    MemorySearchStore(const std::string& db_path, int dimensions = 1536);
+    // The HNSW index is persisted next to the database (search.db ->
+    // search.hnsw) and caught up on open with rows written since the last
+    // snapshot; a missing or stale snapshot is rebuilt from the table.
+    MemorySearchStore(const std::string& db_path, int dimensions = 1536,
+                      const VectorIndexConfig& index_cfg = {});
     ~MemorySearchStore();
 
     // Non-copyable
@@ -35,13 +43,43 @@ public:
     // Text-only search (when embeddings unavailable)
     std::vector<MemoryEntry> search_text(const std::string& query, int limit = 5);
 
+    // Drop the vector index and re-insert every stored embedding
+    size_t rebuild_index();
+    size_t index_size();
+    void save_index();
+
 private:
     sqlite3* db_ = nullptr;
     int dimensions_;
+    std::mutex mutex_;  // one connection, shared by every conversation
+
+    VectorIndexConfig index_cfg_;
+    std::unique_ptr<HnswIndex> index_;
+    std::string index_path_;
+    size_t unsaved_ = 0;  // inserts since the last snapshot
+
+    // Snapshots are serialized under mutex_ and written outside it, so
+    // searches do not wait for the disk. Writers are serialized by
+    // save_mutex_; seq keeps a slow writer from replacing a newer snapshot.
+    struct Snapshot {
+        std::string bytes;
+        uint64_t seq = 0;
+        size_t rows = 0;  // unsaved_ it covers
+    };
+    uint64_t snapshot_seq_ = 0;  // guarded by mutex_
+    std::mutex save_mutex_;
+    uint64_t written_seq_ = 0;   // guarded by save_mutex_
+
+    std::vector<MemoryEntry> search_text_locked(const std::string& query, int limit);
+    size_t catch_up_index_locked();
+    // Takes a snapshot when enough rows are unsaved, or always with force
+    bool snapshot_index_locked(bool force, Snapshot& out);
+    bool insert_locked(const std::string& content, const std::string& source, const std::vector<float>& embedding);
+    void write_snapshot(const Snapshot& snap);
+    bool fetch_entry_locked(int64_t id, MemoryEntry& out);
 
     void init_tables();
-    float cosine_similarity(const std::vector<float>& a, const std::vector<float>& b);
-    std::vector<float> blob_to_vector(const void* data, int bytes);
+    void normalize_stored_embeddings();
     std::vector<uint8_t> vector_to_blob(const std::vector<float>& v);
 };
 
@@ -1,6 +1,9 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <string_view>
+#include <functional>
+#include <cstdint>
 #include <nlohmann/json.hpp>
 
 namespace minidragon {
@@ -16,6 +19,28 @@ struct Message {
     std::string content;
     std::string tool_call_id;       // for role="tool"
     std::vector<ToolCall> tool_calls; // for role="assistant" with tool calls
+    int64_t seq = 0;                // session store row; 0 = not loaded from the store
+
+    // Token count cache (see estimate_tokens), valid until touch(); a
+    // tokenizer switch shows up as a different id
+    mutable int cached_tokens = -1;
+    mutable int cached_tokens_tok = 0;
+
+    // Serialized to_json(), reused until touch(): request bodies are spliced
+    // from these so only new messages get serialized each turn
+    mutable std::string cached_json;
+
+    // Call after editing a message in place (fresh and copied messages need
+    // nothing): drops the cached serialization and token count
+    void touch() {
+        cached_json.clear();
+        cached_tokens = -1;
+    }
+
+    const std::string& json_fragment() const {
+        if (cached_json.empty()) cached_json = to_json().dump();
+        return cached_json;
+    }
 
     nlohmann::json to_json() const {
         nlohmann::json j;
@@ -55,4 +80,24 @@ struct Message {
     }
 };
 
+// JSON array of the messages, built from their cached fragments
+inline std::string messages_json(const std::vector<Message>& msgs) {
+    std::vector<const std::string*> fragments;
+    fragments.reserve(msgs.size());
+    size_t size = 2;
+    for (auto& m : msgs) {
+        fragments.push_back(&m.json_fragment());
+        size += fragments.back()->size() + 1;
+    }
+    std::string out;
+    out.reserve(size);
+    out += '[';
+    for (size_t i = 0; i < fragments.size(); i++) {
+        if (i) out += ',';
+        out += *fragments[i];
+    }
+    out += ']';
+    return out;
+}
+
 } // namespace minidragon
@@ -1,4 +1,7 @@
 #include "provider.hpp"
+#include "response_parser.hpp"
+#include "utils.hpp"
+#include <string_view>
 #include <iostream>
 
 namespace minidragon {
@@ -32,9 +35,18 @@ static void parse_url(const std::string& url, std::string& scheme, std::string&
     }
 }
 
-Provider::Provider(const ProviderConfig& cfg) : config_(cfg) {
+std::string Provider::base_url_for(const ProviderConfig& cfg) {
+    std::string scheme, host, prefix;
+    int port;
+    parse_url(cfg.api_base, scheme, host, port, prefix);
+    return scheme + "://" + host + ":" + std::to_string(port);
+}
+
+Provider::Provider(const ProviderConfig& cfg, std::shared_ptr<HttpClientPool> pool)
+    : config_(cfg), pool_(std::move(pool)) {
     parse_url(config_.api_base, scheme_, host_, port_, path_prefix_);
     base_url_ = scheme_ + "://" + host_ + ":" + std::to_string(port_);
+    if (!pool_) pool_ = std::make_shared<HttpClientPool>(base_url_, HttpPoolConfig{1, 60});
 }
 
 // ── Hand-rolled JSON fix (no regex) ──────────────────────────────────
@@ -198,121 +210,196 @@ static std::string strip_tool_content(const std::string& text) {
     return result;
 }
 
-ProviderResponse Provider::chat(const std::vector<Message>& messages,
-                                const nlohmann::json& tools_spec,
-                                const std::string& model,
-                                int max_tokens, double temperature) {
-    httplib::Client cli(base_url_);
-    cli.set_connection_timeout(30);
-    cli.set_read_timeout(120);
+// Fallback parsing: try multiple formats if no standard tool_calls
+static void apply_fallback_tool_parsing(ProviderResponse& resp) {
+    if (!resp.tool_calls.empty() || resp.content.empty()) return;
 
-    nlohmann::json body;
-    body["model"] = model;
-    body["max_tokens"] = max_tokens;
-    body["temperature"] = temperature;
+    // Try format 1: <toolcall>...</toolcall>
+    auto fallback = parse_tagged_tool_calls(resp.content, "<toolcall>", "</toolcall>");
 
-    auto& msgs = body["messages"];
-    for (auto& m : messages) {
-        msgs.push_back(m.to_json());
+    // Try format 2: <tool_call>...</tool_call> (Qwen)
+    if (fallback.empty()) {
+        fallback = parse_tagged_tool_calls(resp.content, "<tool_call>", "</tool_call>");
     }
 
-    if (!tools_spec.empty() && tools_spec.is_array() && tools_spec.size() > 0) {
-        body["tools"] = tools_spec;
+    // Try format 3: ```json blocks with "name" field
+    if (fallback.empty()) {
+        fallback = parse_markdown_json_blocks(resp.content);
     }
 
-    std::string path = path_prefix_ + "/chat/completions";
-    std::string payload = body.dump();
-
-    httplib::Headers headers = {
-        {"Content-Type", "application/json"}
-    };
-    if (!config_.api_key.empty()) {
-        headers.emplace("Authorization", "Bearer " + config_.api_key);
+    if (!fallback.empty()) {
+        resp.tool_calls = std::move(fallback);
+        resp.content = strip_tool_content(resp.content);
     }
+}
 
-    auto res = cli.Post(path, headers, payload, "application/json");
-    if (!res) {
-        throw std::runtime_error("Provider request failed: connection error");
-    }
-    if (res->status != 200) {
-        throw std::runtime_error("Provider returned status " + std::to_string(res->status) + ": " + res->body);
+// ── Incremental SSE decoding for chat_stream ─────────────────────────
+
+// Accumulates streamed chat.completion.chunk deltas into a ProviderResponse.
+// Bytes are fed as they arrive; complete "data:" lines are decoded at once.
+class SseStreamAssembler {
+public:
+    explicit SseStreamAssembler(const StreamCallback& on_token) : on_token_(on_token) {}
+
+    // False once the stream is malformed beyond repair (see error())
+    bool feed(const char* data, size_t len) {
+        if (!error_.empty()) return false;
+        buf_.append(data, len);
+        size_t start = 0;
+        for (;;) {
+            size_t nl = buf_.find('\n', start);
+            if (nl == std::string::npos) break;
+            size_t end = nl;
+            if (end > start && buf_[end - 1] == '\r') end--;
+            handle_line(std::string_view(buf_).substr(start, end - start));
+            start = nl + 1;
+            if (!error_.empty()) return false;
+        }
+        buf_.erase(0, start);
+        return true;
     }
 
-    ProviderResponse resp;
-    try {
-        auto j = nlohmann::json::parse(res->body);
-        if (j.contains("choices") && !j["choices"].empty()) {
-            auto& msg = j["choices"][0]["message"];
-            resp.content = msg.contains("content") && !msg["content"].is_null()
-                           ? msg["content"].get<std::string>() : "";
-
-            // Standard OpenAI tool_calls format
-            if (msg.contains("tool_calls") && msg["tool_calls"].is_array()) {
-                for (auto& tc : msg["tool_calls"]) {
-                    ToolCall t;
-                    t.id = tc.value("id", "");
-                    if (tc.contains("function")) {
-                        t.name = tc["function"].value("name", "");
-                        t.arguments = tc["function"].value("arguments", "");
-                    }
-                    if (!t.name.empty()) resp.tool_calls.push_back(std::move(t));
-                }
-            }
+    const std::string& error() const { return error_; }
+
+    // Flush a trailing line without newline and return the assembled response
+    ProviderResponse finish() {
+        if (!buf_.empty()) {
+            std::string rest;
+            rest.swap(buf_);
+            handle_line(rest);
+        }
+        for (auto& tc : calls_) {
+            if (tc.name.empty()) continue;
+            if (tc.id.empty()) tc.id = generate_tool_call_id();
+            resp_.tool_calls.push_back(std::move(tc));
         }
-    } catch (const std::exception& e) {
-        throw std::runtime_error(std::string("Failed to parse provider response: ") + e.what());
+        calls_.clear();
+        return std::move(resp_);
     }
 
-    // Fallback parsing: try multiple formats if no standard tool_calls
-    if (resp.tool_calls.empty() && !resp.content.empty()) {
-        // Try format 1: <toolcall>...</toolcall>
-        auto fallback = parse_tagged_tool_calls(resp.content, "<toolcall>", "</toolcall>");
+private:
+    const StreamCallback& on_token_;
+    std::string buf_;
+    ProviderResponse resp_;
+    std::vector<ToolCall> calls_;  // indexed by delta tool_calls[].index
+    std::string error_;
 
-        // Try format 2: <tool_call>...</tool_call> (Qwen)
-        if (fallback.empty()) {
-            fallback = parse_tagged_tool_calls(resp.content, "<tool_call>", "</tool_call>");
-        }
+    void handle_line(std::string_view line) {
+        if (line.size() < 5 || line.substr(0, 5) != "data:") return;  // comments, event:, id:
+        line.remove_prefix(5);
+        if (!line.empty() && line.front() == ' ') line.remove_prefix(1);
+        if (line == "[DONE]") return;  // end-of-stream sentinel
 
-        // Try format 3: ```json blocks with "name" field
-        if (fallback.empty()) {
-            fallback = parse_markdown_json_blocks(resp.content);
+        nlohmann::json j;
+        try {
+            j = nlohmann::json::parse(line);
+        } catch (...) {
+            return;
+        }
+        if (!j.contains("choices") || !j["choices"].is_array() || j["choices"].empty()) return;
+        auto& choice = j["choices"][0];
+        if (!choice.contains("delta") || !choice["delta"].is_object()) return;
+        auto& delta = choice["delta"];
+
+        if (delta.contains("content") && delta["content"].is_string()) {
+            const auto& token = delta["content"].get_ref<const std::string&>();
+            if (!token.empty()) {
+                resp_.content += token;
+                if (on_token_) on_token_(token, false);
+            }
         }
 
-        if (!fallback.empty()) {
-            resp.tool_calls = std::move(fallback);
-            resp.content = strip_tool_content(resp.content);
+        if (delta.contains("tool_calls") && delta["tool_calls"].is_array()) {
+            for (auto& tc : delta["tool_calls"]) merge_tool_call_delta(tc);
         }
     }
 
-    return resp;
-}
+    void merge_tool_call_delta(const nlohmann::json& tc) {
+        std::string id = tc.contains("id") && tc["id"].is_string() ? tc["id"].get<std::string>() : "";
 
-void Provider::chat_stream(const std::vector<Message>& messages,
-                           const nlohmann::json& tools_spec,
-                           const std::string& model,
-                           int max_tokens, double temperature,
-                           StreamCallback on_token) {
-    httplib::Client cli(base_url_);
-    cli.set_connection_timeout(30);
-    cli.set_read_timeout(120);
+        // Some OpenAI-compatible servers omit index; a new id starts a new call
+        int64_t idx = tc.contains("index") && tc["index"].is_number_integer() ? tc["index"].get<int64_t>() : -1;
+        if (idx < 0) {
+            idx = static_cast<int64_t>(calls_.size());
+            if (!calls_.empty() && (id.empty() || calls_.back().id == id)) idx--;
+        }
+        // A new call always takes the next slot; anything further is not a
+        // stream we can trust to size our buffers
+        if (idx > static_cast<int64_t>(calls_.size())) {
+            error_ = "tool_calls index " + std::to_string(idx) + " skips past call " + std::to_string(calls_.size());
+            return;
+        }
+        if (idx == static_cast<int64_t>(calls_.size())) calls_.emplace_back();
+        auto& call = calls_[idx];
+
+        if (!id.empty()) call.id = id;
+        if (tc.contains("function") && tc["function"].is_object()) {
+            auto& fn = tc["function"];
+            if (fn.contains("name") && fn["name"].is_string()) {
+                const auto& name = fn["name"].get_ref<const std::string&>();
+                // Name normally arrives once; tolerate servers that repeat it
+                if (call.name.empty()) call.name = name;
+                else if (name != call.name) call.name += name;
+            }
+            if (fn.contains("arguments")) {
+                if (fn["arguments"].is_string()) call.arguments += fn["arguments"].get_ref<const std::string&>();
+                else if (!fn["arguments"].is_null()) call.arguments += fn["arguments"].dump();
+            }
+        }
+    }
+};
 
-    nlohmann::json body;
-    body["model"] = model;
-    body["max_tokens"] = max_tokens;
-    body["temperature"] = temperature;
-    body["stream"] = true;
+// ── Request body ────────────────────────────────────────────────────
 
-    auto& msgs = body["messages"];
-    for (auto& m : messages) {
-        msgs.push_back(m.to_json());
+ChatPayload ChatPayload::from(const std::vector<Message>& messages, const nlohmann::json& tools_spec) {
+    ChatPayload p;
+    p.messages = std::make_shared<const std::string>(messages_json(messages));
+    if (tools_spec.is_array() && !tools_spec.empty()) {
+        p.tools = std::make_shared<const std::string>(tools_spec.dump());
     }
+    return p;
+}
 
-    if (!tools_spec.empty() && tools_spec.is_array() && tools_spec.size() > 0) {
-        body["tools"] = tools_spec;
+// Scalars go through the DOM; the (large) message and tool arrays are
+// appended pre-serialized
+static std::string chat_body(const ChatPayload& p, const std::string& model,
+                             int max_tokens, double temperature, bool stream) {
+    nlohmann::json head;
+    head["model"] = model;
+    head["max_tokens"] = max_tokens;
+    head["temperature"] = temperature;
+    if (stream) head["stream"] = true;
+
+    std::string body = head.dump();
+    body.pop_back();  // reopen the object
+    body.reserve(body.size() + 32 + (p.messages ? p.messages->size() : 2) + (p.tools ? p.tools->size() : 0));
+    body += ",\"messages\":";
+    body += p.messages ? *p.messages : "[]";
+    if (p.tools) {
+        body += ",\"tools\":";
+        body += *p.tools;
     }
+    body += '}';
+    return body;
+}
+
+ProviderResponse Provider::chat(const std::vector<Message>& messages,
+                                const nlohmann::json& tools_spec,
+                                const std::string& model,
+                                int max_tokens, double temperature,
+                                CancelToken* cancel) {
+    return chat(ChatPayload::from(messages, tools_spec), model, max_tokens, temperature, cancel);
+}
+
+ProviderResponse Provider::chat(const ChatPayload& chat_payload,
+                                const std::string& model,
+                                int max_tokens, double temperature,
+                                CancelToken* cancel) {
+    auto cli = pool_->acquire();
+    cli->set_read_timeout(120);
 
     std::string path = path_prefix_ + "/chat/completions";
-    std::string payload = body.dump();
+    std::string payload = chat_body(chat_payload, model, max_tokens, temperature, false);
 
     httplib::Headers headers = {
         {"Content-Type", "application/json"}
@@ -321,61 +408,106 @@ void Provider::chat_stream(const std::vector<Message>& messages,
         headers.emplace("Authorization", "Bearer " + config_.api_key);
     }
 
-    auto res = cli.Post(path, headers, payload, "application/json");
+    // Cancelling shuts the socket down, which unblocks Post()
+    CancelScope scope(cancel, [&] { cli->stop(); });
+    if (scope.cancelled()) throw std::runtime_error("Provider request cancelled");
+    auto res = cli->Post(path, headers, payload, "application/json");
+    scope.release();
+    if (scope.cancelled()) {
+        cli.discard();
+        throw std::runtime_error("Provider request cancelled");
+    }
     if (!res) {
-        throw std::runtime_error("Provider stream request failed: connection error");
+        cli.discard();
+        throw std::runtime_error("Provider request failed: connection error");
     }
     if (res->status != 200) {
-        throw std::runtime_error("Provider stream returned status " + std::to_string(res->status));
+        throw std::runtime_error("Provider returned status " + std::to_string(res->status) + ": " + res->body);
     }
 
-    // Parse SSE events from the buffered response body
-    std::string& data = res->body;
-    size_t pos = 0;
-    while (pos < data.size()) {
-        size_t event_end = data.find("\n\n", pos);
-        if (event_end == std::string::npos) event_end = data.size();
-
-        std::string event = data.substr(pos, event_end - pos);
-        pos = event_end + 2;
-
-        // Parse lines in this event
-        size_t line_start = 0;
-        while (line_start < event.size()) {
-            size_t line_end = event.find('\n', line_start);
-            if (line_end == std::string::npos) line_end = event.size();
-            std::string line = event.substr(line_start, line_end - line_start);
-            line_start = line_end + 1;
-
-            if (line.size() > 6 && line.substr(0, 6) == "data: ") {
-                std::string data_str = line.substr(6);
-                if (data_str == "[DONE]") {
-                    on_token("", true);
-                    return;
-                }
-                try {
-                    auto j = nlohmann::json::parse(data_str);
-                    if (j.contains("choices") && !j["choices"].empty()) {
-                        auto& delta = j["choices"][0]["delta"];
-                        if (delta.contains("content")) {
-                            std::string token = delta["content"].get<std::string>();
-                            if (!token.empty()) {
-                                on_token(token, false);
-                            }
-                        }
-                    }
-                } catch (...) {}
-            }
+    ProviderResponse resp = parse_chat_response(res->body);
+    apply_fallback_tool_parsing(resp);
+    return resp;
+}
+
+ProviderResponse Provider::chat_stream(const std::vector<Message>& messages,
+                                       const nlohmann::json& tools_spec,
+                                       const std::string& model,
+                                       int max_tokens, double temperature,
+                                       StreamCallback on_token,
+                                       CancelToken* cancel) {
+    return chat_stream(ChatPayload::from(messages, tools_spec), model, max_tokens, temperature,
+                       std::move(on_token), cancel);
+}
+
+ProviderResponse Provider::chat_stream(const ChatPayload& payload,
+                                       const std::string& model,
+                                       int max_tokens, double temperature,
+                                       StreamCallback on_token,
+                                       CancelToken* cancel) {
+    auto cli = pool_->acquire();
+    cli->set_read_timeout(120);
+
+    httplib::Request req;
+    req.method = "POST";
+    req.path = path_prefix_ + "/chat/completions";
+    req.body = chat_body(payload, model, max_tokens, temperature, true);
+    req.headers = {
+        {"Content-Type", "application/json"},
+        {"Accept", "text/event-stream"}
+    };
+    if (!config_.api_key.empty()) {
+        req.headers.emplace("Authorization", "Bearer " + config_.api_key);
+    }
+
+    // Decode SSE events as bytes arrive instead of after the body is buffered
+    SseStreamAssembler assembler(on_token);
+    int status = 0;
+    std::string error_body;
+    req.response_handler = [&](const httplib::Response& r) {
+        status = r.status;
+        return true;
+    };
+    req.content_receiver = [&](const char* data, size_t len, uint64_t, uint64_t) {
+        if (cancel && cancel->cancelled()) return false;
+        if (status != 200) {
+            if (error_body.size() < 4096) error_body.append(data, len);
+            return true;
         }
+        return assembler.feed(data, len);
+    };
+
+    CancelScope scope(cancel, [&] { cli->stop(); });
+    if (scope.cancelled()) throw std::runtime_error("Provider request cancelled");
+    auto res = cli->send(req);
+    scope.release();
+    if (scope.cancelled()) {
+        cli.discard();
+        throw std::runtime_error("Provider request cancelled");
+    }
+    if (!assembler.error().empty()) {
+        cli.discard();
+        throw std::runtime_error("Provider stream malformed: " + assembler.error());
     }
-    on_token("", true);
+    if (!res) {
+        cli.discard();
+        throw std::runtime_error("Provider stream request failed: connection error");
+    }
+    if (status != 200) {
+        throw std::runtime_error("Provider stream returned status " + std::to_string(status) +
+                                 (error_body.empty() ? "" : ": " + error_body));
+    }
+
+    ProviderResponse resp = assembler.finish();
+    apply_fallback_tool_parsing(resp);
+    if (on_token) on_token("", true);
+    return resp;
 }
 
 EmbeddingResponse Provider::embed(const std::vector<std::string>& texts,
                                    const std::string& model) {
-    httplib::Client cli(base_url_);
-    cli.set_connection_timeout(30);
-    cli.set_read_timeout(60);
+    auto cli = pool_->acquire();
+    cli->set_read_timeout(60);
 
     nlohmann::json body;
     body["model"] = model;
@@ -391,33 +523,16 @@ EmbeddingResponse Provider::embed(const std::vector<std::string>& texts,
         headers.emplace("Authorization", "Bearer " + config_.api_key);
     }
 
-    auto res = cli.Post(path, headers, payload, "application/json");
+    auto res = cli->Post(path, headers, payload, "application/json");
     if (!res) {
+        cli.discard();
         throw std::runtime_error("Embedding request failed: connection error");
     }
     if (res->status != 200) {
         throw std::runtime_error("Embedding returned status " + std::to_string(res->status) + ": " + res->body);
     }
 
-    EmbeddingResponse resp;
-    try {
-        auto j = nlohmann::json::parse(res->body);
-        if (j.contains("data") && j["data"].is_array()) {
-            for (auto& item : j["data"]) {
-                if (item.contains("embedding") && item["embedding"].is_array()) {
-                    std::vector<float> vec;
-                    vec.reserve(item["embedding"].size());
-                    for (auto& v : item["embedding"]) {
-                        vec.push_back(v.get<float>());
-                    }
-                    resp.embeddings.push_back(std::move(vec));
-                }
-            }
-        }
-    } catch (const std::exception& e) {
-        throw std::runtime_error(std::string("Failed to parse embedding response: ") + e.what());
-    }
-    return resp;
+    return parse_embedding_response(res->body);
 }
 
 } // namespace minidragon
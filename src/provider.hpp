@@ -1,10 +1,13 @@
 #pragma once
 #include "config.hpp"
 #include "message.hpp"
+#include "http_pool.hpp"
+#include "cancel.hpp"
 #include <httplib.h>
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <memory>
 
 namespace minidragon {
 
@@ -20,25 +23,56 @@ struct EmbeddingResponse {
 
 using StreamCallback = std::function<void(const std::string& token, bool done)>;
 
+// Pre-serialized chat request pieces, spliced into the body as-is. Shared
+// (not copied) between fallback attempts and concurrent hedges.
+struct ChatPayload {
+    std::shared_ptr<const std::string> messages;  // JSON array
+    std::shared_ptr<const std::string> tools;     // JSON array; null = no tools
+
+    static ChatPayload from(const std::vector<Message>& messages, const nlohmann::json& tools_spec);
+};
+
 class Provider {
 public:
-    explicit Provider(const ProviderConfig& cfg);
+    // pool: shared keep-alive clients (ProviderChain owns one per provider);
+    // when null a private single-slot pool is created.
+    explicit Provider(const ProviderConfig& cfg,
+                      std::shared_ptr<HttpClientPool> pool = nullptr);
 
+    // cancel: when another thread cancels the token the in-flight request is
+    // aborted and the call throws "Provider request cancelled".
     ProviderResponse chat(const std::vector<Message>& messages,
                           const nlohmann::json& tools_spec,
                           const std::string& model,
-                          int max_tokens, double temperature);
+                          int max_tokens, double temperature,
+                          CancelToken* cancel = nullptr);
+    ProviderResponse chat(const ChatPayload& payload,
+                          const std::string& model,
+                          int max_tokens, double temperature,
+                          CancelToken* cancel = nullptr);
 
-    void chat_stream(const std::vector<Message>& messages,
-                     const nlohmann::json& tools_spec,
-                     const std::string& model,
-                     int max_tokens, double temperature,
-                     StreamCallback on_token);
+    // Streams content tokens to on_token as SSE events arrive and returns the
+    // assembled response (content plus tool calls rebuilt from deltas).
+    ProviderResponse chat_stream(const std::vector<Message>& messages,
+                                 const nlohmann::json& tools_spec,
+                                 const std::string& model,
+                                 int max_tokens, double temperature,
+                                 StreamCallback on_token,
+                                 CancelToken* cancel = nullptr);
+    ProviderResponse chat_stream(const ChatPayload& payload,
+                                 const std::string& model,
+                                 int max_tokens, double temperature,
+                                 StreamCallback on_token,
+                                 CancelToken* cancel = nullptr);
 
     EmbeddingResponse embed(const std::vector<std::string>& texts,
                             const std::string& model = "text-embedding-3-small");
 
     const ProviderConfig& config() const { return config_; }
+    const std::string& base_url() const { return base_url_; }
+
+    // scheme://host:port for a provider's api_base
+    static std::string base_url_for(const ProviderConfig& cfg);
 
 private:
     ProviderConfig config_;
@@ -48,6 +82,7 @@ private:
     int port_;
     std::string path_prefix_;
     std::string base_url_;  // scheme://host:port
+    std::shared_ptr<HttpClientPool> pool_;
 };
 
 } // namespace minidragon
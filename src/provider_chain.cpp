@@ -3,6 +3,11 @@
 #include "utils.hpp"
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
 
 namespace minidragon {
 
@@ -12,7 +17,7 @@ ProviderChain::ProviderChain(const Config& cfg) : config_(cfg) {
         for (auto& name : cfg.fallback.provider_order) {
             auto it = cfg.providers.find(name);
             if (it != cfg.providers.end()) {
-                providers_.emplace_back(name, Provider(it->second));
+                providers_.emplace_back(name, Provider(it->second, pool_for(name, it->second)));
             }
         }
     }
@@ -21,18 +26,66 @@ ProviderChain::ProviderChain(const Config& cfg) : config_(cfg) {
     if (providers_.empty()) {
         auto resolved = cfg.resolve_provider();
         std::string name = cfg.provider.empty() ? "default" : cfg.provider;
-        providers_.emplace_back(name, Provider(resolved));
+        providers_.emplace_back(name, Provider(resolved, pool_for(name, resolved)));
     }
 
     last_active_ = providers_.front().first;
+    for (auto& [name, provider] : providers_) {
+        ProviderHealth h;
+        h.name = name;
+        health_.push_back(std::move(h));
+    }
+    adaptive_ = cfg.fallback.routing == "adaptive";
+    hedge_.resize(providers_.size());
+    for (auto& hs : hedge_) {
+        hs.budget = std::max(cfg.fallback.hedge_budget, 0);
+        hs.refilled = std::chrono::steady_clock::now();
+    }
 
     // Set up embedding provider (separate from chat providers)
     if (cfg.embedding.enabled && !cfg.embedding.provider.empty()) {
         auto it = cfg.providers.find(cfg.embedding.provider);
         if (it != cfg.providers.end()) {
-            embed_provider_ = std::make_unique<Provider>(it->second);
+            embed_provider_ = std::make_unique<Provider>(
+                it->second, pool_for(cfg.embedding.provider, it->second));
         }
     }
+
+    if (cfg.embedding.enabled && cfg.embedding.cache) {
+        embed_cache_ = std::make_unique<EmbeddingCache>(
+            cfg.workspace_path() + "/memory/embed_cache.db",
+            static_cast<size_t>(std::max(cfg.embedding.cache_entries, 0)));
+    }
+
+    if (cfg.response_cache.enabled) {
+        response_cache_ = std::make_unique<ResponseCache>(
+            cfg.workspace_path() + "/cache/responses.db",
+            cfg.response_cache.ttl, cfg.response_cache.max_entries);
+    }
+
+    // Concurrent embed() calls share upstream requests
+    if (cfg.embedding.enabled && cfg.embedding.batch_size > 1) {
+        embed_batcher_ = std::make_unique<EmbedBatcher>(
+            [this](const std::vector<std::string>& texts, const std::string& model) {
+                return embed_uncached(texts, model);
+            },
+            cfg.embedding.batch_size, cfg.embedding.batch_wait_ms, cfg.embedding.batch_in_flight);
+    }
+}
+
+std::shared_ptr<HttpClientPool> ProviderChain::pool_for(const std::string& name,
+                                                        const ProviderConfig& pc) {
+    auto it = pools_.find(name);
+    if (it != pools_.end()) return it->second;
+    auto pool = std::make_shared<HttpClientPool>(Provider::base_url_for(pc), config_.http_pool);
+    pools_[name] = pool;
+    return pool;
+}
+
+std::map<std::string, HttpPoolStats> ProviderChain::pool_stats() const {
+    std::map<std::string, HttpPoolStats> out;
+    for (auto& [name, pool] : pools_) out[name] = pool->stats();
+    return out;
 }
 
 int ProviderChain::cooldown_for(ProviderErrorKind kind) const {
@@ -45,46 +98,463 @@ int ProviderChain::cooldown_for(ProviderErrorKind kind) const {
     }
 }
 
-void ProviderChain::mark_cooldown(const std::string& name, ProviderErrorKind kind) {
+// ── Routing and circuit breaker ─────────────────────────────────────
+
+static constexpr size_t kLatencySamples = 64;  // per provider, for hedge percentiles
+static constexpr size_t kMinHedgeSamples = 8;
+static constexpr double kDefaultLatencyMs = 1000;  // routing prior before any sample
+static constexpr const char* kHedgeLost = "hedge lost";  // cancel reason for the slower racer
+
+const char* circuit_state_name(CircuitState s) {
+    switch (s) {
+    case CircuitState::closed:    return "closed";
+    case CircuitState::open:      return "open";
+    case CircuitState::half_open: return "half-open";
+    }
+    return "?";
+}
+
+bool ProviderHealth::latency_sample(bool streaming, double& ms) const {
+    // Streaming callers feel time-to-first-token; others the full request
+    if (streaming && has_ttft) {
+        ms = ttft_ms;
+    } else if (has_latency) {
+        ms = latency_ms;
+    } else if (has_ttft) {
+        ms = ttft_ms;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+double ProviderHealth::score(bool streaming, double prior_ms) const {
+    double latency;
+    if (!latency_sample(streaming, latency)) latency = prior_ms;
+    return latency * (1.0 + 4.0 * error_rate);
+}
+
+std::vector<size_t> ProviderChain::route_order(bool streaming) const {
+    std::vector<size_t> order;
+    if (!adaptive_) {
+        for (size_t i = 0; i < providers_.size(); i++) order.push_back(i);
+        return order;
+    }
+
+    auto& preferred = config_.fallback.preferred;
+    auto is_preferred = [&](const std::string& name) {
+        return preferred.empty() || std::find(preferred.begin(), preferred.end(), name) != preferred.end();
+    };
+
+    std::vector<size_t> rest;
+    for (size_t i = 0; i < providers_.size(); i++) {
+        (is_preferred(providers_[i].first) ? order : rest).push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        // Unsampled providers are assumed to be as fast as the chain's median
+        std::vector<double> sampled;
+        for (auto& h : health_) {
+            double ms;
+            if (h.latency_sample(streaming, ms)) sampled.push_back(ms);
+        }
+        double prior = kDefaultLatencyMs;
+        if (!sampled.empty()) {
+            std::nth_element(sampled.begin(), sampled.begin() + sampled.size() / 2, sampled.end());
+            prior = sampled[sampled.size() / 2];
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return health_[a].score(streaming, prior) < health_[b].score(streaming, prior);
+        });
+    }
+    order.insert(order.end(), rest.begin(), rest.end());
+    return order;
+}
+
+bool ProviderChain::try_admit(size_t idx) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto& h = health_[idx];
+    switch (h.state) {
+    case CircuitState::closed:
+        return true;
+    case CircuitState::open:
+        if (epoch_now() < h.open_until) return false;
+        h.state = CircuitState::half_open;
+        h.probe_in_flight = true;
+        std::cerr << "[fallback] Provider '" << h.name << "' half-open — sending probe\n";
+        return true;
+    case CircuitState::half_open:
+        // One probe at a time; everyone else routes around it
+        if (h.probe_in_flight) return false;
+        h.probe_in_flight = true;
+        return true;
+    }
+    return false;
+}
+
+void ProviderChain::record_success(size_t idx, double latency_ms, bool streaming) {
+    double a = config_.fallback.ewma_alpha;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto& h = health_[idx];
+    h.requests++;
+    h.error_rate = (1 - a) * h.error_rate;
+    if (streaming) {
+        h.ttft_ms = h.has_ttft ? (1 - a) * h.ttft_ms + a * latency_ms : latency_ms;
+        h.has_ttft = true;
+    } else {
+        h.latency_ms = h.has_latency ? (1 - a) * h.latency_ms + a * latency_ms : latency_ms;
+        h.has_latency = true;
+    }
+    auto& samples = streaming ? hedge_[idx].ttft_ms : hedge_[idx].latency_ms;
+    samples.push_back(latency_ms);
+    if (samples.size() > kLatencySamples) samples.pop_front();
+    h.consecutive_failures = 0;
+    if (h.state != CircuitState::closed) {
+        std::cerr << "[fallback] Provider '" << h.name << "' recovered — circuit closed\n";
+    }
+    h.state = CircuitState::closed;
+    h.probe_in_flight = false;
+}
+
+void ProviderChain::record_failure(size_t idx, ProviderErrorKind kind, bool trip) {
+    double a = config_.fallback.ewma_alpha;
     int secs = cooldown_for(kind);
-    cooldowns_[name] = ProviderCooldown{epoch_now() + secs, kind};
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto& h = health_[idx];
+    h.requests++;
+    h.failures++;
+    h.error_rate = (1 - a) * h.error_rate + a;
+    h.consecutive_failures++;
+    h.probe_in_flight = false;
+
+    // A failed probe re-opens immediately; otherwise wait for the threshold
+    bool open = h.state == CircuitState::half_open ||
+                h.consecutive_failures >= std::max(config_.fallback.failure_threshold, 1);
+    if (trip && open) {
+        h.state = CircuitState::open;
+        h.open_until = epoch_now() + secs;
+        std::cerr << "[fallback] Provider '" << h.name << "' circuit open for " << secs << "s\n";
+    }
 }
 
-bool ProviderChain::in_cooldown(const std::string& name) const {
-    auto it = cooldowns_.find(name);
-    if (it == cooldowns_.end()) return false;
-    return epoch_now() < it->second.until;
+// A request cut short after latency_ms (a hedge loser) would have taken at
+// least that long. Pulls the average up when it is higher; a lower bound
+// below the average says nothing. Error rate and circuit are untouched.
+void ProviderChain::record_lower_bound(size_t idx, double latency_ms, bool streaming) {
+    double a = config_.fallback.ewma_alpha;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto& h = health_[idx];
+    h.probe_in_flight = false;
+    double& avg = streaming ? h.ttft_ms : h.latency_ms;
+    bool& has = streaming ? h.has_ttft : h.has_latency;
+    if (!has) {
+        avg = latency_ms;
+        has = true;
+    } else if (latency_ms > avg) {
+        avg = (1 - a) * avg + a * latency_ms;
+    }
+}
+
+void ProviderChain::release_probe(size_t idx) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    health_[idx].probe_in_flight = false;
+}
+
+std::vector<ProviderHealth> ProviderChain::health() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return health_;
 }
 
 std::string ProviderChain::active_provider_name() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
     return last_active_;
 }
 
+void ProviderChain::set_active(const std::string& name) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    last_active_ = name;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// ── Hedged requests ─────────────────────────────────────────────────
+
+bool ProviderChain::hedging() const {
+    return config_.fallback.enabled && config_.fallback.hedge && providers_.size() > 1;
+}
+
+std::chrono::milliseconds ProviderChain::hedge_delay(size_t idx, bool streaming) const {
+    auto& fb = config_.fallback;
+    std::vector<double> samples;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        auto& src = streaming ? hedge_[idx].ttft_ms : hedge_[idx].latency_ms;
+        samples.assign(src.begin(), src.end());
+    }
+    double ms = fb.hedge_delay_ms;
+    if (samples.size() >= kMinHedgeSamples) {
+        int pct = std::clamp(fb.hedge_percentile, 1, 100);
+        size_t k = std::min(samples.size() - 1, samples.size() * pct / 100);
+        std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+        ms = samples[k];
+    }
+    return std::chrono::milliseconds(static_cast<int64_t>(std::max<double>(ms, fb.hedge_min_delay_ms)));
+}
+
+bool ProviderChain::take_hedge_budget(size_t idx) {
+    auto& fb = config_.fallback;
+    auto it = fb.hedge_budgets.find(providers_[idx].first);
+    double per_minute = std::max(it != fb.hedge_budgets.end() ? it->second : fb.hedge_budget, 0);
+
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    auto& hs = hedge_[idx];
+    auto now = std::chrono::steady_clock::now();
+    double minutes = std::chrono::duration<double>(now - hs.refilled).count() / 60.0;
+    hs.budget = std::min(per_minute, hs.budget + minutes * per_minute);
+    hs.refilled = now;
+    if (hs.budget < 1.0) return false;
+    hs.budget -= 1.0;
+    health_[idx].hedges++;
+    return true;
+}
+
+// One timed request against providers_[idx]. Records the outcome for
+// routing; a hedge loser records its elapsed time as a lower bound, and a
+// request the caller cancelled records nothing.
+ProviderResponse ProviderChain::attempt(size_t idx, bool streaming, const AttemptFn& call,
+                                        StreamCallback on_token, CancelToken* cancel) {
+    auto start = std::chrono::steady_clock::now();
+    double ttft = -1;
+    StreamCallback timed;
+    if (streaming) {
+        timed = [&](const std::string& token, bool done) {
+            if (!token.empty() && ttft < 0) ttft = elapsed_ms(start);
+            if (on_token) on_token(token, done);
+        };
+    }
+
+    try {
+        auto resp = call(idx, cancel, timed);
+        // Tool-call-only replies stream no content tokens; use total time
+        record_success(idx, streaming && ttft >= 0 ? ttft : elapsed_ms(start), streaming);
+        return resp;
+    } catch (const std::exception& e) {
+        if (cancel && cancel->cancelled()) {
+            if (cancel->reason() == kHedgeLost) {
+                record_lower_bound(idx, elapsed_ms(start), streaming);
+            } else {
+                release_probe(idx);
+            }
+            throw;
+        }
+        bool trip = config_.fallback.enabled && providers_.size() > 1;
+        record_failure(idx, classify_provider_error(e.what()), trip);
+        throw;
+    }
+}
+
+// Runs the request on order[pos]; if it has not answered (streaming: sent
+// its first token) within the hedge delay, starts the same request on the
+// next admissible provider too. The first answer wins and the other request
+// is cancelled. Throws the last error if every racer failed.
+ProviderResponse ProviderChain::race(const std::vector<size_t>& order, size_t pos, bool streaming,
+                                     const AttemptFn& call, StreamCallback on_token,
+                                     std::vector<bool>& tried, CancelToken* cancel) {
+    size_t primary = order[pos];
+    tried[primary] = true;
+    if (!hedging()) {
+        auto resp = attempt(primary, streaming, call, on_token, cancel);
+        set_active(providers_[primary].first);
+        return resp;
+    }
+
+    struct Racer {
+        size_t idx = 0;
+        CancelToken cancel;
+        std::thread thread;
+        bool done = false;
+        bool ok = false;
+        ProviderResponse resp;
+        std::string error;
+    };
+    Racer racers[2];
+    std::mutex m;
+    std::condition_variable cv;
+    int winner = -1;
+    int launched = 0;
+
+    // The caller's cancellation reaches both racers (and a hedge not yet launched)
+    CancelScope forward(cancel, [&] {
+        racers[0].cancel.cancel();
+        racers[1].cancel.cancel();
+    });
+
+    auto launch = [&](int slot, size_t idx) {
+        racers[slot].idx = idx;
+        launched++;
+        racers[slot].thread = std::thread([&, slot] {
+            Racer& self = racers[slot];
+            Racer& other = racers[1 - slot];
+            StreamCallback gated;
+            if (streaming) {
+                // First racer to produce output claims the stream; the
+                // other's tokens are dropped and its request cancelled
+                gated = [&, slot](const std::string& token, bool done) {
+                    {
+                        std::lock_guard<std::mutex> lock(m);
+                        if (winner < 0 && (!token.empty() || done)) {
+                            winner = slot;
+                            other.cancel.cancel(kHedgeLost);
+                            cv.notify_all();
+                        }
+                        if (winner != slot) return;
+                    }
+                    if (on_token) on_token(token, done);
+                };
+            }
+
+            bool ok = false;
+            ProviderResponse resp;
+            std::string error;
+            try {
+                resp = attempt(self.idx, streaming, call, gated, &self.cancel);
+                ok = true;
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(m);
+            self.done = true;
+            self.ok = ok;
+            self.resp = std::move(resp);
+            self.error = std::move(error);
+            if (ok && winner < 0) {
+                winner = slot;
+                other.cancel.cancel(kHedgeLost);
+            }
+            cv.notify_all();
+        });
+    };
+
+    launch(0, primary);
+
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait_for(lock, hedge_delay(primary, streaming),
+                [&] { return winner >= 0 || racers[0].done; });
+    if (winner < 0 && !racers[0].done && !(cancel && cancel->cancelled())) {
+        lock.unlock();
+        for (size_t p = pos + 1; p < order.size(); p++) {
+            size_t idx = order[p];
+            if (tried[idx] || !try_admit(idx)) continue;
+            if (!take_hedge_budget(idx)) {
+                release_probe(idx);
+                continue;
+            }
+            tried[idx] = true;
+            std::cerr << "[fallback] Provider '" << providers_[primary].first << "' slow — hedging on '"
+                      << providers_[idx].first << "'\n";
+            launch(1, idx);
+            break;
+        }
+        lock.lock();
+    }
+
+    cv.wait(lock, [&] {
+        if (winner >= 0) return racers[winner].done;
+        return racers[0].done && (launched < 2 || racers[1].done);
+    });
+    for (int i = 0; i < launched; i++) {
+        if (i != winner) racers[i].cancel.cancel(kHedgeLost);
+    }
+    lock.unlock();
+    for (int i = 0; i < launched; i++) racers[i].thread.join();
+
+    if (winner >= 0 && racers[winner].ok) {
+        size_t idx = racers[winner].idx;
+        if (winner == 1) {
+            std::lock_guard<std::mutex> state_lock(state_mutex_);
+            health_[idx].hedge_wins++;
+        }
+        set_active(providers_[idx].first);
+        return std::move(racers[winner].resp);
+    }
+    // A claimed stream that failed mid-way reports its own error
+    int failed = winner >= 0 ? winner : launched - 1;
+    throw std::runtime_error(racers[failed].error);
+}
+
+// ── Request serialization ───────────────────────────────────────────
+
+std::shared_ptr<const std::string> ProviderChain::tools_json_for(const nlohmann::json& tools_spec,
+                                                                 uint64_t version, SchemaFlavor flavor) {
+    if (!tools_spec.is_array() || tools_spec.empty()) return nullptr;
+    if (version == 0) {
+        return std::make_shared<const std::string>(adapt_tools_schema(tools_spec, flavor).dump());
+    }
+
+    std::lock_guard<std::mutex> lock(tools_json_mutex_);
+    auto key = std::make_pair(version, flavor);
+    auto it = tools_json_.find(key);
+    if (it != tools_json_.end()) return it->second;
+
+    // Old registry versions are dead weight once tools change
+    if (tools_json_.size() >= 32) tools_json_.clear();
+    auto json = std::make_shared<const std::string>(adapt_tools_schema(tools_spec, flavor).dump());
+    tools_json_[key] = json;
+    return json;
+}
+
+// Empty when the request is not cacheable
+std::string ProviderChain::response_cache_key(const std::string& messages_body,
+                                              const nlohmann::json& tools_spec,
+                                              const std::string& model, int max_tokens,
+                                              double temperature, const ChatOptions& opts) {
+    if (!response_cache_ || temperature > config_.response_cache.max_temperature) return "";
+    auto tools = tools_json_for(tools_spec, opts.tools_version, SchemaFlavor::generic);
+    return ResponseCache::key_for(model, max_tokens, temperature, messages_body, tools ? *tools : "");
+}
+
 ProviderResponse ProviderChain::chat(const std::vector<Message>& messages,
                                       const nlohmann::json& tools_spec,
                                       const std::string& model,
-                                      int max_tokens, double temperature) {
+                                      int max_tokens, double temperature,
+                                      const ChatOptions& opts) {
     std::string last_error;
+    bool can_fall_back = config_.fallback.enabled && providers_.size() > 1;
 
-    for (auto& [name, provider] : providers_) {
-        if (in_cooldown(name)) continue;
+    // Serialized once for every attempt; unchanged messages reuse their fragments
+    auto messages_body = std::make_shared<const std::string>(messages_json(messages));
 
+    std::string cache_key = response_cache_key(*messages_body, tools_spec, model, max_tokens, temperature, opts);
+    ProviderResponse cached;
+    if (!cache_key.empty() && !opts.bypass_cache && response_cache_->get(cache_key, cached)) return cached;
+    AttemptFn call = [&](size_t idx, CancelToken* cancel, StreamCallback) {
+        auto& provider = providers_[idx].second;
         // Adapt schema for this provider's flavor
         auto flavor = detect_schema_flavor(provider.config().api_base);
-        auto adapted = adapt_tools_schema(tools_spec, flavor);
+        ChatPayload payload{messages_body, tools_json_for(tools_spec, opts.tools_version, flavor)};
+        return provider.chat(payload, model, max_tokens, temperature, cancel);
+    };
+
+    auto order = route_order(false);
+    std::vector<bool> tried(providers_.size(), false);
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        size_t idx = order[pos];
+        if (tried[idx]) continue;
+        if (can_fall_back && !try_admit(idx)) continue;
 
         try {
-            auto resp = provider.chat(messages, adapted, model, max_tokens, temperature);
-            last_active_ = name;
+            auto resp = race(order, pos, false, call, nullptr, tried, opts.cancel);
+            if (!cache_key.empty()) response_cache_->put(cache_key, resp);
             return resp;
         } catch (const std::exception& e) {
             last_error = e.what();
-            auto kind = classify_provider_error(last_error);
-
-            if (config_.fallback.enabled && providers_.size() > 1) {
-                std::cerr << "[fallback] Provider '" << name << "' failed: " << last_error
+            if (opts.cancel && opts.cancel->cancelled()) throw;
+            if (can_fall_back) {
+                std::cerr << "[fallback] Provider '" << providers_[idx].first << "' failed: " << last_error
                           << " — trying next\n";
-                mark_cooldown(name, kind);
                 continue;
             }
             throw;  // single provider — just rethrow
@@ -94,31 +564,57 @@ ProviderResponse ProviderChain::chat(const std::vector<Message>& messages,
     throw std::runtime_error("All providers exhausted. Last error: " + last_error);
 }
 
-void ProviderChain::chat_stream(const std::vector<Message>& messages,
-                                 const nlohmann::json& tools_spec,
-                                 const std::string& model,
-                                 int max_tokens, double temperature,
-                                 StreamCallback on_token) {
+ProviderResponse ProviderChain::chat_stream(const std::vector<Message>& messages,
+                                             const nlohmann::json& tools_spec,
+                                             const std::string& model,
+                                             int max_tokens, double temperature,
+                                             StreamCallback on_token,
+                                             const ChatOptions& opts) {
     std::string last_error;
+    bool can_fall_back = config_.fallback.enabled && providers_.size() > 1;
+    std::atomic<bool> emitted{false};
+    StreamCallback tracked = [&](const std::string& token, bool done) {
+        if (!token.empty()) emitted = true;
+        if (on_token) on_token(token, done);
+    };
 
-    for (auto& [name, provider] : providers_) {
-        if (in_cooldown(name)) continue;
+    auto messages_body = std::make_shared<const std::string>(messages_json(messages));
 
+    // A cached reply is replayed as a single token
+    std::string cache_key = response_cache_key(*messages_body, tools_spec, model, max_tokens, temperature, opts);
+    ProviderResponse cached;
+    if (!cache_key.empty() && !opts.bypass_cache && response_cache_->get(cache_key, cached)) {
+        if (on_token) {
+            if (!cached.content.empty()) on_token(cached.content, false);
+            on_token("", true);
+        }
+        return cached;
+    }
+
+    AttemptFn call = [&](size_t idx, CancelToken* cancel, StreamCallback cb) {
+        auto& provider = providers_[idx].second;
         auto flavor = detect_schema_flavor(provider.config().api_base);
-        auto adapted = adapt_tools_schema(tools_spec, flavor);
+        ChatPayload payload{messages_body, tools_json_for(tools_spec, opts.tools_version, flavor)};
+        return provider.chat_stream(payload, model, max_tokens, temperature, cb, cancel);
+    };
+
+    auto order = route_order(true);
+    std::vector<bool> tried(providers_.size(), false);
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        size_t idx = order[pos];
+        if (tried[idx]) continue;
+        if (can_fall_back && !try_admit(idx)) continue;
 
         try {
-            provider.chat_stream(messages, adapted, model, max_tokens, temperature, on_token);
-            last_active_ = name;
-            return;
+            auto resp = race(order, pos, true, call, tracked, tried, opts.cancel);
+            if (!cache_key.empty()) response_cache_->put(cache_key, resp);
+            return resp;
         } catch (const std::exception& e) {
             last_error = e.what();
-            auto kind = classify_provider_error(last_error);
-
-            if (config_.fallback.enabled && providers_.size() > 1) {
-                std::cerr << "[fallback] Provider '" << name << "' stream failed: " << last_error
-                          << " — trying next\n";
-                mark_cooldown(name, kind);
+            if (opts.cancel && opts.cancel->cancelled()) throw;
+            if (can_fall_back && !emitted) {
+                std::cerr << "[fallback] Provider '" << providers_[idx].first << "' stream failed: "
+                          << last_error << " — trying next\n";
                 continue;
             }
             throw;
@@ -130,6 +626,44 @@ void ProviderChain::chat_stream(const std::vector<Message>& messages,
 
 EmbeddingResponse ProviderChain::embed(const std::vector<std::string>& texts,
                                         const std::string& model) {
+    auto upstream = [&](const std::vector<std::string>& batch) {
+        return embed_batcher_ ? embed_batcher_->embed(batch, model) : embed_uncached(batch, model);
+    };
+    if (!embed_cache_) return upstream(texts);
+
+    EmbeddingResponse resp;
+    resp.embeddings.resize(texts.size());
+    std::vector<std::string> keys(texts.size());
+
+    // Look everything up first; send only the misses, each distinct text once
+    std::vector<std::string> missing, missing_keys;
+    std::map<std::string, std::vector<size_t>> waiting;  // key -> positions
+    for (size_t i = 0; i < texts.size(); i++) {
+        keys[i] = EmbeddingCache::key_for(model, config_.embedding.dimensions, texts[i]);
+        if (embed_cache_->get(keys[i], resp.embeddings[i])) continue;
+        auto& slots = waiting[keys[i]];
+        if (slots.empty()) {
+            missing.push_back(texts[i]);
+            missing_keys.push_back(keys[i]);
+        }
+        slots.push_back(i);
+    }
+    if (missing.empty()) return resp;
+
+    auto fresh = upstream(missing);
+    if (fresh.embeddings.size() != missing.size()) {
+        throw std::runtime_error("Embedding response has " + std::to_string(fresh.embeddings.size()) +
+                                 " vectors for " + std::to_string(missing.size()) + " inputs");
+    }
+    for (size_t m = 0; m < missing.size(); m++) {
+        embed_cache_->put(missing_keys[m], fresh.embeddings[m]);
+        for (size_t i : waiting[missing_keys[m]]) resp.embeddings[i] = fresh.embeddings[m];
+    }
+    return resp;
+}
+
+EmbeddingResponse ProviderChain::embed_uncached(const std::vector<std::string>& texts,
+                                                const std::string& model) {
     if (embed_provider_) {
         return embed_provider_->embed(texts, model);
     }
@@ -2,10 +2,17 @@
 #include "config.hpp"
 #include "provider.hpp"
 #include "schema_adapter.hpp"
+#include "embedding_cache.hpp"
+#include "embed_batcher.hpp"
+#include "response_cache.hpp"
 #include <vector>
 #include <map>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <functional>
 
 namespace minidragon {
 
@@ -13,46 +20,153 @@ namespace minidragon {
 enum class ProviderErrorKind;
 ProviderErrorKind classify_provider_error(const std::string& error_text);
 
-struct ProviderCooldown {
-    int64_t until = 0;  // epoch seconds
-    ProviderErrorKind reason;
+// Circuit breaker: closed (normal) -> open after failure_threshold
+// consecutive failures (for the error kind's cooldown) -> half_open once
+// the cooldown expires, admitting a single probe request; the probe's
+// outcome closes or re-opens the circuit.
+enum class CircuitState { closed, open, half_open };
+
+const char* circuit_state_name(CircuitState s);
+
+// Per-provider routing signals (exponentially weighted moving averages)
+struct ProviderHealth {
+    std::string name;
+    CircuitState state = CircuitState::closed;
+    int64_t open_until = 0;          // epoch seconds, while open
+    bool probe_in_flight = false;    // half-open probe admitted
+    int consecutive_failures = 0;
+    double latency_ms = 0;           // full request (non-streaming)
+    double ttft_ms = 0;              // time to first token (streaming)
+    double error_rate = 0;           // EWMA of 0/1 outcomes
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    bool has_latency = false;
+    bool has_ttft = false;
+    uint64_t hedges = 0;             // hedge requests sent to this provider
+    uint64_t hedge_wins = 0;         // ...that answered first
+
+    // Latency sample the score uses; false when there is none yet
+    bool latency_sample(bool streaming, double& ms) const;
+    // Lower is better. prior_ms stands in for a missing latency sample, so
+    // a provider that has only failed still pays its error penalty.
+    double score(bool streaming, double prior_ms) const;
+};
+
+// Per-request knobs for ProviderChain::chat / chat_stream
+struct ChatOptions {
+    // ToolRegistry::version() of tools_spec; when non-zero the adapted,
+    // serialized tools array is cached per schema flavor
+    uint64_t tools_version = 0;
+    // Skip the response cache lookup (a fresh reply still refreshes it)
+    bool bypass_cache = false;
+    // Aborts the in-flight request (and any hedge); no fallback afterwards
+    CancelToken* cancel = nullptr;
 };
 
 class ProviderChain {
 public:
     explicit ProviderChain(const Config& cfg);
 
-    // Try providers in order, skip those in cooldown
+    // Try providers in routing order (fixed order, or best score first in
+    // adaptive mode), skipping those whose circuit is open. Identical
+    // deterministic requests are answered from the response cache if enabled.
     ProviderResponse chat(const std::vector<Message>& messages,
                           const nlohmann::json& tools_spec,
                           const std::string& model,
-                          int max_tokens, double temperature);
+                          int max_tokens, double temperature,
+                          const ChatOptions& opts = {});
 
-    void chat_stream(const std::vector<Message>& messages,
-                     const nlohmann::json& tools_spec,
-                     const std::string& model,
-                     int max_tokens, double temperature,
-                     StreamCallback on_token);
+    // Streaming variant; falls through to the next provider only while no
+    // token has been emitted yet (a half-streamed reply cannot be retried).
+    ProviderResponse chat_stream(const std::vector<Message>& messages,
+                                 const nlohmann::json& tools_spec,
+                                 const std::string& model,
+                                 int max_tokens, double temperature,
+                                 StreamCallback on_token,
+                                 const ChatOptions& opts = {});
 
-    // Embedding via a specific provider (for memory search)
+    // Embedding via a specific provider (for memory search). Texts already
+    // embedded with the same model are served from the embedding cache.
     EmbeddingResponse embed(const std::vector<std::string>& texts,
                             const std::string& model = "text-embedding-3-small");
 
+    // Null when the response cache is disabled
+    ResponseCache* response_cache() { return response_cache_.get(); }
+
+    // Null when embeddings or the cache are disabled
+    const EmbeddingCache* embedding_cache() const { return embed_cache_.get(); }
+    // Null when embeddings are disabled or batch_size is 1
+    const EmbedBatcher* embed_batcher() const { return embed_batcher_.get(); }
+
     std::string active_provider_name() const;
     size_t provider_count() const { return providers_.size(); }
 
+    // Keep-alive connection pool counters, keyed by provider name
+    std::map<std::string, HttpPoolStats> pool_stats() const;
+
+    // Routing scores and circuit state, in provider order
+    std::vector<ProviderHealth> health() const;
+    bool adaptive() const { return adaptive_; }
+    bool hedging() const;
+
 private:
     Config config_;
     std::vector<std::pair<std::string, Provider>> providers_;  // name → Provider
-    std::map<std::string, ProviderCooldown> cooldowns_;
+    std::vector<ProviderHealth> health_;  // parallel to providers_
+
+    // Recent latency samples and hedge budget bucket, parallel to providers_
+    struct HedgeState {
+        std::deque<double> latency_ms;
+        std::deque<double> ttft_ms;
+        double budget = 0;
+        std::chrono::steady_clock::time_point refilled;
+    };
+    std::vector<HedgeState> hedge_;
     std::string last_active_;
+    mutable std::mutex state_mutex_;  // guards health_ and last_active_ (chain is shared)
+    bool adaptive_ = false;
 
     // Embedding provider (may differ from chat providers)
     std::unique_ptr<Provider> embed_provider_;
+    std::unique_ptr<EmbeddingCache> embed_cache_;
+    std::unique_ptr<EmbedBatcher> embed_batcher_;  // after embed_provider_: its thread must stop first
+    EmbeddingResponse embed_uncached(const std::vector<std::string>& texts, const std::string& model);
+
+    // One connection pool per configured provider (shared with embed_provider_)
+    std::map<std::string, std::shared_ptr<HttpClientPool>> pools_;
+    std::shared_ptr<HttpClientPool> pool_for(const std::string& name, const ProviderConfig& pc);
 
     int cooldown_for(ProviderErrorKind kind) const;
-    void mark_cooldown(const std::string& name, ProviderErrorKind kind);
-    bool in_cooldown(const std::string& name) const;
+    void set_active(const std::string& name);
+
+    std::unique_ptr<ResponseCache> response_cache_;
+    std::string response_cache_key(const std::string& messages_body, const nlohmann::json& tools_spec,
+                                   const std::string& model, int max_tokens, double temperature,
+                                   const ChatOptions& opts);
+
+    // Adapted + serialized tools arrays, keyed by (registry version, flavor)
+    std::map<std::pair<uint64_t, SchemaFlavor>, std::shared_ptr<const std::string>> tools_json_;
+    std::mutex tools_json_mutex_;
+    std::shared_ptr<const std::string> tools_json_for(const nlohmann::json& tools_spec,
+                                                      uint64_t version, SchemaFlavor flavor);
+
+    // Routing / circuit breaker
+    std::vector<size_t> route_order(bool streaming) const;
+    bool try_admit(size_t idx);
+    void record_success(size_t idx, double latency_ms, bool streaming);
+    void record_failure(size_t idx, ProviderErrorKind kind, bool trip);
+    void record_lower_bound(size_t idx, double latency_ms, bool streaming);
+    void release_probe(size_t idx);
+
+    // Hedging
+    using AttemptFn = std::function<ProviderResponse(size_t idx, CancelToken* cancel, StreamCallback on_token)>;
+    ProviderResponse attempt(size_t idx, bool streaming, const AttemptFn& call,
+                             StreamCallback on_token, CancelToken* cancel);
+    ProviderResponse race(const std::vector<size_t>& order, size_t pos, bool streaming,
+                          const AttemptFn& call, StreamCallback on_token, std::vector<bool>& tried,
+                          CancelToken* cancel);
+    std::chrono::milliseconds hedge_delay(size_t idx, bool streaming) const;
+    bool take_hedge_budget(size_t idx);
 };
 
 } // namespace minidragon
@@ -0,0 +1,751 @@
+#include "regex_engine.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace minidragon {
+
+// ── Parser ──────────────────────────────────────────────────────────
+
+namespace {
+
+struct Node {
+    enum Kind { empty, byte_set, concat, alt, repeat, bol, eol } kind = empty;
+    int set = -1;
+    int min = 0, max = -1;  // repeat: max -1 = unbounded
+    std::vector<std::unique_ptr<Node>> kids;
+};
+using NodePtr = std::unique_ptr<Node>;
+
+NodePtr make_node(Node::Kind kind) {
+    auto n = std::make_unique<Node>();
+    n->kind = kind;
+    return n;
+}
+
+// Literal facts about a subpattern, for picking the prefilter
+struct LitInfo {
+    bool exact = false;  // always matches exactly str
+    std::string str;
+    std::string prefix, suffix, required;
+};
+
+const std::string& longer(const std::string& a, const std::string& b) {
+    return b.size() > a.size() ? b : a;
+}
+
+} // namespace
+
+class RegexCompiler {
+public:
+    RegexCompiler(const std::string& pattern, bool ignore_case, Regex& re)
+        : p_(pattern), icase_(ignore_case), re_(re) {}
+
+    bool run(std::string& error) {
+        NodePtr root = parse_alt();
+        if (err_.empty() && pos_ < p_.size()) fail("unmatched )");
+        if (!err_.empty()) {
+            error = err_;
+            return false;
+        }
+
+        LitInfo li = info(*root);
+        re_.required_ = li.exact ? li.str : li.required;
+        re_.is_literal_ = li.exact && !li.str.empty() && !has_anchor_ && li.str.find('\n') == std::string::npos;
+        re_.ignore_case_ = icase_;
+
+        re_.prog_.push_back({RegexInst::match});
+        re_.start_ = emit(*root, 0);
+        if (re_.prog_.size() > Regex::kMaxProgram) {
+            error = "pattern too large (expands to more than " + std::to_string(Regex::kMaxProgram) +
+                    " instructions)";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 200;
+    static constexpr int kMaxRepeat = 1000;
+
+    const std::string& p_;
+    size_t pos_ = 0;
+    bool icase_;
+    Regex& re_;
+    std::string err_;
+    int depth_ = 0;
+    bool has_anchor_ = false;
+
+    std::nullptr_t fail(const std::string& msg) {
+        if (err_.empty()) err_ = msg;
+        return nullptr;
+    }
+    bool more() const { return pos_ < p_.size(); }
+    unsigned char peek(size_t ahead = 0) const {
+        return pos_ + ahead < p_.size() ? static_cast<unsigned char>(p_[pos_ + ahead]) : 0;
+    }
+
+    // ── Byte sets ──
+
+    static void fold(std::bitset<256>& s) {
+        for (int c = 'a'; c <= 'z'; c++) {
+            if (s[c] || s[c - 32]) {
+                s[c] = true;
+                s[c - 32] = true;
+            }
+        }
+    }
+
+    NodePtr set_node(std::bitset<256> s) {
+        if (icase_) fold(s);
+        auto n = make_node(Node::byte_set);
+        n->set = static_cast<int>(re_.sets_.size());
+        re_.sets_.push_back(s);
+        return n;
+    }
+
+    NodePtr byte_node(unsigned char c) {
+        std::bitset<256> s;
+        s[c] = true;
+        return set_node(s);
+    }
+
+    static std::bitset<256> range(int lo, int hi) {
+        std::bitset<256> s;
+        for (int c = lo; c <= hi; c++) s[c] = true;
+        return s;
+    }
+
+    // One character: an allowed ASCII byte or any whole UTF-8 sequence
+    // (stray bytes that cannot start one match alone, so Latin-1 text
+    // still works)
+    NodePtr any_char(std::bitset<256> ascii) {
+        ascii[static_cast<unsigned char>('\n')] = false;
+        ascii |= range(0x80, 0xC1) | range(0xF5, 0xFF);
+        auto n = make_node(Node::alt);
+        n->kids.push_back(set_node(ascii));
+        for (int len = 2; len <= 4; len++) {
+            auto seq = make_node(Node::concat);
+            seq->kids.push_back(set_node(len == 2 ? range(0xC2, 0xDF) : len == 3 ? range(0xE0, 0xEF) : range(0xF0, 0xF4)));
+            for (int k = 1; k < len; k++) seq->kids.push_back(set_node(range(0x80, 0xBF)));
+            n->kids.push_back(std::move(seq));
+        }
+        return n;
+    }
+
+    static std::bitset<256> ascii_complement(const std::bitset<256>& s) {
+        return ~s & range(0, 0x7F);
+    }
+
+    // \d \w \s; false if c is not a class letter
+    static bool class_escape(unsigned char c, std::bitset<256>& out) {
+        switch (c) {
+        case 'd': out = range('0', '9'); return true;
+        case 'w': out = range('0', '9') | range('A', 'Z') | range('a', 'z'); out['_'] = true; return true;
+        case 's':
+            out.reset();
+            for (char w : {' ', '\t', '\n', '\r', '\f', '\v'}) out[static_cast<unsigned char>(w)] = true;
+            return true;
+        default: return false;
+        }
+    }
+
+    static int hex(unsigned char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Single-byte escapes (after the backslash): \t \n \r \f \v \xHH and
+    // escaped punctuation; -1 with an error otherwise
+    int byte_escape() {
+        unsigned char c = peek();
+        pos_++;
+        switch (c) {
+        case 't': return '\t';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case 'x': {
+            int h = hex(peek()), l = hex(peek(1));
+            if (h < 0 || l < 0) {
+                fail("\\x needs two hex digits");
+                return -1;
+            }
+            pos_ += 2;
+            return h * 16 + l;
+        }
+        default: break;
+        }
+        if (c == 0 || std::isalnum(c)) {
+            fail(c == 'b' || c == 'B' ? "\\b and \\B are not supported"
+                                      : std::string("unsupported escape \\") + static_cast<char>(c));
+            return -1;
+        }
+        return c;
+    }
+
+    // ── Grammar ──
+
+    NodePtr parse_alt() {
+        if (++depth_ > kMaxDepth) return fail("pattern nested too deeply");
+        NodePtr first = parse_concat();
+        if (!err_.empty()) return nullptr;
+        if (peek() != '|' || !more()) {
+            depth_--;
+            return first;
+        }
+        auto n = make_node(Node::alt);
+        n->kids.push_back(std::move(first));
+        while (more() && peek() == '|') {
+            pos_++;
+            n->kids.push_back(parse_concat());
+            if (!err_.empty()) return nullptr;
+        }
+        depth_--;
+        return n;
+    }
+
+    NodePtr parse_concat() {
+        auto n = make_node(Node::concat);
+        while (more() && peek() != '|' && peek() != ')') {
+            n->kids.push_back(parse_repeat());
+            if (!err_.empty()) return nullptr;
+        }
+        if (n->kids.size() == 1) return std::move(n->kids[0]);
+        return n;
+    }
+
+    // {m}, {m,}, {m,n}; false (position unchanged) if this '{' is a literal
+    bool parse_braces(int& min, int& max) {
+        size_t save = pos_;
+        pos_++;
+        auto number = [&](int& out) {
+            if (!std::isdigit(peek())) return false;
+            long v = 0;
+            while (std::isdigit(peek())) {
+                v = std::min<long>(v * 10 + (peek() - '0'), 1000000);
+                pos_++;
+            }
+            out = static_cast<int>(v);
+            return true;
+        };
+        if (!number(min)) {
+            pos_ = save;
+            return false;
+        }
+        max = min;
+        if (peek() == ',') {
+            pos_++;
+            max = -1;
+            if (peek() != '}' && !number(max)) {
+                pos_ = save;
+                return false;
+            }
+        }
+        if (peek() != '}') {
+            pos_ = save;
+            return false;
+        }
+        pos_++;
+        return true;
+    }
+
+    NodePtr parse_repeat() {
+        NodePtr atom = parse_atom();
+        if (!err_.empty()) return nullptr;
+        int min, max;
+        unsigned char c = peek();
+        if (!more()) {
+            return atom;
+        } else if (c == '*') {
+            min = 0, max = -1, pos_++;
+        } else if (c == '+') {
+            min = 1, max = -1, pos_++;
+        } else if (c == '?') {
+            min = 0, max = 1, pos_++;
+        } else if (c == '{' && parse_braces(min, max)) {
+            if (min > kMaxRepeat || max > kMaxRepeat) return fail("repetition count above 1000");
+            if (max >= 0 && max < min) return fail("bad repetition range {m,n} with n < m");
+        } else {
+            return atom;
+        }
+        // Lazy and possessive forms match the same lines; a further
+        // quantifier is an error, as in ECMAScript
+        if (peek() == '?' || peek() == '+') pos_++;
+        auto r = make_node(Node::repeat);
+        r->min = min;
+        r->max = max;
+        r->kids.push_back(std::move(atom));
+        return r;
+    }
+
+    NodePtr parse_atom() {
+        unsigned char c = peek();
+        switch (c) {
+        case '(': {
+            pos_++;
+            if (peek() == '?') {
+                if (peek(1) != ':') return fail("only (?:...) groups are supported");
+                pos_ += 2;
+            }
+            NodePtr inner = peek() == ')' ? make_node(Node::empty) : parse_alt();
+            if (!err_.empty()) return nullptr;
+            if (peek() != ')' || !more()) return fail("missing )");
+            pos_++;
+            return inner;
+        }
+        case '[': return parse_class();
+        case '.': pos_++; return any_char(range(0, 0x7F));
+        case '^': pos_++; has_anchor_ = true; return make_node(Node::bol);
+        case '$': pos_++; has_anchor_ = true; return make_node(Node::eol);
+        case '*': case '+': case '?': return fail(std::string("nothing to repeat before ") + static_cast<char>(c));
+        case '{': {
+            int min, max;
+            size_t save = pos_;
+            if (parse_braces(min, max)) return fail("nothing to repeat before {");
+            pos_ = save + 1;
+            return byte_node(c);
+        }
+        case '\\': {
+            pos_++;
+            std::bitset<256> s;
+            unsigned char e = peek();
+            if (class_escape(e, s)) {
+                pos_++;
+                return set_node(s);
+            }
+            if (class_escape(static_cast<unsigned char>(std::tolower(e)), s) && std::isupper(e)) {
+                pos_++;
+                return any_char(ascii_complement(s));
+            }
+            int b = byte_escape();
+            if (b < 0) return nullptr;
+            return byte_node(static_cast<unsigned char>(b));
+        }
+        default: break;
+        }
+        // A literal character; a UTF-8 sequence stays one atom so "é+"
+        // repeats the whole character
+        size_t len = c < 0xC0 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        if (len == 1 || pos_ + len > p_.size()) {
+            pos_++;
+            return byte_node(c);
+        }
+        auto n = make_node(Node::concat);
+        for (size_t k = 0; k < len; k++) n->kids.push_back(byte_node(static_cast<unsigned char>(p_[pos_ + k])));
+        pos_ += len;
+        return n;
+    }
+
+    NodePtr parse_class() {
+        pos_++;  // '['
+        bool negated = peek() == '^';
+        if (negated) pos_++;
+        std::bitset<256> members;
+        bool first = true;
+        while (more() && (first || peek() != ']')) {
+            first = false;
+            unsigned char c = peek();
+            if (c == '[' && peek(1) == ':') {
+                size_t end = p_.find(":]", pos_ + 2);
+                if (end == std::string::npos) return fail("missing :] in character class");
+                std::string name = p_.substr(pos_ + 2, end - pos_ - 2);
+                std::bitset<256> s;
+                if (!posix_class(name, s)) return fail("unknown character class [:" + name + ":]");
+                members |= s;
+                pos_ = end + 2;
+                continue;
+            }
+            if (c >= 0x80) return fail("non-ASCII characters in [...] are not supported");
+            int lo = c;
+            pos_++;
+            if (c == '\\') {
+                std::bitset<256> s;
+                if (class_escape(peek(), s)) {
+                    pos_++;
+                    members |= s;
+                    continue;
+                }
+                lo = byte_escape();
+                if (lo < 0) return nullptr;
+            }
+            int hi = lo;
+            if (peek() == '-' && peek(1) != ']' && pos_ + 1 < p_.size()) {
+                pos_++;
+                unsigned char h = peek();
+                if (h >= 0x80) return fail("non-ASCII characters in [...] are not supported");
+                pos_++;
+                hi = h;
+                if (h == '\\') {
+                    hi = byte_escape();
+                    if (hi < 0) return nullptr;
+                }
+                if (hi < lo) return fail("bad range in character class");
+            }
+            members |= range(lo, hi);
+        }
+        if (!more()) return fail("missing ]");
+        pos_++;  // ']'
+        if (!negated) return set_node(members);
+        if (icase_) fold(members);
+        return any_char(ascii_complement(members));
+    }
+
+    static bool posix_class(const std::string& name, std::bitset<256>& s) {
+        if (name == "alpha") s = range('a', 'z') | range('A', 'Z');
+        else if (name == "digit") s = range('0', '9');
+        else if (name == "alnum") s = range('a', 'z') | range('A', 'Z') | range('0', '9');
+        else if (name == "upper") s = range('A', 'Z');
+        else if (name == "lower") s = range('a', 'z');
+        else if (name == "xdigit") s = range('0', '9') | range('a', 'f') | range('A', 'F');
+        else if (name == "space") class_escape('s', s);
+        else if (name == "word") class_escape('w', s);
+        else if (name == "punct") {
+            s = range(0x21, 0x2F) | range(0x3A, 0x40) | range(0x5B, 0x60) | range(0x7B, 0x7E);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // ── Literal extraction ──
+
+    // The byte a set stands for, if it is one character (case-folded sets
+    // of one letter count when ignoring case)
+    int lit_char(int set) const {
+        const auto& s = re_.sets_[set];
+        size_t count = s.count();
+        if (count == 1) {
+            for (int c = 0; c < 256; c++) if (s[c]) return c;
+        }
+        if (count == 2 && icase_) {
+            for (int c = 'a'; c <= 'z'; c++) if (s[c] && s[c - 32]) return c;
+        }
+        return -1;
+    }
+
+    static std::string common_prefix(const std::string& a, const std::string& b) {
+        size_t i = 0;
+        while (i < a.size() && i < b.size() && a[i] == b[i]) i++;
+        return a.substr(0, i);
+    }
+    static std::string common_suffix(const std::string& a, const std::string& b) {
+        size_t i = 0;
+        while (i < a.size() && i < b.size() && a[a.size() - 1 - i] == b[b.size() - 1 - i]) i++;
+        return a.substr(a.size() - i);
+    }
+
+    LitInfo info(const Node& n) const {
+        LitInfo li;
+        switch (n.kind) {
+        case Node::empty:
+        case Node::bol:
+        case Node::eol:
+            li.exact = true;
+            return li;
+        case Node::byte_set: {
+            int c = lit_char(n.set);
+            if (c >= 0) {
+                li.exact = true;
+                li.str = std::string(1, static_cast<char>(c));
+            }
+            return li;
+        }
+        case Node::concat: {
+            std::string run;
+            bool all_exact = true;
+            for (auto& kid : n.kids) {
+                LitInfo k = info(*kid);
+                if (k.exact) {
+                    run += k.str;
+                    continue;
+                }
+                std::string joined = run + k.prefix;
+                if (all_exact) li.prefix = joined;
+                li.required = longer(longer(li.required, joined), k.required);
+                all_exact = false;
+                run = k.suffix;
+            }
+            if (all_exact) {
+                li.exact = true;
+                li.str = run;
+                return li;
+            }
+            li.suffix = run;
+            li.required = longer(li.required, run);
+            return li;
+        }
+        case Node::alt: {
+            std::vector<LitInfo> ks;
+            for (auto& kid : n.kids) ks.push_back(info(*kid));
+            bool same = true;
+            for (auto& k : ks) same = same && k.exact && k.str == ks[0].str;
+            if (same) return ks[0];
+            li.prefix = ks[0].exact ? ks[0].str : ks[0].prefix;
+            li.suffix = ks[0].exact ? ks[0].str : ks[0].suffix;
+            for (auto& k : ks) {
+                li.prefix = common_prefix(li.prefix, k.exact ? k.str : k.prefix);
+                li.suffix = common_suffix(li.suffix, k.exact ? k.str : k.suffix);
+            }
+            li.required = longer(li.prefix, li.suffix);
+            return li;
+        }
+        case Node::repeat: {
+            if (n.min == 0) return li;
+            LitInfo k = info(*n.kids[0]);
+            if (k.exact && n.min == n.max && k.str.size() * n.min <= 256) {
+                li.exact = true;
+                for (int i = 0; i < n.min; i++) li.str += k.str;
+                return li;
+            }
+            li.prefix = k.exact ? k.str : k.prefix;
+            li.suffix = k.exact ? k.str : k.suffix;
+            li.required = longer(k.exact ? k.str : k.required, longer(li.prefix, li.suffix));
+            return li;
+        }
+        }
+        return li;
+    }
+
+    // ── Thompson construction ──
+    // Continuation style: emit(n, next) returns the entry of n's code,
+    // which continues at next
+
+    int push(RegexInst in) {
+        re_.prog_.push_back(in);
+        return static_cast<int>(re_.prog_.size() - 1);
+    }
+
+    int emit(const Node& n, int next) {
+        if (re_.prog_.size() > Regex::kMaxProgram) return next;  // reported by run()
+        switch (n.kind) {
+        case Node::empty: return next;
+        case Node::byte_set: return push({RegexInst::bytes, next, -1, n.set});
+        case Node::bol: return push({RegexInst::bol, next});
+        case Node::eol: return push({RegexInst::eol, next});
+        case Node::concat: {
+            int e = next;
+            for (auto it = n.kids.rbegin(); it != n.kids.rend(); ++it) e = emit(**it, e);
+            return e;
+        }
+        case Node::alt: {
+            int e = emit(*n.kids.back(), next);
+            for (size_t i = n.kids.size() - 1; i-- > 0;) {
+                int branch = emit(*n.kids[i], next);
+                e = push({RegexInst::split, branch, e});
+            }
+            return e;
+        }
+        case Node::repeat: {
+            const Node& kid = *n.kids[0];
+            int e = next;
+            if (n.max < 0) {
+                int loop = push({RegexInst::split, -1, next});
+                int body = emit(kid, loop);
+                re_.prog_[loop].out = body;
+                e = loop;
+            } else {
+                // x{0,k} as (x(x(x)?)?)?: every skip jumps straight to next
+                for (int i = 0; i < n.max - n.min; i++) {
+                    int body = emit(kid, e);
+                    e = push({RegexInst::split, body, next});
+                }
+            }
+            for (int i = 0; i < n.min; i++) e = emit(kid, e);
+            return e;
+        }
+        }
+        return next;
+    }
+};
+
+std::unique_ptr<Regex> Regex::compile(const std::string& pattern, bool ignore_case, std::string& error) {
+    auto re = std::unique_ptr<Regex>(new Regex());
+    RegexCompiler compiler(pattern, ignore_case, *re);
+    if (!compiler.run(error)) return nullptr;
+    return re;
+}
+
+// ── Lazy DFA ────────────────────────────────────────────────────────
+
+static constexpr size_t kMaxFlushes = 8;
+
+RegexMatcher::RegexMatcher(const Regex& re, size_t max_bytes)
+    : re_(re), max_bytes_(std::max<size_t>(max_bytes, 64 * 1024)), mark_(re.program().size(), 0) {
+    begin_set();
+    add_closure(re_.start(), false, false, restart_);
+    std::sort(restart_.begin(), restart_.end());
+}
+
+void RegexMatcher::begin_set() {
+    if (++gen_ == 0) {
+        std::fill(mark_.begin(), mark_.end(), 0);
+        gen_ = 1;
+    }
+}
+
+// Adds the threads reachable from pc without consuming input. '^' passes
+// only at a line start; '$' is kept as a thread until the line ends.
+void RegexMatcher::add_closure(int pc, bool bol, bool eol, std::vector<int>& out) {
+    const auto& prog = re_.program();
+    stack_.push_back(pc);
+    while (!stack_.empty()) {
+        int i = stack_.back();
+        stack_.pop_back();
+        if (i < 0 || mark_[i] == gen_) continue;
+        mark_[i] = gen_;
+        const RegexInst& in = prog[i];
+        switch (in.op) {
+        case RegexInst::split:
+            stack_.push_back(in.alt);
+            stack_.push_back(in.out);
+            break;
+        case RegexInst::jmp:
+            stack_.push_back(in.out);
+            break;
+        case RegexInst::bol:
+            if (bol) stack_.push_back(in.out);
+            break;
+        case RegexInst::eol:
+            if (eol) stack_.push_back(in.out);
+            else out.push_back(i);
+            break;
+        case RegexInst::bytes:
+        case RegexInst::match:
+            out.push_back(i);
+            break;
+        }
+    }
+}
+
+std::vector<int> RegexMatcher::step(const std::vector<int>& from, unsigned char b) {
+    const auto& prog = re_.program();
+    const auto& sets = re_.sets();
+    std::vector<int> out;
+    begin_set();
+    for (int i : from) {
+        const RegexInst& in = prog[i];
+        if (in.op == RegexInst::bytes && sets[in.set][b]) add_closure(in.out, false, false, out);
+    }
+    // A match may also start right after this byte
+    for (int i : restart_) {
+        if (mark_[i] != gen_) {
+            mark_[i] = gen_;
+            out.push_back(i);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+bool RegexMatcher::eol_accepts(const std::vector<int>& insts, bool bol) {
+    const auto& prog = re_.program();
+    std::vector<int> out;
+    begin_set();
+    for (int i : insts) {
+        if (prog[i].op == RegexInst::match) return true;
+        if (prog[i].op == RegexInst::eol) add_closure(prog[i].out, bol, true, out);
+    }
+    for (int i : out) {
+        if (prog[i].op == RegexInst::match) return true;
+    }
+    return false;
+}
+
+static uint64_t hash_insts(const std::vector<int>& insts) {
+    uint64_t h = 1469598103934665603ull;  // FNV-1a over the instruction indices
+    for (int i : insts) {
+        h ^= static_cast<uint32_t>(i);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+int RegexMatcher::intern(const std::vector<int>& insts) {
+    uint64_t h = hash_insts(insts);
+    auto range = index_.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (states_[it->second]->insts == insts) return it->second;
+    }
+    // State, its thread list and the index node
+    size_t cost = sizeof(State) + insts.size() * sizeof(int) + 4 * sizeof(void*);
+    if (!states_.empty() && bytes_ + cost > max_bytes_) return -1;
+
+    auto st = std::make_unique<State>();
+    st->insts = insts;
+    std::fill(std::begin(st->next), std::end(st->next), -1);
+    const auto& prog = re_.program();
+    for (int i : insts) st->match = st->match || prog[i].op == RegexInst::match;
+    st->dead = insts.empty();
+    int id = static_cast<int>(states_.size());
+    states_.push_back(std::move(st));
+    index_.emplace(h, id);
+    bytes_ += cost;
+    return id;
+}
+
+// Interns, flushing a full cache first; -1 once the matcher gave up on
+// the DFA (too many flushes)
+int RegexMatcher::intern_or_flush(const std::vector<int>& insts) {
+    int id = intern(insts);
+    if (id >= 0) return id;
+    states_.clear();
+    index_.clear();
+    bytes_ = 0;
+    bol_start_ = -1;
+    if (++flushes_ > kMaxFlushes) {
+        nfa_only_ = true;
+        return -1;
+    }
+    return intern(insts);
+}
+
+bool RegexMatcher::match_line(const char* line, size_t n) {
+    if (!nfa_only_ && bol_start_ < 0) {
+        std::vector<int> start;
+        begin_set();
+        add_closure(re_.start(), true, false, start);
+        std::sort(start.begin(), start.end());
+        bol_start_ = intern_or_flush(start);
+    }
+    int s = nfa_only_ ? -1 : bol_start_;
+    for (size_t i = 0; s >= 0; i++) {
+        State* st = states_[s].get();
+        if (st->match) return true;
+        if (st->dead) return false;
+        if (n == 0) return eol_accepts(st->insts, true);  // "^$" and friends
+        if (i == n) {
+            if (st->eol_match < 0) st->eol_match = eol_accepts(st->insts, false) ? 1 : 0;
+            return st->eol_match == 1;
+        }
+        unsigned char b = static_cast<unsigned char>(line[i]);
+        int t = st->next[b];
+        if (t < 0) {
+            size_t flushes = flushes_;
+            t = intern_or_flush(step(st->insts, b));
+            if (t >= 0 && flushes == flushes_) st->next[b] = t;  // st is gone after a flush
+        }
+        s = t;
+    }
+    return match_nfa(line, n);
+}
+
+// The same automaton stepped directly, without caching states
+bool RegexMatcher::match_nfa(const char* line, size_t n) {
+    const auto& prog = re_.program();
+    std::vector<int> cur;
+    begin_set();
+    add_closure(re_.start(), true, false, cur);
+    for (size_t i = 0; i < n; i++) {
+        for (int pc : cur) {
+            if (prog[pc].op == RegexInst::match) return true;
+        }
+        cur = step(cur, static_cast<unsigned char>(line[i]));
+        if (cur.empty()) return false;
+    }
+    return eol_accepts(cur, n == 0);
+}
+
+} // namespace minidragon
@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <bitset>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+namespace minidragon {
+
+// ── Line regex engine ───────────────────────────────────────────────
+// Linear-time matching for grep: the pattern is compiled to a Thompson NFA
+// over bytes, and each RegexMatcher builds DFA states from it lazily as
+// input needs them. Every byte costs one table lookup once its state exists,
+// and no input can cause backtracking.
+//
+// Syntax: literals, '.', [...] / [^...] (ASCII members, ranges), \d \w \s
+// and their negations, \t \n \r \xHH, escaped punctuation, (...), (?:...),
+// '|', '*', '+', '?', {m}, {m,}, {m,n} (lazy '?' suffixes are accepted; for
+// "does this line match" they change nothing), '^' and '$' at line
+// boundaries. '.' and negated classes match whole UTF-8 characters. There
+// are no captures, backreferences or lookaround; \b is not supported.
+
+struct RegexInst {
+    enum Op : uint8_t { bytes, split, jmp, bol, eol, match } op;
+    int out = -1;   // next instruction (bytes, jmp, bol, eol; split: first choice)
+    int alt = -1;   // split: second choice
+    int set = -1;   // bytes: index into the program's byte sets
+};
+
+class Regex {
+public:
+    // nullptr and a message in error for invalid or oversized patterns
+    static std::unique_ptr<Regex> compile(const std::string& pattern, bool ignore_case, std::string& error);
+
+    // A literal that every match contains ("" if none was found). Lines
+    // without it cannot match, so callers scan for it first.
+    const std::string& required_literal() const { return required_; }
+    // True when the pattern is exactly required_literal(): no automaton needed
+    bool is_literal() const { return is_literal_; }
+    bool ignore_case() const { return ignore_case_; }
+
+    const std::vector<RegexInst>& program() const { return prog_; }
+    const std::vector<std::bitset<256>>& sets() const { return sets_; }
+    int start() const { return start_; }
+
+    static constexpr size_t kMaxProgram = 20000;  // instructions after expanding {m,n}
+
+private:
+    friend class RegexCompiler;
+    std::vector<RegexInst> prog_;
+    std::vector<std::bitset<256>> sets_;
+    int start_ = 0;
+    std::string required_;
+    bool is_literal_ = false;
+    bool ignore_case_ = false;
+};
+
+// Matches lines against one Regex with a private DFA cache, so each search
+// thread uses its own. The cache holds at most max_bytes of states: each
+// costs a 1 KiB transition table plus 4 bytes per NFA thread it stands for,
+// which for a large program can be tens of KiB. When the cache is full it
+// is flushed and rebuilt on demand. A query that keeps flushing switches to
+// stepping the NFA directly: still linear, with no cache at all.
+class RegexMatcher {
+public:
+    explicit RegexMatcher(const Regex& re, size_t max_bytes = 2 << 20);
+
+    // Whether [line, line + n) contains a match; the line holds no '\n'
+    bool match_line(const char* line, size_t n);
+
+    size_t cache_flushes() const { return flushes_; }
+
+private:
+    struct State {
+        std::vector<int> insts;  // sorted NFA threads: bytes, eol and match instructions
+        int32_t next[256];       // -1 = not built yet
+        bool match = false;
+        bool dead = false;       // no threads left (only once the pattern is anchored)
+        int8_t eol_match = -1;   // match at end of line (-1 = not computed)
+    };
+
+    const Regex& re_;
+    size_t max_bytes_;
+    size_t bytes_ = 0;  // states_ and index_, estimated
+    std::vector<std::unique_ptr<State>> states_;
+    std::unordered_multimap<uint64_t, int> index_;  // hash of insts -> states_ ids
+    int bol_start_ = -1;
+    std::vector<int> restart_;  // threads injected at every position (unanchored search)
+    size_t flushes_ = 0;
+    bool nfa_only_ = false;
+
+    std::vector<uint32_t> mark_;
+    uint32_t gen_ = 0;
+    std::vector<int> stack_;
+
+    void begin_set();
+    void add_closure(int pc, bool bol, bool eol, std::vector<int>& out);
+    std::vector<int> step(const std::vector<int>& from, unsigned char b);
+    bool eol_accepts(const std::vector<int>& insts, bool bol);
+    int intern(const std::vector<int>& insts);
+    int intern_or_flush(const std::vector<int>& insts);
+    bool match_nfa(const char* line, size_t n);
+};
+
+} // namespace minidragon
@@ -0,0 +1,177 @@
+#include "response_cache.hpp"
+#include "sha256.hpp"
+#include "utils.hpp"
+#include <sqlite3.h>
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+
+namespace minidragon {
+
+ResponseCache::ResponseCache(const std::string& db_path, int ttl, int max_entries)
+    : ttl_(ttl), max_entries_(max_entries) {
+    fs::create_directories(fs::path(db_path).parent_path());
+    if (sqlite3_open(db_path.c_str(), &db_) != SQLITE_OK) {
+        std::cerr << "[response_cache] Failed to open database: " << sqlite3_errmsg(db_) << "\n";
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return;
+    }
+
+    const char* sql = R"SQL(
+        PRAGMA journal_mode=WAL;
+        PRAGMA synchronous=NORMAL;
+        CREATE TABLE IF NOT EXISTS responses (
+            key TEXT PRIMARY KEY,
+            response TEXT NOT NULL,
+            created_at INTEGER NOT NULL,
+            last_used INTEGER NOT NULL
+        ) WITHOUT ROWID;
+        CREATE INDEX IF NOT EXISTS idx_responses_last_used ON responses(last_used);
+    )SQL";
+    char* err = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "[response_cache] Schema init error: " << (err ? err : "unknown") << "\n";
+        sqlite3_free(err);
+    }
+}
+
+ResponseCache::~ResponseCache() {
+    if (db_) sqlite3_close(db_);
+}
+
+std::string ResponseCache::key_for(const std::string& model, int max_tokens, double temperature,
+                                   const std::string& messages_json, const std::string& tools_json) {
+    char params[64];
+    std::snprintf(params, sizeof(params), "%d|%.17g", max_tokens, temperature);
+
+    std::string canonical;
+    canonical.reserve(model.size() + messages_json.size() + tools_json.size() + 80);
+    canonical += model;
+    canonical += '\0';
+    canonical += params;
+    canonical += '\0';
+    canonical += messages_json;
+    canonical += '\0';
+    canonical += tools_json;
+    return sha256_hex(canonical);
+}
+
+bool ResponseCache::get(const std::string& key, ProviderResponse& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) {
+        misses_++;
+        return false;
+    }
+
+    int64_t now = epoch_now();
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "SELECT response FROM responses WHERE key = ? AND created_at > ?",
+                       -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, now - ttl_);
+    bool found = false;
+    bool unreadable = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        try {
+            auto j = nlohmann::json::parse(text ? text : "");
+            ProviderResponse resp;
+            resp.content = j.value("content", "");
+            for (auto& tc : j.value("tool_calls", nlohmann::json::array())) {
+                ToolCall t;
+                t.id = tc.value("id", "");
+                t.name = tc.value("name", "");
+                t.arguments = tc.value("arguments", "");
+                resp.tool_calls.push_back(std::move(t));
+            }
+            out = std::move(resp);
+            found = true;
+        } catch (const std::exception& e) {
+            std::cerr << "[response_cache] Dropping unreadable entry: " << e.what() << "\n";
+            unreadable = true;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (unreadable) {
+        sqlite3_prepare_v2(db_, "DELETE FROM responses WHERE key = ?", -1, &stmt, nullptr);
+        sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
+    if (!found) {
+        misses_++;
+        return false;
+    }
+
+    sqlite3_prepare_v2(db_, "UPDATE responses SET last_used = ? WHERE key = ?", -1, &stmt, nullptr);
+    sqlite3_bind_int64(stmt, 1, now);
+    sqlite3_bind_text(stmt, 2, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    hits_++;
+    return true;
+}
+
+void ResponseCache::put(const std::string& key, const ProviderResponse& resp) {
+    nlohmann::json j;
+    j["content"] = resp.content;
+    auto& calls = j["tool_calls"];
+    calls = nlohmann::json::array();
+    for (auto& tc : resp.tool_calls) {
+        calls.push_back({{"id", tc.id}, {"name", tc.name}, {"arguments", tc.arguments}});
+    }
+    std::string text = j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) return;
+
+    int64_t now = epoch_now();
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO responses (key, response, created_at, last_used) "
+                            "VALUES (?, ?, ?, ?)", -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, text.c_str(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, now);
+    sqlite3_bind_int64(stmt, 4, now);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "[response_cache] Write failed: " << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+    stores_++;
+    evict_locked();
+}
+
+void ResponseCache::evict_locked() {
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "DELETE FROM responses WHERE created_at <= ?", -1, &stmt, nullptr);
+    sqlite3_bind_int64(stmt, 1, epoch_now() - ttl_);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    sqlite3_prepare_v2(db_, "DELETE FROM responses WHERE key IN ("
+                            "SELECT key FROM responses ORDER BY last_used DESC LIMIT -1 OFFSET ?)",
+                       -1, &stmt, nullptr);
+    sqlite3_bind_int(stmt, 1, std::max(max_entries_, 0));
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+}
+
+ResponseCacheStats ResponseCache::stats() const {
+    ResponseCacheStats s;
+    s.hits = hits_;
+    s.misses = misses_;
+    s.stores = stores_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (db_) {
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(db_, "SELECT COUNT(*) FROM responses", -1, &stmt, nullptr);
+        if (sqlite3_step(stmt) == SQLITE_ROW) s.entries = static_cast<size_t>(sqlite3_column_int64(stmt, 0));
+        sqlite3_finalize(stmt);
+    }
+    return s;
+}
+
+} // namespace minidragon
@@ -0,0 +1,54 @@
+#pragma once
+#include "provider.hpp"
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+struct sqlite3;
+
+namespace minidragon {
+
+struct ResponseCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    size_t entries = 0;
+};
+
+// Replays provider responses (content and tool calls) for byte-identical
+// requests: same model, sampling parameters, serialized history and tools.
+// Entries live in SQLite so cron jobs and automated runs hit across
+// restarts; they expire after ttl seconds and the least recently used are
+// evicted beyond max_entries. Thread-safe.
+class ResponseCache {
+public:
+    ResponseCache(const std::string& db_path, int ttl, int max_entries);
+    ~ResponseCache();
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    // sha256 over the canonical request
+    static std::string key_for(const std::string& model, int max_tokens, double temperature,
+                               const std::string& messages_json, const std::string& tools_json);
+
+    bool get(const std::string& key, ProviderResponse& out);
+    void put(const std::string& key, const ProviderResponse& resp);
+
+    ResponseCacheStats stats() const;
+
+private:
+    sqlite3* db_ = nullptr;
+    int ttl_;
+    int max_entries_;
+    mutable std::mutex mutex_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> stores_{0};
+
+    void evict_locked();
+};
+
+} // namespace minidragon
@@ -0,0 +1,421 @@
+#include "response_parser.hpp"
+#include <string_view>
+#include <stdexcept>
+#include <charconv>
+#include <cstdint>
+
+namespace minidragon {
+
+using json = nlohmann::json;
+
+// ── In-place JSON scanner ───────────────────────────────────────────
+
+// Recursive-descent walker over the raw body. Callers pull the values they
+// want and skip() the rest; any syntax error makes the scan fail.
+class JsonScanner {
+public:
+    explicit JsonScanner(std::string_view s) : p_(s.data()), end_(s.data() + s.size()) {}
+
+    char peek() {
+        ws();
+        return p_ < end_ ? *p_ : '\0';
+    }
+    bool at_end() {
+        ws();
+        return p_ == end_;
+    }
+
+    // Calls on_key(key) for each member; on_key must consume the value
+    template <typename Fn>
+    bool object(Fn&& on_key) {
+        if (!consume('{')) return false;
+        if (consume('}')) return true;
+        if (++depth_ > kMaxDepth) return false;
+        do {
+            std::string_view k;
+            if (!key(k) || !consume(':') || !on_key(k)) return false;
+        } while (consume(','));
+        depth_--;
+        return consume('}');
+    }
+
+    // Calls on_elem() for each element; on_elem must consume it
+    template <typename Fn>
+    bool array(Fn&& on_elem) {
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        if (++depth_ > kMaxDepth) return false;
+        do {
+            if (!on_elem()) return false;
+        } while (consume(','));
+        depth_--;
+        return consume(']');
+    }
+
+    bool string(std::string& out) {
+        if (!consume('"')) return false;
+        out.clear();
+        while (p_ < end_) {
+            // Copy unescaped runs in one go
+            const char* run = p_;
+            bool ascii = true;
+            while (p_ < end_ && *p_ != '"' && *p_ != '\\' && static_cast<unsigned char>(*p_) >= 0x20) {
+                ascii = ascii && static_cast<unsigned char>(*p_) < 0x80;
+                p_++;
+            }
+            if (!ascii && !valid_utf8(run, p_)) return false;
+            out.append(run, p_);
+            if (p_ == end_ || static_cast<unsigned char>(*p_) < 0x20) return false;
+            if (*p_++ == '"') return true;
+            if (!escape(out)) return false;
+        }
+        return false;
+    }
+
+    // JSON grammar first: from_chars alone also takes "-inf", "-nan", "01"
+    // and "1.", which the DOM parser rejects
+    bool number(double& out) {
+        ws();
+        auto digit = [&](const char* q) { return q < end_ && *q >= '0' && *q <= '9'; };
+        const char* q = p_;
+        if (q < end_ && *q == '-') q++;
+        if (!digit(q)) return false;
+        if (*q++ != '0') {
+            while (digit(q)) q++;
+        }
+        if (q < end_ && *q == '.') {
+            if (!digit(++q)) return false;
+            while (digit(q)) q++;
+        }
+        if (q < end_ && (*q == 'e' || *q == 'E')) {
+            q++;
+            if (q < end_ && (*q == '+' || *q == '-')) q++;
+            if (!digit(q)) return false;
+            while (digit(q)) q++;
+        }
+        auto [ptr, ec] = std::from_chars(p_, q, out);
+        if (ec != std::errc() || ptr != q) return false;
+        p_ = q;
+        return true;
+    }
+
+    bool null() { return literal("null"); }
+
+    bool skip() {
+        switch (peek()) {
+        case '"': return skip_string();
+        case '{': return object([&](std::string_view) { return skip(); });
+        case '[': return array([&] { return skip(); });
+        case 't': return literal("true");
+        case 'f': return literal("false");
+        case 'n': return literal("null");
+        default: {
+            double d;
+            return number(d);
+        }
+        }
+    }
+
+private:
+    static constexpr int kMaxDepth = 256;
+    const char* p_;
+    const char* end_;
+    int depth_ = 0;
+    std::string key_buf_;
+
+    void ws() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+    }
+    bool consume(char c) {
+        ws();
+        if (p_ < end_ && *p_ == c) {
+            p_++;
+            return true;
+        }
+        return false;
+    }
+    bool literal(std::string_view word) {
+        ws();
+        if (static_cast<size_t>(end_ - p_) < word.size() || std::string_view(p_, word.size()) != word) return false;
+        p_ += word.size();
+        return true;
+    }
+
+    // Keys without escapes are returned as views into the body
+    bool key(std::string_view& out) {
+        ws();
+        if (p_ == end_ || *p_ != '"') return false;
+        const char* start = p_ + 1;
+        const char* q = start;
+        while (q < end_ && *q != '"' && *q != '\\') q++;
+        if (q < end_ && *q == '"') {
+            out = std::string_view(start, q - start);
+            p_ = q + 1;
+            return true;
+        }
+        if (!string(key_buf_)) return false;
+        out = key_buf_;
+        return true;
+    }
+
+    bool skip_string() {
+        if (!consume('"')) return false;
+        while (p_ < end_) {
+            char c = *p_++;
+            if (c == '"') return true;
+            if (c == '\\') {
+                if (p_ == end_) return false;
+                p_++;
+            }
+        }
+        return false;
+    }
+
+    // Strict UTF-8 (no overlong forms, surrogates or code points past
+    // U+10FFFF), as the DOM parser checks it
+    static bool valid_utf8(const char* s, const char* e) {
+        while (s < e) {
+            unsigned char c = static_cast<unsigned char>(*s++);
+            if (c < 0x80) continue;
+            int more;
+            unsigned char lo = 0x80, hi = 0xBF;  // bounds of the second byte
+            if (c >= 0xC2 && c <= 0xDF) {
+                more = 1;
+            } else if (c >= 0xE0 && c <= 0xEF) {
+                more = 2;
+                if (c == 0xE0) lo = 0xA0;
+                if (c == 0xED) hi = 0x9F;
+            } else if (c >= 0xF0 && c <= 0xF4) {
+                more = 3;
+                if (c == 0xF0) lo = 0x90;
+                if (c == 0xF4) hi = 0x8F;
+            } else {
+                return false;
+            }
+            if (e - s < more) return false;
+            unsigned char c1 = static_cast<unsigned char>(*s++);
+            if (c1 < lo || c1 > hi) return false;
+            for (int i = 1; i < more; i++) {
+                if ((static_cast<unsigned char>(*s++) & 0xC0) != 0x80) return false;
+            }
+        }
+        return true;
+    }
+
+    static int hex(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+    bool hex4(uint32_t& out) {
+        if (end_ - p_ < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            int h = hex(*p_++);
+            if (h < 0) return false;
+            out = (out << 4) | static_cast<uint32_t>(h);
+        }
+        return true;
+    }
+
+    // After a backslash: append the decoded character
+    bool escape(std::string& out) {
+        if (p_ == end_) return false;
+        switch (*p_++) {
+        case '"': out += '"'; return true;
+        case '\\': out += '\\'; return true;
+        case '/': out += '/'; return true;
+        case 'b': out += '\b'; return true;
+        case 'f': out += '\f'; return true;
+        case 'n': out += '\n'; return true;
+        case 'r': out += '\r'; return true;
+        case 't': out += '\t'; return true;
+        case 'u': break;
+        default: return false;
+        }
+        uint32_t cp;
+        if (!hex4(cp)) return false;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            uint32_t lo;
+            if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') return false;
+            p_ += 2;
+            if (!hex4(lo) || lo < 0xDC00 || lo > 0xDFFF) return false;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            return false;
+        }
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        return true;
+    }
+};
+
+// ── Chat completions ────────────────────────────────────────────────
+
+// choices[0].message.{content, tool_calls[].{id, function.{name, arguments}}}.
+// Anything the DOM path would reject (a non-string field, a non-object tool
+// call) fails the scan so the fallback reports it.
+static bool scan_message(JsonScanner& js, ProviderResponse& resp) {
+    return js.object([&](std::string_view k) {
+        if (k == "content") {
+            if (js.peek() == 'n') {
+                resp.content.clear();
+                return js.null();
+            }
+            return js.string(resp.content);
+        }
+        if (k != "tool_calls" || js.peek() != '[') return js.skip();
+
+        resp.tool_calls.clear();
+        return js.array([&] {
+            ToolCall t;
+            bool ok = js.object([&](std::string_view tk) {
+                if (tk == "id") return js.string(t.id);
+                if (tk != "function") return js.skip();
+                return js.object([&](std::string_view fk) {
+                    if (fk == "name") return js.string(t.name);
+                    if (fk == "arguments") return js.string(t.arguments);
+                    return js.skip();
+                });
+            });
+            if (ok && !t.name.empty()) resp.tool_calls.push_back(std::move(t));
+            return ok;
+        });
+    });
+}
+
+bool parse_chat_fast(const std::string& body, ProviderResponse& out) {
+    JsonScanner js(body);
+    ProviderResponse resp;
+    bool ok = js.object([&](std::string_view k) {
+        if (k != "choices") return js.skip();
+        if (js.peek() != '[') return false;  // let the DOM path decide
+        size_t i = 0;
+        return js.array([&] {
+            if (i++ != 0 || js.peek() != '{') return js.skip();
+            return js.object([&](std::string_view ck) {
+                if (ck != "message" || js.peek() != '{') return js.skip();
+                return scan_message(js, resp);
+            });
+        });
+    });
+    if (!ok || !js.at_end()) return false;
+    out = std::move(resp);
+    return true;
+}
+
+ProviderResponse parse_chat_dom(const std::string& body) {
+    ProviderResponse resp;
+    auto j = json::parse(body);
+    if (j.contains("choices") && !j["choices"].empty()) {
+        auto& msg = j["choices"][0]["message"];
+        resp.content = msg.contains("content") && !msg["content"].is_null()
+                       ? msg["content"].get<std::string>() : "";
+
+        // Standard OpenAI tool_calls format
+        if (msg.contains("tool_calls") && msg["tool_calls"].is_array()) {
+            for (auto& tc : msg["tool_calls"]) {
+                ToolCall t;
+                t.id = tc.value("id", "");
+                if (tc.contains("function")) {
+                    t.name = tc["function"].value("name", "");
+                    t.arguments = tc["function"].value("arguments", "");
+                }
+                if (!t.name.empty()) resp.tool_calls.push_back(std::move(t));
+            }
+        }
+    }
+    return resp;
+}
+
+ProviderResponse parse_chat_response(const std::string& body) {
+    ProviderResponse resp;
+    if (parse_chat_fast(body, resp)) return resp;
+    try {
+        return parse_chat_dom(body);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Failed to parse provider response: ") + e.what());
+    }
+}
+
+// ── Embeddings ──────────────────────────────────────────────────────
+
+// data[].embedding number arrays, parsed straight into float vectors
+// (reserved to the previous vector's size)
+bool parse_embeddings_fast(const std::string& body, EmbeddingResponse& out) {
+    JsonScanner js(body);
+    EmbeddingResponse resp;
+    size_t dims_hint = 0;
+    bool ok = js.object([&](std::string_view k) {
+        if (k != "data" || js.peek() != '[') return js.skip();
+        return js.array([&] {
+            if (js.peek() != '{') return js.skip();
+            std::vector<float> vec;
+            bool found = false;
+            bool item_ok = js.object([&](std::string_view ik) {
+                if (ik != "embedding" || js.peek() != '[') return js.skip();
+                found = true;
+                vec.clear();
+                vec.reserve(dims_hint);
+                return js.array([&] {
+                    double v;
+                    if (!js.number(v)) return false;
+                    vec.push_back(static_cast<float>(v));
+                    return true;
+                });
+            });
+            if (item_ok && found) {
+                dims_hint = vec.size();
+                resp.embeddings.push_back(std::move(vec));
+            }
+            return item_ok;
+        });
+    });
+    if (!ok || !js.at_end()) return false;
+    out = std::move(resp);
+    return true;
+}
+
+EmbeddingResponse parse_embeddings_dom(const std::string& body) {
+    EmbeddingResponse resp;
+    auto j = json::parse(body);
+    if (j.contains("data") && j["data"].is_array()) {
+        for (auto& item : j["data"]) {
+            if (item.contains("embedding") && item["embedding"].is_array()) {
+                std::vector<float> vec;
+                vec.reserve(item["embedding"].size());
+                for (auto& v : item["embedding"]) {
+                    vec.push_back(v.get<float>());
+                }
+                resp.embeddings.push_back(std::move(vec));
+            }
+        }
+    }
+    return resp;
+}
+
+EmbeddingResponse parse_embedding_response(const std::string& body) {
+    EmbeddingResponse resp;
+    if (parse_embeddings_fast(body, resp)) return resp;
+    try {
+        return parse_embeddings_dom(body);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Failed to parse embedding response: ") + e.what());
+    }
+}
+
+} // namespace minidragon
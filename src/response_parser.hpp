@@ -0,0 +1,25 @@
+#pragma once
+#include "provider.hpp"
+#include <string>
+
+namespace minidragon {
+
+// Provider response bodies -> ProviderResponse / EmbeddingResponse.
+//
+// The *_fast variants walk the body in place with a small hand-rolled
+// scanner and keep only the fields we use: everything else is skipped
+// without allocating, strings are decoded once into their destination and
+// embedding numbers are parsed straight into each float vector, so no DOM
+// is built. They return false on malformed or unexpected input; the DOM
+// variants then produce the precise error.
+bool parse_chat_fast(const std::string& body, ProviderResponse& out);
+bool parse_embeddings_fast(const std::string& body, EmbeddingResponse& out);
+
+ProviderResponse parse_chat_dom(const std::string& body);
+EmbeddingResponse parse_embeddings_dom(const std::string& body);
+
+// Fast path with DOM fallback; throws "Failed to parse ..." errors
+ProviderResponse parse_chat_response(const std::string& body);
+EmbeddingResponse parse_embedding_response(const std::string& body);
+
+} // namespace minidragon
@@ -1,52 +1,51 @@
 #pragma once
 #include "message.hpp"
+#include "session_store.hpp"
 #include "utils.hpp"
 #include <string>
 #include <vector>
-#include <fstream>
+#include <memory>
 
 namespace minidragon {
 
+// Today's history for one conversation. Backed by the shared SessionStore
+// (<sessions_dir>/sessions.db); conversation "" is the CLI agent.
 class SessionLogger {
 public:
-    explicit SessionLogger(const std::string& sessions_dir) : dir_(sessions_dir) {
-        fs::create_directories(dir_);
-    }
+    explicit SessionLogger(const std::string& sessions_dir, const std::string& conversation = "")
+        : store_(SessionStore::open(sessions_dir)), conversation_(conversation) {}
 
     void log(const Message& msg) {
-        std::string file = current_file();
-        std::ofstream f(file, std::ios::app);
-        f << msg.to_json().dump() << "\n";
+        store_->append(conversation_, today_str(), msg);
     }
 
     std::vector<Message> load_recent(int count = 20) {
-        std::vector<Message> result;
-        std::string file = current_file();
-        if (!fs::exists(file)) return result;
-
-        std::ifstream f(file);
-        std::vector<std::string> lines;
-        std::string line;
-        while (std::getline(f, line)) {
-            if (!line.empty()) lines.push_back(line);
-        }
-
-        int start = static_cast<int>(lines.size()) - count;
-        if (start < 0) start = 0;
-        for (int i = start; i < static_cast<int>(lines.size()); i++) {
-            try {
-                auto j = nlohmann::json::parse(lines[i]);
-                result.push_back(Message::from_json(j));
-            } catch (...) {}
-        }
-        return result;
+        return store_->load_recent(conversation_, today_str(), count);
     }
 
-private:
-    std::string dir_;
-    std::string current_file() {
-        return dir_ + "/" + today_str() + ".jsonl";
+    // Messages logged today
+    int count() {
+        return store_->count(conversation_, today_str());
+    }
+
+    // Rolling compaction summary (see SessionSummary)
+    SessionSummary load_summary() {
+        return store_->load_summary(conversation_, today_str());
+    }
+    void save_summary(const SessionSummary& summary, const std::string& day) {
+        store_->save_summary(conversation_, day, summary);
     }
+
+    const std::string& conversation() const { return conversation_; }
+
+    // Drop today's history (/new)
+    void reset() {
+        store_->clear(conversation_, today_str());
+    }
+
+private:
+    std::shared_ptr<SessionStore> store_;
+    std::string conversation_;
 };
 
 } // namespace minidragon
@@ -0,0 +1,354 @@
+#include "session_store.hpp"
+#include "utils.hpp"
+#include <sqlite3.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <chrono>
+#include <algorithm>
+
+namespace minidragon {
+
+// Time the writer waits after the first queued message for more to join
+// the same transaction
+static constexpr auto kCommitWindow = std::chrono::milliseconds(20);
+
+std::shared_ptr<SessionStore> SessionStore::open(const std::string& sessions_dir) {
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<SessionStore>> stores;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = stores[sessions_dir];
+    auto store = slot.lock();
+    if (!store) {
+        store = std::make_shared<SessionStore>(sessions_dir);
+        slot = store;
+    }
+    return store;
+}
+
+SessionStore::SessionStore(const std::string& sessions_dir) : dir_(sessions_dir) {
+    fs::create_directories(dir_);
+    std::string db_path = dir_ + "/sessions.db";
+    int rc = sqlite3_open(db_path.c_str(), &db_);
+    if (rc != SQLITE_OK) {
+        std::cerr << "[session] Failed to open database: " << sqlite3_errmsg(db_) << "\n";
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return;
+    }
+    init_db();
+    import_legacy_jsonl();
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+SessionStore::~SessionStore() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+    flush();
+    if (db_) sqlite3_close(db_);
+}
+
+void SessionStore::init_db() {
+    const char* sql = R"SQL(
+        PRAGMA journal_mode=WAL;
+        PRAGMA synchronous=NORMAL;
+
+        CREATE TABLE IF NOT EXISTS messages (
+            seq INTEGER PRIMARY KEY AUTOINCREMENT,
+            conversation TEXT NOT NULL,
+            day TEXT NOT NULL,
+            created_at INTEGER,
+            body TEXT NOT NULL
+        );
+
+        CREATE INDEX IF NOT EXISTS messages_conv_day
+            ON messages(conversation, day, seq);
+
+        CREATE TABLE IF NOT EXISTS summaries (
+            conversation TEXT NOT NULL,
+            day TEXT NOT NULL,
+            upto_seq INTEGER NOT NULL,
+            summary TEXT NOT NULL,
+            PRIMARY KEY (conversation, day)
+        );
+
+        CREATE TABLE IF NOT EXISTS imported_files (
+            path TEXT PRIMARY KEY
+        );
+    )SQL";
+    char* err = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "[session] Failed to init database: " << (err ? err : "unknown error") << "\n";
+        sqlite3_free(err);
+    }
+}
+
+// Sessions used to be one <day>.jsonl per conversation directory. Import
+// each file once so history carries over; the files are left in place.
+void SessionStore::import_legacy_jsonl() {
+    std::vector<std::pair<std::string, fs::path>> files;  // conversation, path
+    std::error_code ec;
+    for (auto& entry : fs::directory_iterator(dir_, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".jsonl") {
+            files.push_back({"", entry.path()});
+        } else if (entry.is_directory()) {
+            for (auto& sub : fs::directory_iterator(entry.path(), ec)) {
+                if (sub.is_regular_file() && sub.path().extension() == ".jsonl") {
+                    files.push_back({entry.path().filename().string(), sub.path()});
+                }
+            }
+        }
+    }
+    if (files.empty()) return;
+    std::sort(files.begin(), files.end(), [](auto& a, auto& b) { return a.second < b.second; });
+
+    sqlite3_stmt* seen = nullptr;
+    sqlite3_stmt* mark = nullptr;
+    sqlite3_stmt* ins = nullptr;
+    sqlite3_prepare_v2(db_, "SELECT 1 FROM imported_files WHERE path = ?", -1, &seen, nullptr);
+    sqlite3_prepare_v2(db_, "INSERT INTO imported_files (path) VALUES (?)", -1, &mark, nullptr);
+    sqlite3_prepare_v2(db_, "INSERT INTO messages (conversation, day, created_at, body) VALUES (?, ?, ?, ?)",
+                       -1, &ins, nullptr);
+
+    sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr);
+    int imported = 0;
+    for (auto& [conversation, path] : files) {
+        std::string p = path.string();
+        sqlite3_reset(seen);
+        sqlite3_bind_text(seen, 1, p.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(seen) == SQLITE_ROW) continue;
+
+        std::string day = path.stem().string();
+        std::ifstream f(path);
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.empty()) continue;
+            sqlite3_reset(ins);
+            sqlite3_bind_text(ins, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(ins, 3, 0);
+            sqlite3_bind_text(ins, 4, line.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(ins);
+        }
+        sqlite3_reset(mark);
+        sqlite3_bind_text(mark, 1, p.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(mark);
+        imported++;
+    }
+    sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+
+    sqlite3_finalize(seen);
+    sqlite3_finalize(mark);
+    sqlite3_finalize(ins);
+    if (imported > 0) {
+        std::cerr << "[session] Imported " << imported << " legacy session file(s)\n";
+    }
+}
+
+// ── Writes (group commit) ───────────────────────────────────────────
+
+void SessionStore::append(const std::string& conversation, const std::string& day, const Message& msg) {
+    if (!db_) return;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        pending_.push_back({conversation, day, epoch_now(), msg.to_json().dump()});
+    }
+    queue_cv_.notify_one();
+}
+
+void SessionStore::write_batch_locked() {
+    std::vector<Pending> batch;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        batch.swap(pending_);
+    }
+    if (batch.empty() || !db_) return;
+
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "INSERT INTO messages (conversation, day, created_at, body) VALUES (?, ?, ?, ?)",
+                       -1, &stmt, nullptr);
+    sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr);
+    for (auto& p : batch) {
+        sqlite3_reset(stmt);
+        sqlite3_bind_text(stmt, 1, p.conversation.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, p.day.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, p.ts);
+        sqlite3_bind_text(stmt, 4, p.body.c_str(), static_cast<int>(p.body.size()), SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "[session] Write failed: " << sqlite3_errmsg(db_) << "\n";
+        }
+    }
+    sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+    sqlite3_finalize(stmt);
+}
+
+void SessionStore::flush() {
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    write_batch_locked();
+}
+
+void SessionStore::writer_loop() {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    while (true) {
+        queue_cv_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+        if (stopping_) return;  // destructor flushes the remainder
+
+        // Let concurrent conversations pile onto the same transaction
+        queue_cv_.wait_for(lock, kCommitWindow, [&] { return stopping_; });
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+// ── Reads ───────────────────────────────────────────────────────────
+
+static std::vector<Message> collect_messages(sqlite3_stmt* stmt) {
+    std::vector<Message> result;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        if (!text) continue;
+        try {
+            result.push_back(Message::from_json(nlohmann::json::parse(text)));
+            result.back().seq = sqlite3_column_int64(stmt, 0);
+        } catch (...) {}
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+std::vector<Message> SessionStore::load_recent(const std::string& conversation,
+                                               const std::string& day, int count) {
+    if (!db_ || count <= 0) return {};
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    write_batch_locked();  // read-your-writes
+
+    // Walk the (conversation, day, seq) index backwards for just `count` rows
+    const char* sql = R"SQL(
+        SELECT seq, body FROM (
+            SELECT seq, body FROM messages
+            WHERE conversation = ? AND day = ?
+            ORDER BY seq DESC LIMIT ?
+        ) ORDER BY seq ASC
+    )SQL";
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 3, count);
+    return collect_messages(stmt);
+}
+
+std::vector<Message> SessionStore::load_day(const std::string& conversation, const std::string& day) {
+    if (!db_) return {};
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    write_batch_locked();
+
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "SELECT seq, body FROM messages WHERE conversation = ? AND day = ? ORDER BY seq",
+                       -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+    return collect_messages(stmt);
+}
+
+int SessionStore::count(const std::string& conversation, const std::string& day) {
+    if (!db_) return 0;
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    write_batch_locked();
+
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "SELECT COUNT(*) FROM messages WHERE conversation = ? AND day = ?",
+                       -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+    int n = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) n = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    return n;
+}
+
+int SessionStore::clear(const std::string& conversation, const std::string& day) {
+    if (!db_) return 0;
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    write_batch_locked();
+
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "DELETE FROM messages WHERE conversation = ? AND day = ?", -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    int removed = sqlite3_changes(db_);
+
+    sqlite3_prepare_v2(db_, "DELETE FROM summaries WHERE conversation = ? AND day = ?", -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return removed;
+}
+
+SessionSummary SessionStore::load_summary(const std::string& conversation, const std::string& day) {
+    SessionSummary summary;
+    if (!db_) return summary;
+    std::lock_guard<std::mutex> lock(db_mutex_);
+
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "SELECT upto_seq, summary FROM summaries WHERE conversation = ? AND day = ?",
+                       -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        summary.upto_seq = sqlite3_column_int64(stmt, 0);
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        summary.text = text ? text : "";
+    }
+    sqlite3_finalize(stmt);
+    return summary;
+}
+
+void SessionStore::save_summary(const std::string& conversation, const std::string& day,
+                                const SessionSummary& summary) {
+    if (!db_) return;
+    std::lock_guard<std::mutex> lock(db_mutex_);
+
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO summaries (conversation, day, upto_seq, summary) "
+                            "VALUES (?, ?, ?, ?)", -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, conversation.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, day.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, summary.upto_seq);
+    sqlite3_bind_text(stmt, 4, summary.text.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "[session] Failed to save summary: " << sqlite3_errmsg(db_) << "\n";
+    }
+    sqlite3_finalize(stmt);
+}
+
+std::vector<SessionDayInfo> SessionStore::list_days() {
+    std::vector<SessionDayInfo> days;
+    if (!db_) return days;
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    write_batch_locked();
+
+    const char* sql = "SELECT conversation, day, COUNT(*) FROM messages "
+                      "GROUP BY conversation, day ORDER BY day DESC, conversation";
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        SessionDayInfo info;
+        info.conversation = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        info.day = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        info.messages = sqlite3_column_int(stmt, 2);
+        days.push_back(std::move(info));
+    }
+    sqlite3_finalize(stmt);
+    return days;
+}
+
+} // namespace minidragon
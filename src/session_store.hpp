@@ -0,0 +1,80 @@
+#pragma once
+#include "message.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+struct sqlite3;
+
+namespace minidragon {
+
+struct SessionDayInfo {
+    std::string conversation;   // "" = default (CLI) conversation
+    std::string day;            // YYYY-MM-DD
+    int messages = 0;
+};
+
+// Rolling compaction summary of a conversation's day: covers every
+// message up to and including row upto_seq
+struct SessionSummary {
+    int64_t upto_seq = 0;
+    std::string text;
+};
+
+// SQLite-backed session history shared by every agent in the process.
+// Rows are keyed by (conversation, day, seq) so load_recent() is an index
+// range scan over just the rows it returns. Appends are queued and written
+// by a background thread in one transaction per batch (group commit);
+// reads flush the queue first so a conversation always sees its own writes.
+class SessionStore {
+public:
+    // One store per database path, shared while any logger holds it
+    static std::shared_ptr<SessionStore> open(const std::string& sessions_dir);
+
+    explicit SessionStore(const std::string& sessions_dir);
+    ~SessionStore();
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    void append(const std::string& conversation, const std::string& day, const Message& msg);
+    std::vector<Message> load_recent(const std::string& conversation, const std::string& day, int count);
+    std::vector<Message> load_day(const std::string& conversation, const std::string& day);
+    int count(const std::string& conversation, const std::string& day);
+    int clear(const std::string& conversation, const std::string& day);
+    SessionSummary load_summary(const std::string& conversation, const std::string& day);
+    void save_summary(const std::string& conversation, const std::string& day, const SessionSummary& summary);
+    std::vector<SessionDayInfo> list_days();
+
+    // Write everything queued so far
+    void flush();
+
+private:
+    struct Pending {
+        std::string conversation;
+        std::string day;
+        int64_t ts;
+        std::string body;
+    };
+
+    std::string dir_;
+    sqlite3* db_ = nullptr;
+    std::mutex db_mutex_;           // guards db_ (one connection, many agents)
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::vector<Pending> pending_;
+    bool stopping_ = false;
+    std::thread writer_;
+
+    void init_db();
+    void import_legacy_jsonl();
+    void write_batch_locked();      // requires db_mutex_
+    void writer_loop();
+};
+
+} // namespace minidragon
@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace minidragon {
+
+// SHA-256 of data as 64 lowercase hex chars (cache keys; not for secrets)
+std::string sha256_hex(std::string_view data);
+
+} // namespace minidragon
@@ -1,4 +1,5 @@
 #include "status.hpp"
+#include "session_store.hpp"
 #include <iostream>
 
 namespace minidragon {
@@ -249,80 +250,69 @@ int cmd_doctor() {
 int cmd_sessions(const std::string& subcmd, const std::string& arg) {
     Config cfg = Config::load(default_config_path());
     std::string sessions_dir = cfg.workspace_path() + "/sessions";
+    if (!fs::exists(sessions_dir) && (subcmd == "list" || subcmd.empty())) {
+        std::cout << "No sessions found.\n";
+        return 0;
+    }
+    auto store = SessionStore::open(sessions_dir);
+
+    auto label = [](const std::string& conversation) {
+        return conversation.empty() ? std::string("cli") : conversation;
+    };
 
     if (subcmd == "list" || subcmd.empty()) {
-        if (!fs::exists(sessions_dir)) {
-            std::cout << "No sessions found.\n";
-            return 0;
-        }
-        std::vector<std::string> files;
-        for (auto& entry : fs::directory_iterator(sessions_dir)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".jsonl") {
-                files.push_back(entry.path().filename().string());
-            }
-        }
-        std::sort(files.rbegin(), files.rend()); // Most recent first
-        if (files.empty()) {
+        auto days = store->list_days();  // most recent first
+        if (days.empty()) {
             std::cout << "No sessions found.\n";
             return 0;
         }
         std::cout << "Sessions (most recent first):\n";
-        for (auto& f : files) {
-            std::string date = f.substr(0, f.size() - 6); // strip .jsonl
-            std::string path = sessions_dir + "/" + f;
-            // Count messages
-            int count = 0;
-            std::ifstream file(path);
-            std::string line;
-            while (std::getline(file, line)) if (!line.empty()) count++;
-            std::cout << "  " << date << "  (" << count << " messages)\n";
+        for (auto& d : days) {
+            std::cout << "  " << d.day << "  " << label(d.conversation)
+                      << "  (" << d.messages << " messages)\n";
         }
         return 0;
     }
 
     if (subcmd == "show") {
         std::string date = arg.empty() ? today_str() : arg;
-        std::string path = sessions_dir + "/" + date + ".jsonl";
-        if (!fs::exists(path)) {
-            std::cout << "No session found for " << date << "\n";
-            return 1;
-        }
-        std::ifstream file(path);
-        std::string line;
-        int msg_num = 0;
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-            msg_num++;
-            try {
-                auto j = nlohmann::json::parse(line);
-                std::string role = j.value("role", "?");
-                std::string content = j.value("content", "");
+        bool found = false;
+        for (auto& d : store->list_days()) {
+            if (d.day != date) continue;
+            found = true;
+            std::cout << "── " << label(d.conversation) << " ──\n";
+            int msg_num = 0;
+            for (auto& m : store->load_day(d.conversation, d.day)) {
+                msg_num++;
+                std::string content = m.content;
                 // Truncate long content for display
                 if (content.size() > 200) content = content.substr(0, 200) + "...";
-                std::cout << "[" << msg_num << "] " << role << ": " << content << "\n";
-            } catch (...) {
-                std::cout << "[" << msg_num << "] (parse error)\n";
+                std::cout << "[" << msg_num << "] " << m.role << ": " << content << "\n";
             }
         }
+        if (!found) {
+            std::cout << "No session found for " << date << "\n";
+            return 1;
+        }
         return 0;
     }
 
     if (subcmd == "clear") {
-        if (!fs::exists(sessions_dir)) return 0;
         int removed = 0;
-        for (auto& entry : fs::directory_iterator(sessions_dir)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".jsonl") {
-                // Don't delete today's session unless forced
-                std::string fname = entry.path().stem().string();
-                if (fname == today_str() && arg != "--force") {
-                    std::cout << "Skipping today's session. Use 'sessions clear --force' to include it.\n";
-                    continue;
-                }
-                fs::remove(entry.path());
-                removed++;
+        bool skipped_today = false;
+        for (auto& d : store->list_days()) {
+            // Don't delete today's session unless forced
+            if (d.day == today_str() && arg != "--force") {
+                skipped_today = true;
+                continue;
             }
+            store->clear(d.conversation, d.day);
+            removed++;
+        }
+        if (skipped_today) {
+            std::cout << "Skipping today's session. Use 'sessions clear --force' to include it.\n";
         }
-        std::cout << "Removed " << removed << " session file(s).\n";
+        std::cout << "Removed " << removed << " session(s).\n";
         return 0;
     }
 
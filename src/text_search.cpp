@@ -0,0 +1,225 @@
+#include "text_search.hpp"
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MINIDRAGON_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// Same scheme as vec_kernels.cpp: each kernel is compiled for its own ISA
+#if defined(MINIDRAGON_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MD_TARGET(isa)
+#endif
+
+namespace minidragon {
+
+using FindFn = size_t (*)(const LiteralSearcher& s, const char* hay, size_t n);
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c | 0x20) : c;
+}
+
+// Rough byte frequency in source code and logs, most common first. The
+// second probe is the needle byte that appears latest here (or not at all).
+static int rarity(unsigned char c) {
+    static const char common[] =
+        " etaoinsrlcdu\n\thpmf_g.y(),=;bw\"vk-x:/'>*{}<[]0x1j2q#z&+$!|3456789@?%\\^~`";
+    const char* p = std::strchr(common, static_cast<char>(c));
+    return (c && p) ? static_cast<int>(p - common) : static_cast<int>(sizeof(common));
+}
+
+LiteralSearcher::LiteralSearcher(const std::string& needle, bool ignore_case)
+    : needle_(needle), ignore_case_(ignore_case) {
+    if (ignore_case_) {
+        for (auto& c : needle_) c = static_cast<char>(fold(static_cast<unsigned char>(c)));
+    }
+    int best = -1;
+    for (size_t i = 1; i < needle_.size(); i++) {
+        int r = rarity(static_cast<unsigned char>(needle_[i]));
+        if (r > best) {
+            best = r;
+            rare_ = i;
+        }
+    }
+}
+
+bool LiteralSearcher::matches_at(const char* p) const {
+    if (!ignore_case_) return std::memcmp(p, needle_.data(), needle_.size()) == 0;
+    for (size_t i = 0; i < needle_.size(); i++) {
+        if (fold(static_cast<unsigned char>(p[i])) != static_cast<unsigned char>(needle_[i])) return false;
+    }
+    return true;
+}
+
+// ── Scalar ──────────────────────────────────────────────────────────
+
+static size_t find_scalar(const LiteralSearcher& s, const char* hay, size_t n) {
+    const std::string& nd = s.needle();
+    size_t len = nd.size();
+    if (len == 0) return 0;
+    if (len > n) return n;
+    if (!s.ignore_case()) {
+        size_t p = std::string_view(hay, n).find(nd);
+        return p == std::string_view::npos ? n : p;
+    }
+    unsigned char first = static_cast<unsigned char>(nd[0]);
+    for (size_t i = 0; i + len <= n; i++) {
+        if (fold(static_cast<unsigned char>(hay[i])) == first && s.matches_at(hay + i)) return i;
+    }
+    return n;
+}
+
+#ifdef MINIDRAGON_X86
+
+static inline int lowest_bit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return static_cast<int>(idx);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// OR-ing 0x20 maps A-Z onto a-z and no other byte onto a lower-case
+// letter, so a folded probe only needs the mask when its byte is a letter
+static inline char probe_fold(const LiteralSearcher& s, unsigned char c) {
+    return (s.ignore_case() && c >= 'a' && c <= 'z') ? 0x20 : 0;
+}
+
+// Verifies each candidate bit in order; returns the match offset or -1
+static inline size_t check_candidates(const LiteralSearcher& s, const char* hay, size_t base, unsigned mask) {
+    while (mask) {
+        int k = lowest_bit(mask);
+        if (s.matches_at(hay + base + k)) return base + k;
+        mask &= mask - 1;
+    }
+    return static_cast<size_t>(-1);
+}
+
+// Finishes the last partial block with the scalar loop
+static size_t find_tail(const LiteralSearcher& s, const char* hay, size_t n, size_t i) {
+    size_t r = find_scalar(s, hay + i, n - i);
+    return r == n - i ? n : i + r;
+}
+
+// ── SSE2 ────────────────────────────────────────────────────────────
+
+MD_TARGET("sse2")
+static size_t find_sse2(const LiteralSearcher& s, const char* hay, size_t n) {
+    const std::string& nd = s.needle();
+    size_t len = nd.size();
+    if (len == 0) return 0;
+    size_t rare = s.rare();
+    unsigned char c0 = static_cast<unsigned char>(nd[0]), c1 = static_cast<unsigned char>(nd[rare]);
+    const __m128i v0 = _mm_set1_epi8(static_cast<char>(c0));
+    const __m128i v1 = _mm_set1_epi8(static_cast<char>(c1));
+    const __m128i f0 = _mm_set1_epi8(probe_fold(s, c0));
+    const __m128i f1 = _mm_set1_epi8(probe_fold(s, c1));
+
+    size_t i = 0;
+    // Every candidate in the block leaves room for the whole needle
+    for (; i + len + 15 <= n; i += 16) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i)), f0);
+        __m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + rare)), f1);
+        unsigned mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, v0), _mm_cmpeq_epi8(b, v1))));
+        if (mask) {
+            size_t hit = check_candidates(s, hay, i, mask);
+            if (hit != static_cast<size_t>(-1)) return hit;
+        }
+    }
+    return find_tail(s, hay, n, i);
+}
+
+// ── AVX2 ────────────────────────────────────────────────────────────
+
+MD_TARGET("avx2")
+static size_t find_avx2(const LiteralSearcher& s, const char* hay, size_t n) {
+    const std::string& nd = s.needle();
+    size_t len = nd.size();
+    if (len == 0) return 0;
+    size_t rare = s.rare();
+    unsigned char c0 = static_cast<unsigned char>(nd[0]), c1 = static_cast<unsigned char>(nd[rare]);
+    const __m256i v0 = _mm256_set1_epi8(static_cast<char>(c0));
+    const __m256i v1 = _mm256_set1_epi8(static_cast<char>(c1));
+    const __m256i f0 = _mm256_set1_epi8(probe_fold(s, c0));
+    const __m256i f1 = _mm256_set1_epi8(probe_fold(s, c1));
+
+    size_t i = 0;
+    for (; i + len + 31 <= n; i += 32) {
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i)), f0);
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + rare)), f1);
+        unsigned mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, v0), _mm256_cmpeq_epi8(b, v1))));
+        if (mask) {
+            size_t hit = check_candidates(s, hay, i, mask);
+            if (hit != static_cast<size_t>(-1)) return hit;
+        }
+    }
+    return find_tail(s, hay, n, i);
+}
+
+static bool cpu_has_sse2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] >> 26) & 1;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] >> 27) & 1;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 5) & 1;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // MINIDRAGON_X86
+
+// ── Dispatch ────────────────────────────────────────────────────────
+
+struct LiteralKernel {
+    const char* name;
+    FindFn fn;
+};
+
+static const LiteralKernel& best_kernel() {
+    static const LiteralKernel best = [] {
+#ifdef MINIDRAGON_X86
+        if (cpu_has_avx2()) return LiteralKernel{"avx2", find_avx2};
+        if (cpu_has_sse2()) return LiteralKernel{"sse2", find_sse2};
+#endif
+        return LiteralKernel{"scalar", find_scalar};
+    }();
+    return best;
+}
+
+size_t LiteralSearcher::find(const char* hay, size_t n) const {
+    static const FindFn fn = best_kernel().fn;
+    return fn(*this, hay, n);
+}
+
+const char* literal_kernel_name() {
+    return best_kernel().name;
+}
+
+} // namespace minidragon
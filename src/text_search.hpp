@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace minidragon {
+
+// ── Literal substring search ────────────────────────────────────────
+// Scans the haystack for two bytes of the needle at once (its first byte
+// and the one least likely to occur in source text), 16 or 32 positions per
+// step with SSE2/AVX2, and compares the full needle only where both hit.
+// ASCII letters fold case when ignore_case is set; other bytes (including
+// UTF-8) compare exactly. The kernel is picked once per process, like
+// dot_product().
+
+class LiteralSearcher {
+public:
+    LiteralSearcher(const std::string& needle, bool ignore_case);
+
+    // Offset of the first match in [hay, hay + n), or n if there is none
+    size_t find(const char* hay, size_t n) const;
+
+    // Folded needle: letters lower-cased when ignore_case
+    const std::string& needle() const { return needle_; }
+    bool ignore_case() const { return ignore_case_; }
+    // Offset of the second probe byte within the needle
+    size_t rare() const { return rare_; }
+
+    // Full compare at p (p + needle().size() must be in bounds)
+    bool matches_at(const char* p) const;
+
+private:
+    std::string needle_;
+    bool ignore_case_;
+    size_t rare_ = 0;
+};
+
+// Name of the kernel LiteralSearcher::find() dispatched to
+const char* literal_kernel_name();
+
+} // namespace minidragon
@@ -0,0 +1,50 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <cstddef>
+
+namespace minidragon {
+
+// Run fn(i) for i in [0, count) on at most max_workers threads.
+// Blocks until every index is done; the calling thread is one of the workers.
+// If fn throws, the remaining indices are skipped and the first exception is
+// rethrown on the caller once every thread has been joined.
+template <typename Fn>
+void parallel_for(size_t count, int max_workers, Fn&& fn) {
+    if (count == 0) return;
+    size_t workers = std::min<size_t>(count, static_cast<size_t>(std::max(1, max_workers)));
+    if (workers == 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        try {
+            for (size_t i = next++; i < count; i = next++) fn(i);
+        } catch (...) {
+            next = count;
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    try {
+        for (size_t t = 1; t < workers; t++) threads.emplace_back(worker);
+    } catch (...) {
+        // Could not start another thread: the ones running finish the work
+    }
+    worker();
+    for (auto& th : threads) th.join();
+    if (error) std::rethrow_exception(error);
+}
+
+} // namespace minidragon
@@ -0,0 +1,299 @@
+#include "tokenizer.hpp"
+#include "config.hpp"
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <queue>
+#include <functional>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+namespace minidragon {
+
+Tokenizer::Tokenizer() {
+    static std::atomic<int> next_id{1};
+    id_ = next_id++;
+}
+
+// ── Base64 (tiktoken files store raw token bytes as base64) ──────────
+
+static bool base64_decode(std::string_view in, std::string& out) {
+    auto val = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+    out.clear();
+    int buf = 0, bits = 0;
+    for (char c : in) {
+        if (c == '=') break;
+        int v = val(c);
+        if (v < 0) return false;
+        buf = (buf << 6) | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += static_cast<char>((buf >> bits) & 0xFF);
+        }
+    }
+    return !out.empty();
+}
+
+std::unique_ptr<BpeTokenizer> BpeTokenizer::load(const std::string& path, const std::string& name) {
+    std::ifstream f(path);
+    if (!f) return nullptr;
+
+    auto tok = std::unique_ptr<BpeTokenizer>(new BpeTokenizer());
+    tok->name_ = name;
+    tok->ranks_.reserve(210000);
+
+    std::string line, bytes;
+    while (std::getline(f, line)) {
+        size_t sp = line.find(' ');
+        if (sp == std::string::npos) continue;
+        if (!base64_decode(std::string_view(line).substr(0, sp), bytes)) continue;
+        try {
+            tok->ranks_[bytes] = std::stoi(line.substr(sp + 1));
+        } catch (...) {}
+    }
+
+    // Byte-level BPE needs every single byte in the vocabulary
+    if (tok->ranks_.size() < 256) return nullptr;
+    return tok;
+}
+
+// ── Pre-tokenizer ────────────────────────────────────────────────────
+
+enum class CharClass { letter, number, space, newline, other };
+
+// Decode one UTF-8 sequence at s[i]; returns its byte length
+static size_t utf8_len(unsigned char c) {
+    if (c < 0x80) return 1;
+    if ((c >> 5) == 0x6) return 2;
+    if ((c >> 4) == 0xE) return 3;
+    if ((c >> 3) == 0x1E) return 4;
+    return 1;
+}
+
+static CharClass classify(std::string_view s, size_t i, size_t& len) {
+    unsigned char c = static_cast<unsigned char>(s[i]);
+    len = utf8_len(c);
+    if (i + len > s.size()) len = 1;
+    if (c < 0x80) {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) return CharClass::letter;
+        if (c >= '0' && c <= '9') return CharClass::number;
+        if (c == '\n' || c == '\r') return CharClass::newline;
+        if (c == ' ' || c == '\t' || c == '\v' || c == '\f') return CharClass::space;
+        return CharClass::other;
+    }
+    // Non-ASCII: decode enough to separate punctuation/space blocks from letters
+    uint32_t cp = 0;
+    if (len == 2) cp = ((c & 0x1F) << 6) | (s[i + 1] & 0x3F);
+    else if (len == 3) cp = ((c & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+    else if (len == 4) cp = ((c & 0x07) << 18) | ((s[i + 1] & 0x3F) << 12) |
+                            ((s[i + 2] & 0x3F) << 6) | (s[i + 3] & 0x3F);
+    if (cp == 0xA0 || cp == 0x3000 || (cp >= 0x2000 && cp <= 0x200A)) return CharClass::space;
+    if ((cp >= 0x2010 && cp <= 0x206F) || (cp >= 0x3001 && cp <= 0x303F) ||
+        (cp >= 0xFF01 && cp <= 0xFF0F) || (cp >= 0xA1 && cp <= 0xBF) ||
+        cp == 0xD7 || cp == 0xF7) return CharClass::other;
+    return CharClass::letter;
+}
+
+void BpeTokenizer::split(std::string_view s, std::vector<std::string_view>& pieces) {
+    pieces.clear();
+    size_t n = s.size();
+    size_t i = 0;
+    auto is_ws = [](CharClass k) { return k == CharClass::space || k == CharClass::newline; };
+
+    while (i < n) {
+        size_t len;
+        CharClass k = classify(s, i, len);
+        size_t start = i;
+
+        // 's 't 're 've 'm 'll 'd
+        if (s[i] == '\'' && i + 1 < n) {
+            char a = static_cast<char>(s[i + 1] | 0x20);
+            char b = i + 2 < n ? static_cast<char>(s[i + 2] | 0x20) : 0;
+            size_t m = 0;
+            if ((a == 'r' && b == 'e') || (a == 'v' && b == 'e') || (a == 'l' && b == 'l')) m = 3;
+            else if (a == 's' || a == 't' || a == 'm' || a == 'd') m = 2;
+            if (m) { pieces.push_back(s.substr(i, m)); i += m; continue; }
+        }
+
+        // [^\r\n\p{L}\p{N}]?\p{L}+
+        size_t j = i;
+        if (k != CharClass::letter && k != CharClass::number && k != CharClass::newline && i + len < n) {
+            size_t l2;
+            if (classify(s, i + len, l2) == CharClass::letter) j = i + len;
+        }
+        size_t l;
+        if (j < n && classify(s, j, l) == CharClass::letter) {
+            while (j < n && classify(s, j, l) == CharClass::letter) j += l;
+            pieces.push_back(s.substr(start, j - start));
+            i = j;
+            continue;
+        }
+
+        // \p{N}{1,3}
+        if (k == CharClass::number) {
+            j = i;
+            int digits = 0;
+            while (j < n && digits < 3 && classify(s, j, l) == CharClass::number) { j += l; digits++; }
+            pieces.push_back(s.substr(i, j - i));
+            i = j;
+            continue;
+        }
+
+        //  ?[^\s\p{L}\p{N}]+[\r\n]*
+        j = i;
+        if (s[j] == ' ' && j + 1 < n && classify(s, j + 1, l) == CharClass::other) j++;
+        if (classify(s, j, l) == CharClass::other) {
+            while (j < n && classify(s, j, l) == CharClass::other) j += l;
+            while (j < n && (s[j] == '\r' || s[j] == '\n')) j++;
+            pieces.push_back(s.substr(i, j - i));
+            i = j;
+            continue;
+        }
+
+        // Whitespace: \s*[\r\n]+ | \s+(?!\S) | \s+
+        if (is_ws(k)) {
+            j = i;
+            size_t last_nl = std::string_view::npos;
+            while (j < n && is_ws(classify(s, j, l))) {
+                if (s[j] == '\r' || s[j] == '\n') last_nl = j;
+                j += l;
+            }
+            if (last_nl != std::string_view::npos) {
+                j = last_nl + 1;
+            } else if (j < n && j - i > 1) {
+                // Leave the final space to prefix the following word
+                size_t back = j - 1;
+                while (back > i && (static_cast<unsigned char>(s[back]) & 0xC0) == 0x80) back--;
+                j = back;
+            }
+            pieces.push_back(s.substr(i, j - i));
+            i = j;
+            continue;
+        }
+
+        pieces.push_back(s.substr(i, len));
+        i += len;
+    }
+}
+
+// ── BPE merge (count only) ───────────────────────────────────────────
+
+int BpeTokenizer::count_piece(std::string_view piece) const {
+    if (piece.size() == 1) return 1;
+    std::string key(piece);
+    if (ranks_.count(key)) return 1;
+
+    // Parts form a linked list by start offset: next[i] is where the part
+    // starting at i ends. Candidate merges wait in a heap ordered by (rank,
+    // start), which picks the same pair as a scan for the lowest rank, leftmost
+    // first; an entry whose parts have changed since is skipped when popped.
+    size_t n = piece.size();
+    std::vector<size_t> next(n), prev(n);
+    std::vector<char> alive(n, 1);
+    for (size_t i = 0; i < n; i++) {
+        next[i] = i + 1;
+        prev[i] = i - 1;
+    }
+
+    struct Merge {
+        int rank;
+        size_t start, end;  // the two parts' span
+        bool operator>(const Merge& o) const { return rank != o.rank ? rank > o.rank : start > o.start; }
+    };
+    std::priority_queue<Merge, std::vector<Merge>, std::greater<Merge>> heap;
+    auto push = [&](size_t i) {
+        size_t mid = next[i];
+        if (mid >= n) return;
+        key.assign(piece.data() + i, next[mid] - i);
+        auto it = ranks_.find(key);
+        if (it != ranks_.end()) heap.push({it->second, i, next[mid]});
+    };
+    for (size_t i = 0; i < n; i++) push(i);
+
+    int parts = static_cast<int>(n);
+    while (!heap.empty()) {
+        Merge m = heap.top();
+        heap.pop();
+        size_t mid = next[m.start];
+        if (!alive[m.start] || mid >= n || next[mid] != m.end) continue;  // stale
+
+        alive[mid] = 0;
+        next[m.start] = m.end;
+        if (m.end < n) prev[m.end] = m.start;
+        parts--;
+        push(m.start);
+        if (m.start > 0) push(prev[m.start]);
+    }
+    return parts;
+}
+
+int BpeTokenizer::count(std::string_view text) const {
+    thread_local std::vector<std::string_view> pieces;
+    split(text, pieces);
+    int total = 0;
+    for (auto p : pieces) total += count_piece(p);
+    return total;
+}
+
+// ── Model → tokenizer resolution ─────────────────────────────────────
+
+const Tokenizer& heuristic_tokenizer() {
+    static HeuristicTokenizer h;
+    return h;
+}
+
+static std::string default_encoding_for(const std::string& model) {
+    static const std::pair<const char*, const char*> table[] = {
+        {"gpt-4o", "o200k_base"}, {"gpt-4.1", "o200k_base"}, {"gpt-4.5", "o200k_base"},
+        {"gpt-5", "o200k_base"}, {"o1", "o200k_base"}, {"o3", "o200k_base"}, {"o4", "o200k_base"},
+        {"gpt-4", "cl100k_base"}, {"gpt-3.5", "cl100k_base"}, {"text-embedding", "cl100k_base"},
+    };
+    for (auto& [prefix, enc] : table) {
+        if (model.compare(0, std::strlen(prefix), prefix) == 0) return enc;
+    }
+    return "cl100k_base";  // closest general-purpose approximation for other models
+}
+
+const Tokenizer& tokenizer_for_model(const std::string& model, const TokenizerConfig& cfg) {
+    // Longest configured prefix wins over the built-in table
+    std::string encoding;
+    size_t best = 0;
+    for (auto& [prefix, enc] : cfg.models) {
+        if (prefix.size() >= best && model.compare(0, prefix.size(), prefix) == 0) {
+            encoding = enc;
+            best = prefix.size();
+        }
+    }
+    if (encoding.empty()) encoding = default_encoding_for(model);
+    if (encoding == "heuristic") return heuristic_tokenizer();
+
+    std::string path = encoding.find('/') != std::string::npos || encoding.find('\\') != std::string::npos
+                       ? expand_path(encoding)
+                       : expand_path(cfg.vocab_dir) + "/" + encoding + ".tiktoken";
+
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<BpeTokenizer>> loaded;  // null = failed
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = loaded.find(path);
+    if (it == loaded.end()) {
+        auto tok = BpeTokenizer::load(path, encoding);
+        if (!tok && fs::exists(path)) {
+            std::cerr << "[tokenizer] Invalid vocab file: " << path << "\n";
+        }
+        it = loaded.emplace(path, std::move(tok)).first;
+    }
+    if (it->second) return *it->second;
+    return heuristic_tokenizer();
+}
+
+} // namespace minidragon
@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace minidragon {
+
+struct TokenizerConfig;
+
+// Counts tokens for context budgeting. Implementations are immutable after
+// construction and safe to share between threads.
+class Tokenizer {
+public:
+    Tokenizer();
+    virtual ~Tokenizer() = default;
+
+    virtual int count(std::string_view text) const = 0;
+    virtual std::string name() const = 0;
+
+    // Process-unique id, part of the Message token-count cache key
+    int id() const { return id_; }
+
+private:
+    int id_;
+};
+
+// Legacy estimate: 4 chars ≈ 1 token. Used when no vocab file is available.
+class HeuristicTokenizer : public Tokenizer {
+public:
+    int count(std::string_view text) const override {
+        return static_cast<int>((text.size() + 3) / 4);
+    }
+    std::string name() const override { return "chars/4"; }
+};
+
+// Byte-level BPE over a tiktoken rank file (cl100k_base / o200k_base format:
+// one "<base64 token> <rank>" per line). Pre-tokenization is a hand-rolled
+// approximation of the cl100k split pattern (contractions, letter runs with
+// one leading non-letter, 1-3 digit groups, punctuation runs, whitespace).
+class BpeTokenizer : public Tokenizer {
+public:
+    // Returns nullptr if the file is missing or malformed
+    static std::unique_ptr<BpeTokenizer> load(const std::string& path, const std::string& name);
+
+    int count(std::string_view text) const override;
+    std::string name() const override { return name_; }
+    size_t vocab_size() const { return ranks_.size(); }
+
+    // Split text into pre-tokenizer pieces (exposed for the benchmark)
+    static void split(std::string_view text, std::vector<std::string_view>& pieces);
+
+private:
+    std::string name_;
+    std::unordered_map<std::string, int> ranks_;
+
+    int count_piece(std::string_view piece) const;
+};
+
+// Heuristic fallback shared by everything without a vocab
+const Tokenizer& heuristic_tokenizer();
+
+// Resolve the tokenizer for a model: tokenizer.models maps model-name
+// prefixes to encodings ("gpt-4o" -> "o200k_base"); built-in defaults cover
+// OpenAI families. Encodings load from <vocab_dir>/<encoding>.tiktoken once
+// per process; anything missing falls back to the heuristic.
+const Tokenizer& tokenizer_for_model(const std::string& model, const TokenizerConfig& cfg);
+
+} // namespace minidragon
@@ -4,39 +4,63 @@
 #include <vector>
 #include <functional>
 #include <nlohmann/json.hpp>
+#include "cancel.hpp"
 #include <stdexcept>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
 
 namespace minidragon {
 
 using ToolFunction = std::function<std::string(const nlohmann::json&)>;
 
+// Per-call state the agent hands to tools that need it
+struct ToolContext {
+    CancelToken* cancel = nullptr;  // abort mid-call (kill a process, drop a request)
+    std::string conversation;       // calling conversation ("" = CLI agent)
+};
+using ContextToolFunction = std::function<std::string(const nlohmann::json&, const ToolContext&)>;
+
 struct ToolDef {
     std::string name;
     std::string description;
     nlohmann::json parameters;
     ToolFunction func;
+    // false = serial: the call runs alone, after the calls before it and
+    // before the calls after it (tools that mutate files or run commands)
+    bool parallel_safe = true;
+    ContextToolFunction context_func = nullptr;  // used instead of func when set
 };
 
 class ToolRegistry {
 public:
     void register_tool(ToolDef def) {
+        std::lock_guard<std::mutex> lock(spec_mutex_);
         tools_[def.name] = std::move(def);
         spec_dirty_ = true;
+        version_ = next_version();
     }
 
+    // Changes whenever the tool set does. Unique across registries, so
+    // (version, schema flavor) can key caches of the serialized spec.
+    uint64_t version() const { return version_.load(); }
+
     bool has(const std::string& name) const {
         return tools_.count(name) > 0;
     }
 
-    std::string execute(const std::string& name, const nlohmann::json& args) const {
+    std::string execute(const std::string& name, const nlohmann::json& args,
+                        const ToolContext& ctx = {}) const {
         auto it = tools_.find(name);
         if (it == tools_.end()) {
             throw std::runtime_error("Unknown tool: " + name);
         }
+        if (it->second.context_func) return it->second.context_func(args, ctx);
         return it->second.func(args);
     }
 
     nlohmann::json tools_spec() const {
+        std::lock_guard<std::mutex> lock(spec_mutex_);
         if (!spec_dirty_) return cached_spec_;
         nlohmann::json arr = nlohmann::json::array();
         for (auto& [name, def] : tools_) {
@@ -54,6 +78,11 @@ public:
         return cached_spec_;
     }
 
+    bool parallel_safe(const std::string& name) const {
+        auto it = tools_.find(name);
+        return it != tools_.end() && it->second.parallel_safe;
+    }
+
     std::vector<std::string> tool_names() const {
         std::vector<std::string> names;
         for (auto& [n, _] : tools_) names.push_back(n);
@@ -64,6 +93,13 @@ private:
     std::map<std::string, ToolDef> tools_;
     mutable nlohmann::json cached_spec_;
     mutable bool spec_dirty_ = true;
+    mutable std::mutex spec_mutex_;
+    std::atomic<uint64_t> version_{next_version()};
+
+    static uint64_t next_version() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
 };
 
 } // namespace minidragon
@@ -9,6 +9,7 @@ void register_cron_tool(ToolRegistry& reg, const std::string& db_path) {
 
     ToolDef def;
     def.name = "cron";
+    def.parallel_safe = false;
     def.description = "Manage cron jobs (add/list/remove).";
     def.parameters = {
         {"type", "object"},
@@ -0,0 +1,113 @@
+#pragma once
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace minidragon {
+
+// ── Output capture ──────────────────────────────────────────────────
+
+// Keeps the first quarter of the budget and a ring buffer of the most
+// recent bytes: a build log's first error and its final summary both
+// survive, and the bytes in between are counted exactly.
+class OutputCapture {
+public:
+    explicit OutputCapture(size_t limit) : head_cap_(limit / 4), tail_cap_(limit - limit / 4) {}
+
+    void append(const char* p, size_t n) {
+        total_ += n;
+        size_t h = std::min(n, head_cap_ - head_.size());
+        head_.append(p, h);
+        p += h;
+        n -= h;
+        if (n == 0) return;
+        if (n >= tail_cap_) {
+            ring_.assign(p + n - tail_cap_, tail_cap_);
+            pos_ = 0;
+            return;
+        }
+        if (ring_.size() < tail_cap_) {
+            size_t fill = std::min(n, tail_cap_ - ring_.size());
+            ring_.append(p, fill);
+            p += fill;
+            n -= fill;
+        }
+        // Full ring: pos_ is the oldest byte, overwrite from there
+        while (n > 0) {
+            size_t chunk = std::min(n, tail_cap_ - pos_);
+            std::memcpy(&ring_[pos_], p, chunk);
+            pos_ = (pos_ + chunk) % tail_cap_;
+            p += chunk;
+            n -= chunk;
+        }
+    }
+
+    uint64_t total() const { return total_; }
+
+    // Head, a marker with the exact number of bytes left out, then the tail.
+    // The cut edges are moved to line starts when one is close, and never
+    // split a UTF-8 sequence; bytes trimmed that way count as omitted.
+    std::string str(uint64_t& omitted) const {
+        std::string tail = ring_.substr(pos_) + ring_.substr(0, pos_);
+        uint64_t dropped = total_ - head_.size() - ring_.size();
+        omitted = 0;
+        if (dropped == 0) return head_ + tail;
+
+        size_t head_len = head_.size();
+        size_t nl = head_.rfind('\n');
+        if (nl != std::string::npos && head_len - nl <= kSnap) {
+            head_len = nl + 1;
+        } else {
+            head_len = utf8_floor(head_, head_len);
+        }
+        size_t tail_from = 0;
+        nl = tail.find('\n');
+        if (nl != std::string::npos && nl < kSnap) {
+            tail_from = nl + 1;
+        } else {
+            while (tail_from < tail.size() && (static_cast<unsigned char>(tail[tail_from]) & 0xC0) == 0x80) tail_from++;
+        }
+
+        omitted = dropped + (head_.size() - head_len) + tail_from;
+        std::string out = head_.substr(0, head_len);
+        if (!out.empty() && out.back() != '\n') out += '\n';
+        out += "...[" + std::to_string(omitted) + " bytes omitted]...\n";
+        out.append(tail, tail_from, std::string::npos);
+        return out;
+    }
+
+private:
+    static constexpr size_t kSnap = 256;
+    size_t head_cap_;
+    size_t tail_cap_;
+    std::string head_;
+    std::string ring_;
+    size_t pos_ = 0;
+    uint64_t total_ = 0;
+
+    // Largest length <= len that does not end inside a multi-byte sequence
+    static size_t utf8_floor(const std::string& s, size_t len) {
+        size_t i = len;
+        while (i > 0 && (static_cast<unsigned char>(s[i - 1]) & 0xC0) == 0x80 && len - i < 3) i--;
+        if (i == 0 || static_cast<unsigned char>(s[i - 1]) < 0xC0) return len;
+        unsigned char lead = static_cast<unsigned char>(s[i - 1]);
+        size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+        return len - (i - 1) >= need ? len : i - 1;
+    }
+};
+
+struct ExecResult {
+    std::string output;
+    int exit_code = -1;
+    int signal = 0;        // terminating signal, if any
+    bool timed_out = false;
+    bool cancelled = false;
+    double elapsed = 0;    // seconds
+    long peak_rss_kb = -1; // -1 = unknown
+    uint64_t output_bytes = 0;
+    uint64_t dropped_bytes = 0;
+    std::string note;      // extra status, e.g. a shell session that was lost
+};
+
+} // namespace minidragon
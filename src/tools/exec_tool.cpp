@@ -1,12 +1,27 @@
 #include "exec_tool.hpp"
+#include "exec_output.hpp"
+#include "shell_session.hpp"
 #include <cstdio>
+#include <cstring>
+#include <cstdint>
 #include <sstream>
 #include <algorithm>
 #include <chrono>
+#include <memory>
 
 #ifdef _WIN32
 #define popen _popen
 #define pclose _pclose
+#else
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+extern char** environ;
 #endif
 
 namespace minidragon {
@@ -53,52 +68,228 @@ static bool is_dangerous(const std::string& cmd) {
     return false;
 }
 
-static std::string exec_command(const std::string& cmd, const std::string& working_dir, int timeout_sec, int max_output) {
+// Output first, then one status line the model can rely on:
+// [exit code: 1 | elapsed: 12.30s | peak rss: 312.4 MiB | output: 901234 bytes, 850000 omitted]
+static std::string format_result(const ExecResult& r, int timeout_sec, CancelToken* cancel) {
+    std::string result = r.output;
+    if (r.cancelled) {
+        result += "\n[cancelled: " + (cancel ? cancel->reason() : std::string("cancelled")) + "]";
+    } else if (r.timed_out) {
+        result += "\n[timed out after " + std::to_string(timeout_sec) + "s]";
+    }
+
+    char buf[64];
+    result += "\n[exit code: " + std::to_string(r.exit_code);
+    if (r.signal) result += " (signal " + std::to_string(r.signal) + ")";
+    std::snprintf(buf, sizeof(buf), " | elapsed: %.2fs", r.elapsed);
+    result += buf;
+    if (r.peak_rss_kb >= 0) {
+        std::snprintf(buf, sizeof(buf), " | peak rss: %.1f MiB", r.peak_rss_kb / 1024.0);
+        result += buf;
+    }
+    result += " | output: " + std::to_string(r.output_bytes) + " bytes";
+    if (r.dropped_bytes) result += ", " + std::to_string(r.dropped_bytes) + " omitted";
+    result += "]";
+    if (!r.note.empty()) result += "\n[" + r.note + "]";
+    return result;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ── Executors ───────────────────────────────────────────────────────
+
+#ifdef _WIN32
+
+static ExecResult exec_command(const std::string& cmd, const std::string& working_dir, int timeout_sec,
+                               size_t max_output, CancelToken*) {
+    (void)timeout_sec;
+    ExecResult r;
+    auto start = std::chrono::steady_clock::now();
     std::string full_cmd;
     if (!working_dir.empty()) {
         full_cmd = "cd " + working_dir + " && ";
     }
     full_cmd += cmd + " 2>&1";
 
-    // Wrap with timeout on POSIX
-#ifndef _WIN32
-    if (timeout_sec > 0) {
-        full_cmd = "timeout " + std::to_string(timeout_sec) + " sh -c '" + full_cmd + "'";
+    FILE* pipe = popen(full_cmd.c_str(), "r");
+    if (!pipe) {
+        r.output = "[error] Failed to execute command";
+        return r;
+    }
+
+    // Read to EOF so the child never blocks on a full pipe
+    OutputCapture capture(max_output);
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) capture.append(buffer, n);
+    r.exit_code = pclose(pipe);
+
+    r.elapsed = seconds_since(start);
+    r.output = capture.str(r.dropped_bytes);
+    r.output_bytes = capture.total();
+    return r;
+}
+
+#else
+
+// posix_spawn keeps the child launch cheap even from a large process (no
+// page-table copy). The shell gets its own process group so a deadline or
+// cancellation kills the whole pipeline, not just `sh`.
+static ExecResult exec_command(const std::string& cmd, const std::string& working_dir, int timeout_sec,
+                               size_t max_output, CancelToken* cancel) {
+    ExecResult r;
+    auto start = std::chrono::steady_clock::now();
+    std::string full_cmd;
+    if (!working_dir.empty()) {
+        full_cmd = "cd " + working_dir + " && ";
+    }
+    full_cmd += cmd;
+
+    int out[2];
+#ifdef __linux__
+    int piped = pipe2(out, O_CLOEXEC);
+#else
+    int piped = pipe(out);
+    if (piped == 0) {
+        fcntl(out[0], F_SETFD, FD_CLOEXEC);
+        fcntl(out[1], F_SETFD, FD_CLOEXEC);
     }
 #endif
+    if (piped != 0) {
+        r.output = "[error] Failed to execute command";
+        return r;
+    }
 
-    FILE* pipe = popen(full_cmd.c_str(), "r");
-    if (!pipe) return "[error] Failed to execute command";
+    // stdin from /dev/null (a command waiting for input would otherwise hang
+    // until the deadline); stdout and stderr interleaved into one pipe
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDERR_FILENO);
 
-    std::string result;
-    result.reserve(std::min(max_output + 1024, 1 << 20));
-    char buffer[4096];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        result += buffer;
-        if (static_cast<int>(result.size()) > max_output) {
-            result += "\n...[truncated]";
-            break;
+    // Fresh signal mask and default SIGPIPE: ignored signals survive exec,
+    // and `yes | head` must still terminate
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t none, defaults;
+    sigemptyset(&none);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    const char* argv[] = {"sh", "-c", full_cmd.c_str(), nullptr};
+    pid_t pid = 0;
+    int err = posix_spawn(&pid, "/bin/sh", &actions, &attr, const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(out[1]);
+    if (err != 0) {
+        close(out[0]);
+        r.output = std::string("[error] Failed to execute command: ") + std::strerror(err);
+        return r;
+    }
+
+    // Until the shell is reaped its pid (= the group id) cannot be reused
+    CancelScope scope(cancel, [pid] { kill(-pid, SIGKILL); });
+
+    OutputCapture capture(max_output);
+    int status = 0;
+    struct rusage usage{};
+    bool reaped = false;
+    auto reap = [&](int flags) {
+        pid_t w;
+        while ((w = wait4(pid, &status, flags, &usage)) < 0 && errno == EINTR) {}
+        if (w == pid) {
+            reaped = true;
+            scope.release();
+        }
+    };
+
+    auto deadline = start + std::chrono::seconds(timeout_sec);
+    char buffer[16384];
+    while (true) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) {
+            if (reaped || r.timed_out) break;
+            r.timed_out = true;
+            kill(-pid, SIGKILL);
+            // Collect what the group wrote before dying, for at most a second
+            deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            continue;
+        }
+        // Once the shell has exited, a background job may keep the pipe
+        // open; drain what is buffered and stop at the first idle gap
+        int wait_ms = reaped ? 50 : static_cast<int>(std::min<long long>(left, 200));
+        struct pollfd pfd{out[0], POLLIN, 0};
+        int ret = poll(&pfd, 1, wait_ms);
+        if (ret < 0 && errno != EINTR) break;
+        if (ret == 0) {
+            if (reaped || (cancel && cancel->cancelled())) break;
+            reap(WNOHANG);
+            continue;
         }
+        if (ret < 0) continue;
+        ssize_t n = read(out[0], buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;  // EOF: every writer in the group is done
+        capture.append(buffer, static_cast<size_t>(n));
     }
-    int status = pclose(pipe);
+    close(out[0]);
+    if (!reaped) reap(0);
 
-    // Normalize exit code
-#ifndef _WIN32
+    r.elapsed = seconds_since(start);
+    r.cancelled = cancel && cancel->cancelled();
     if (WIFEXITED(status)) {
-        status = WEXITSTATUS(status);
+        r.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        r.signal = WTERMSIG(status);
+        r.exit_code = 128 + r.signal;
+    } else {
+        r.exit_code = status;
     }
+#ifdef __APPLE__
+    r.peak_rss_kb = usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    r.peak_rss_kb = usage.ru_maxrss;
 #endif
-
-    result += "\n[exit code: " + std::to_string(status) + "]";
-    return result;
+    r.output = capture.str(r.dropped_bytes);
+    r.output_bytes = capture.total();
+    return r;
 }
 
+#endif
+
 void register_exec_tool(ToolRegistry& reg, const Config& cfg) {
-    int max_output = cfg.max_tool_output;
+    // Same auto budget as Agent::effective_max_tool_output, less room for
+    // the omission marker and status line so the agent never cuts the tail
+    int budget = cfg.max_tool_output > 0 ? cfg.max_tool_output
+                                         : static_cast<int>(cfg.context_tokens * 4 * 0.3);
+    size_t max_output = static_cast<size_t>(std::max(budget - 256, 1024));
+
+    // tools.exec.persistent_shell: one long-lived shell per conversation
+    std::shared_ptr<ShellPool> shells;
+    const auto& exec_cfg = cfg.tools.is_object() && cfg.tools.contains("exec") ? cfg.tools["exec"]
+                                                                              : nlohmann::json::object();
+#ifndef _WIN32
+    if (exec_cfg.is_object() && exec_cfg.value("persistent_shell", false)) {
+        shells = std::make_shared<ShellPool>(exec_cfg.value("max_shells", 8),
+                                             exec_cfg.value("shell_idle_timeout", 900));
+    }
+#endif
 
     ToolDef def;
     def.name = "exec";
-    def.description = "Run a shell command.";
+    def.parallel_safe = false;
+    def.description = shells ? "Run a shell command. The shell persists between calls: the working directory, "
+                               "exported variables and activated virtualenvs carry over."
+                             : "Run a shell command.";
     def.parameters = nlohmann::json::parse(R"JSON({
         "type": "object",
         "properties": {
@@ -109,7 +300,7 @@ void register_exec_tool(ToolRegistry& reg, const Config& cfg) {
         "required": ["command"]
     })JSON");
 
-    def.func = [max_output](const nlohmann::json& args) -> std::string {
+    def.context_func = [max_output, shells](const nlohmann::json& args, const ToolContext& ctx) -> std::string {
         std::string command = args.value("command", "");
         std::string working_dir = args.value("working_dir", "");
         int timeout = args.value("timeout", 60);
@@ -122,7 +313,13 @@ void register_exec_tool(ToolRegistry& reg, const Config& cfg) {
             return "[error] Command blocked by security guard: potentially destructive operation";
         }
 
-        return exec_command(command, working_dir, timeout, max_output);
+#ifndef _WIN32
+        if (shells) {
+            return format_result(shells->run(ctx.conversation, command, working_dir, timeout, max_output, ctx.cancel),
+                                 timeout, ctx.cancel);
+        }
+#endif
+        return format_result(exec_command(command, working_dir, timeout, max_output, ctx.cancel), timeout, ctx.cancel);
     };
 
     reg.register_tool(std::move(def));
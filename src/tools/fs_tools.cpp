@@ -1,4 +1,7 @@
 #include "fs_tools.hpp"
+#include "../grep_engine.hpp"
+#include "../glob_engine.hpp"
+#include "../workspace_index.hpp"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -17,28 +20,26 @@ static std::string resolve_workspace_path(const std::string& workspace, const st
     return base + path;
 }
 
-// Simple glob pattern matching: supports * and ** wildcards
-static bool glob_match(const std::string& pattern, const std::string& name) {
-    // Simple *.ext matching
-    if (pattern.size() > 1 && pattern[0] == '*' && pattern.find('*', 1) == std::string::npos) {
-        std::string suffix = pattern.substr(1);
-        return name.size() >= suffix.size() &&
-               name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
-    }
-    // Simple prefix* matching
-    if (pattern.size() > 1 && pattern.back() == '*' && pattern.find('*') == pattern.size() - 1) {
-        std::string prefix = pattern.substr(0, pattern.size() - 1);
-        return name.size() >= prefix.size() &&
-               name.compare(0, prefix.size(), prefix) == 0;
-    }
-    // Exact match
-    return name == pattern;
-}
-
 void register_fs_tools(ToolRegistry& reg, const Config& cfg) {
     auto workspace = std::make_shared<std::string>(cfg.workspace);
     int max_output = cfg.max_tool_output;
 
+    // tools.index (opt-in): path list and trigram index of the workspace, kept
+    // current in the background; glob and grep_file walk when it cannot answer.
+    // Off by default since every process that registers these tools, down to
+    // one-shot runs and teammates, would scan and watch the tree on its own
+    std::shared_ptr<WorkspaceIndex> index;
+    const auto& index_cfg = cfg.tools.is_object() && cfg.tools.contains("index") ? cfg.tools["index"]
+                                                                                : nlohmann::json::object();
+    if (index_cfg.is_object() && index_cfg.value("enabled", false)) {
+        WorkspaceIndexOptions opts;
+        opts.max_files = index_cfg.value("max_files", opts.max_files);
+        opts.max_file_size = index_cfg.value("max_file_size", opts.max_file_size);
+        opts.rescan_interval = index_cfg.value("rescan_interval", opts.rescan_interval);
+        opts.snapshot_dir = home_dir() + "/.minidragon/index";
+        index = std::make_shared<WorkspaceIndex>(cfg.workspace, opts);
+    }
+
     // ── read_file ──
     {
         ToolDef def;
@@ -100,6 +101,7 @@ void register_fs_tools(ToolRegistry& reg, const Config& cfg) {
     {
         ToolDef def;
         def.name = "write_file";
+        def.parallel_safe = false;
         def.description = "Create or overwrite a file.";
         def.parameters = nlohmann::json::parse(R"JSON({
             "type": "object",
@@ -138,6 +140,7 @@ void register_fs_tools(ToolRegistry& reg, const Config& cfg) {
     {
         ToolDef def;
         def.name = "edit_file";
+        def.parallel_safe = false;
         def.description = "Find and replace text in a file.";
         def.parameters = nlohmann::json::parse(R"JSON({
             "type": "object",
@@ -232,71 +235,81 @@ void register_fs_tools(ToolRegistry& reg, const Config& cfg) {
     {
         ToolDef def;
         def.name = "glob";
-        def.description = "Find files matching a pattern (e.g. *.cpp, *.hpp).";
+        def.description = "Find files by glob: * ? [...] within a name, ** across directories, {a,b} "
+                          "alternatives (e.g. src/**/*.cpp, *.{h,hpp}). Hidden paths need a leading '.' in "
+                          "the pattern; node_modules is skipped unless the pattern spells it out; "
+                          ".gitignore'd files need include_ignored.";
         def.parameters = nlohmann::json::parse(R"JSON({
             "type": "object",
             "properties": {
-                "pattern": {"type": "string"},
-                "path": {"type": "string"}
+                "pattern": {"type": "string", "description": "Relative to path; without '/' it matches file names at any depth"},
+                "path": {"type": "string"},
+                "sort": {"type": "string", "enum": ["path", "mtime"], "description": "mtime: most recently modified first"},
+                "include_ignored": {"type": "boolean", "description": "Also list .gitignore'd files and node_modules"}
             },
             "required": ["pattern"]
         })JSON");
 
-        def.func = [workspace, max_output](const nlohmann::json& args) -> std::string {
+        def.context_func = [workspace, max_output, index](const nlohmann::json& args, const ToolContext& ctx) -> std::string {
             std::string pattern = args.value("pattern", "");
             std::string path = args.value("path", "");
+            std::string sort = args.value("sort", "path");
+            bool include_ignored = args.value("include_ignored", false);
             if (pattern.empty()) return "[error] pattern is required";
+            if (sort != "path" && sort != "mtime") return "[error] sort must be 'path' or 'mtime'";
             if (path.empty()) path = *workspace;
 
             std::string resolved = resolve_workspace_path(*workspace, path);
             if (!fs::exists(resolved) || !fs::is_directory(resolved))
                 return "[error] Directory does not exist: " + resolved;
 
-            // Extract the filename pattern from path-like patterns (e.g. "src/**/*.cpp" -> dir="src", pat="*.cpp")
-            std::string dir = resolved;
-            std::string file_pattern = pattern;
-
-            // Check if pattern contains path separators
-            size_t last_sep = pattern.rfind('/');
-            if (last_sep != std::string::npos) {
-                std::string path_part = pattern.substr(0, last_sep);
-                file_pattern = pattern.substr(last_sep + 1);
-                // Remove ** from path part
-                std::string clean_path;
-                for (size_t i = 0; i < path_part.size(); i++) {
-                    if (path_part[i] == '*') continue;
-                    clean_path += path_part[i];
+            std::string error;
+            auto glob = GlobPattern::compile(pattern, error);
+            if (!glob) return "[error] Invalid glob: " + error;
+
+            // The index holds exactly the non-hidden, non-ignored files
+            std::vector<std::string> files;
+            std::vector<std::string> indexed;
+            if (index && !include_ignored && !glob->may_match_hidden() && !glob->mentions("node_modules") &&
+                index->list(resolved, indexed)) {
+                for (auto& rel : indexed) {
+                    bool skipped = false;
+                    for (size_t pos = 0, slash; !skipped && (slash = rel.find('/', pos)) != std::string::npos;
+                         pos = slash + 1) {
+                        skipped = glob_skipped_dir(rel.substr(pos, slash - pos));
+                    }
+                    if (!skipped && glob->match(rel)) files.push_back(std::move(rel));
                 }
-                // Remove leading/trailing slashes
-                while (!clean_path.empty() && clean_path.front() == '/') clean_path.erase(0, 1);
-                while (!clean_path.empty() && clean_path.back() == '/') clean_path.pop_back();
-                if (!clean_path.empty()) {
-                    dir += "/" + clean_path;
+            } else {
+                GlobOptions opts;
+                opts.respect_gitignore = !include_ignored;
+                opts.cancel = ctx.cancel;
+                files = glob_search(resolved, *glob, opts);
+            }
+            if (ctx.cancel && ctx.cancel->cancelled()) return "[error] Search aborted";
+
+            if (sort == "mtime") {
+                std::vector<std::pair<fs::file_time_type, std::string>> dated;
+                dated.reserve(files.size());
+                for (auto& rel : files) {
+                    std::error_code ec;
+                    auto mtime = fs::last_write_time(resolved + "/" + rel, ec);
+                    dated.emplace_back(ec ? fs::file_time_type::min() : mtime, std::move(rel));
                 }
+                std::stable_sort(dated.begin(), dated.end(),
+                                 [](const auto& a, const auto& b) { return a.first > b.first; });
+                files.clear();
+                for (auto& d : dated) files.push_back(std::move(d.second));
             }
 
-            if (!fs::exists(dir) || !fs::is_directory(dir))
-                return "[error] Directory does not exist: " + dir;
-
             std::string result;
             int count = 0;
-            std::error_code ec;
-            for (auto& entry : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied, ec)) {
-                if (!entry.is_regular_file()) continue;
-                std::string name = entry.path().filename().string();
-                if (glob_match(file_pattern, name)) {
-                    // Show path relative to resolved workspace
-                    std::string rel = entry.path().string();
-                    if (rel.size() > resolved.size() && rel.substr(0, resolved.size()) == resolved) {
-                        rel = rel.substr(resolved.size());
-                        if (!rel.empty() && rel[0] == '/') rel = rel.substr(1);
-                    }
-                    result += rel + "\n";
-                    count++;
-                    if (static_cast<int>(result.size()) > max_output) {
-                        result += "...[truncated at " + std::to_string(count) + " files]\n";
-                        break;
-                    }
+            for (auto& rel : files) {
+                result += rel + "\n";
+                count++;
+                if (static_cast<int>(result.size()) > max_output) {
+                    result += "...[truncated at " + std::to_string(count) + " files]\n";
+                    break;
                 }
             }
 
@@ -310,6 +323,7 @@ void register_fs_tools(ToolRegistry& reg, const Config& cfg) {
     {
         ToolDef def;
         def.name = "apply_patch";
+        def.parallel_safe = false;
         def.description = "Apply a unified diff patch.";
         def.parameters = nlohmann::json::parse(R"JSON({
             "type": "object",
@@ -416,18 +430,20 @@ void register_fs_tools(ToolRegistry& reg, const Config& cfg) {
     {
         ToolDef def;
         def.name = "grep_file";
-        def.description = "Search text in files.";
+        def.description = "Search text in files (skips binary, hidden and .gitignore'd files).";
         def.parameters = nlohmann::json::parse(R"JSON({
             "type": "object",
             "properties": {
                 "pattern": {"type": "string"},
                 "path": {"type": "string"},
-                "glob": {"type": "string", "description": "File filter, e.g. '*.py'"}
+                "glob": {"type": "string", "description": "File filter, e.g. '*.py' or 'src/**/*.{h,cpp}'"},
+                "case_sensitive": {"type": "boolean"},
+                "regex": {"type": "boolean", "description": "Treat pattern as a regular expression (no backreferences or lookaround)"}
             },
             "required": ["pattern"]
         })JSON");
 
-        def.func = [workspace, max_output](const nlohmann::json& args) -> std::string {
+        def.context_func = [workspace, max_output, index](const nlohmann::json& args, const ToolContext& ctx) -> std::string {
             std::string pattern = args.value("pattern", "");
             std::string path = args.value("path", "");
             std::string glob_filter = args.value("glob", "");
@@ -436,73 +452,41 @@ void register_fs_tools(ToolRegistry& reg, const Config& cfg) {
             if (path.empty()) path = *workspace;
             std::string resolved = resolve_workspace_path(*workspace, path);
 
-            // Case-insensitive pattern
-            std::string lower_pattern = pattern;
-            std::transform(lower_pattern.begin(), lower_pattern.end(), lower_pattern.begin(), ::tolower);
+            GrepOptions opts;
+            opts.pattern = pattern;
+            opts.ignore_case = !args.value("case_sensitive", false);
+            std::unique_ptr<Regex> regex;
+            if (args.value("regex", false)) {
+                std::string error;
+                regex = Regex::compile(pattern, opts.ignore_case, error);
+                if (!regex) return "[error] Invalid regex: " + error;
+                opts.regex = regex.get();
+            }
+            std::shared_ptr<GlobPattern> glob;
+            if (!glob_filter.empty()) {
+                std::string error;
+                glob = GlobPattern::compile(glob_filter, error);
+                if (!glob) return "[error] Invalid glob: " + error;
+                opts.file_filter = [glob](const std::string& rel) { return glob->match(rel); };
+            }
+            opts.max_output = max_output > 0 ? static_cast<size_t>(max_output) : 0;
+            opts.cancel = ctx.cancel;
 
-            std::string result;
-            int match_count = 0;
-            int file_count = 0;
-
-            auto search_file = [&](const std::string& fpath) {
-                // Check glob filter
-                if (!glob_filter.empty()) {
-                    std::string fname = fs::path(fpath).filename().string();
-                    // Simple *.ext matching
-                    if (glob_filter.size() > 1 && glob_filter[0] == '*') {
-                        std::string ext = glob_filter.substr(1);
-                        if (fname.size() < ext.size() || fname.substr(fname.size() - ext.size()) != ext) return;
-                    }
-                }
+            // Only files holding every trigram of the literal can match
+            std::vector<std::string> candidates;
+            const std::string& literal = regex ? regex->required_literal() : pattern;
+            if (index && index->candidates(resolved, literal, candidates)) opts.files = &candidates;
 
-                std::ifstream f(fpath);
-                if (!f) return;
-                std::string line;
-                int line_num = 0;
-                bool file_header = false;
-                while (std::getline(f, line)) {
-                    line_num++;
-                    std::string lower_line = line;
-                    std::transform(lower_line.begin(), lower_line.end(), lower_line.begin(), ::tolower);
-                    if (lower_line.find(lower_pattern) != std::string::npos) {
-                        if (!file_header) {
-                            result += "\n" + fpath + ":\n";
-                            file_header = true;
-                            file_count++;
-                        }
-                        result += "  " + std::to_string(line_num) + ": " + line + "\n";
-                        match_count++;
-                        if (static_cast<int>(result.size()) > max_output) return;
-                    }
-                }
-            };
+            GrepResult found;
+            if (!grep_search(resolved, opts, found)) return "[error] Path does not exist: " + resolved;
 
-            if (fs::is_regular_file(resolved)) {
-                search_file(resolved);
-            } else if (fs::is_directory(resolved)) {
-                std::error_code ec;
-                for (auto& entry : fs::recursive_directory_iterator(resolved, fs::directory_options::skip_permission_denied, ec)) {
-                    if (!entry.is_regular_file()) continue;
-                    // Skip binary-looking files and hidden directories
-                    std::string name = entry.path().filename().string();
-                    if (name[0] == '.') continue;
-                    std::string ext = entry.path().extension().string();
-                    if (ext == ".exe" || ext == ".dll" || ext == ".so" || ext == ".o" ||
-                        ext == ".a" || ext == ".lib" || ext == ".bin" || ext == ".png" ||
-                        ext == ".jpg" || ext == ".gif" || ext == ".zip" || ext == ".gz") continue;
-
-                    search_file(entry.path().string());
-                    if (static_cast<int>(result.size()) > max_output) {
-                        result += "\n...[truncated]\n";
-                        break;
-                    }
-                }
-            } else {
-                return "[error] Path does not exist: " + resolved;
+            if (found.files.empty()) {
+                return found.truncated ? "[error] Search aborted" : "No matches found for '" + pattern + "'";
             }
-
-            if (result.empty()) return "No matches found for '" + pattern + "'";
-            return std::to_string(match_count) + " match(es) in " + std::to_string(file_count) + " file(s):" + result;
+            std::string result = std::to_string(found.match_count) + " match(es) in " +
+                                 std::to_string(found.files.size()) + " file(s):" + format_grep_files(found);
+            if (found.truncated) result += "\n...[truncated]\n";
+            return result;
         };
         reg.register_tool(std::move(def));
     }
@@ -12,6 +12,7 @@ void register_memory_tool(ToolRegistry& reg, const std::string& workspace,
 
     ToolDef td;
     td.name = "memory";
+    td.parallel_safe = false;  // long_term_save rewrites MEMORY.md
     td.description = "Save/recall memories.";
     td.parameters = nlohmann::json::parse(R"JSON({
         "type": "object",
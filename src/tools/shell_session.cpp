@@ -0,0 +1,348 @@
+#ifndef _WIN32
+#include "shell_session.hpp"
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace minidragon {
+
+static std::string shell_quote(const std::string& s) {
+    std::string out = "'";
+    for (char c : s) {
+        if (c == '\'') out += "'\\''";
+        else out += c;
+    }
+    out += "'";
+    return out;
+}
+
+static bool make_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+// ── ShellSession ────────────────────────────────────────────────────
+
+ShellSession::ShellSession() {
+    reaped_ = true;  // until the spawn succeeds
+    int in[2], out[2];
+    if (!make_pipe(in)) return;
+    if (!make_pipe(out)) {
+        close(in[0]);
+        close(in[1]);
+        return;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDERR_FILENO);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t none, defaults;
+    sigemptyset(&none);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    // bash reads its commands from the pipe; no rc files, so sessions start
+    // from the gateway's environment like one-shot commands do
+    bool bash = access("/bin/bash", X_OK) == 0;
+    const char* bash_argv[] = {"bash", "--noprofile", "--norc", nullptr};
+    const char* sh_argv[] = {"sh", nullptr};
+    int err = posix_spawn(&pid_, bash ? "/bin/bash" : "/bin/sh", &actions, &attr,
+                          const_cast<char* const*>(bash ? bash_argv : sh_argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(in[0]);
+    close(out[1]);
+    if (err != 0) {
+        close(in[1]);
+        close(out[0]);
+        pid_ = -1;
+        return;
+    }
+    in_ = in[1];
+    out_ = out[0];
+    reaped_ = false;
+
+    std::random_device rd;
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%08x%08x", rd(), rd());
+    token_ = hex;
+}
+
+ShellSession::~ShellSession() {
+    terminate();
+}
+
+bool ShellSession::alive() {
+    if (reaped_) return false;
+    pid_t w;
+    while ((w = waitpid(pid_, &status_, WNOHANG)) < 0 && errno == EINTR) {}
+    if (w == pid_) terminate();
+    return !reaped_;
+}
+
+// Kills the group (background jobs started in the session go with it),
+// reaps the shell and closes the pipes
+void ShellSession::terminate() {
+    if (pid_ > 0 && !reaped_) {
+        kill(-pid_, SIGKILL);
+        while (waitpid(pid_, &status_, 0) < 0 && errno == EINTR) {}
+    } else if (pid_ > 0) {
+        kill(-pid_, SIGKILL);  // leftover background jobs of an exited shell
+    }
+    pid_ = -1;
+    reaped_ = true;
+    if (in_ >= 0) close(in_);
+    if (out_ >= 0) close(out_);
+    in_ = out_ = -1;
+}
+
+// A shell that died between commands must not take the process down with
+// SIGPIPE: block it for this thread and swallow the one the write raised
+bool ShellSession::write_all(const std::string& data) {
+    sigset_t pipe_set, old;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old);
+
+    bool ok = true;
+    size_t total = 0;
+    while (total < data.size()) {
+        ssize_t n = write(in_, data.data() + total, data.size() - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    if (!ok && errno == EPIPE) {
+        sigset_t pending;
+        sigpending(&pending);
+        int sig;
+        if (sigismember(&pending, SIGPIPE)) sigwait(&pipe_set, &sig);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    return ok;
+}
+
+ExecResult ShellSession::run(const std::string& cmd, const std::string& working_dir, int timeout_sec,
+                             size_t max_output, CancelToken* cancel) {
+    ExecResult r;
+    auto start = std::chrono::steady_clock::now();
+    if (!alive()) {
+        r.output = "[error] Shell session is not running";
+        return r;
+    }
+
+    // eval keeps cd/export/source in this shell; stdin is /dev/null so a
+    // command cannot swallow the next script. The status line always starts
+    // on a fresh line so it cannot merge with unterminated output.
+    std::string sentinel = "__minidragon_" + token_ + "_" + std::to_string(++seq_) + "__";
+    std::string script;
+    if (!working_dir.empty()) script += "cd -- " + shell_quote(working_dir) + " && ";
+    script += "eval " + shell_quote(cmd) + " </dev/null\n";
+    script += "printf '\\n%s %d\\n' '" + sentinel + "' \"$?\"\n";
+
+    OutputCapture capture(max_output);
+    char buffer[16384];
+
+    // Output background jobs wrote since the last command goes first
+    struct pollfd idle{out_, POLLIN, 0};
+    while (poll(&idle, 1, 0) > 0) {
+        ssize_t n = read(out_, buffer, sizeof(buffer));
+        if (n <= 0) break;
+        capture.append(buffer, static_cast<size_t>(n));
+    }
+
+    if (!write_all(script)) {
+        terminate();
+        r.output = "[error] Shell session exited unexpectedly";
+        r.note = "shell session lost; the next command starts a fresh shell";
+        return r;
+    }
+
+    CancelScope scope(cancel, [pid = pid_] { kill(-pid, SIGKILL); });
+
+    // Everything up to "\n<sentinel> " is output. The last marker-size bytes
+    // stay pending until we know they are not the start of the marker.
+    const std::string marker = "\n" + sentinel + " ";
+    std::string pending;
+    bool done = false;
+    int rc = -1;
+    auto deadline = start + std::chrono::seconds(timeout_sec);
+    while (!done) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) {
+            r.timed_out = true;
+            break;
+        }
+        if (cancel && cancel->cancelled()) break;
+        struct pollfd pfd{out_, POLLIN, 0};
+        int ret = poll(&pfd, 1, static_cast<int>(std::min<long long>(left, 200)));
+        if (ret < 0 && errno != EINTR) break;
+        if (ret <= 0) continue;
+        ssize_t n = read(out_, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;  // the shell exited (`exit`, `exec`, set -e, ...)
+        pending.append(buffer, static_cast<size_t>(n));
+
+        size_t at = pending.find(marker);
+        if (at == std::string::npos) {
+            if (pending.size() >= marker.size()) {
+                size_t flush = pending.size() - (marker.size() - 1);
+                capture.append(pending.data(), flush);
+                pending.erase(0, flush);
+            }
+            continue;
+        }
+        capture.append(pending.data(), at);
+        pending.erase(0, at);
+        size_t eol = pending.find('\n', marker.size());
+        if (eol == std::string::npos) continue;  // status digits still in flight
+        rc = std::atoi(pending.c_str() + marker.size());
+        done = true;
+    }
+    scope.release();
+
+    r.cancelled = cancel && cancel->cancelled();
+    if (done) {
+        r.exit_code = rc;
+    } else {
+        if (!r.timed_out && !r.cancelled) capture.append(pending.data(), pending.size());
+        terminate();
+        if (r.timed_out || r.cancelled) {
+            r.signal = SIGKILL;
+            r.exit_code = 128 + SIGKILL;
+            r.note = "shell session killed; the next command starts a fresh shell";
+        } else {
+            r.exit_code = WIFEXITED(status_) ? WEXITSTATUS(status_)
+                        : WIFSIGNALED(status_) ? 128 + WTERMSIG(status_) : status_;
+            r.note = "shell exited; the next command starts a fresh shell";
+        }
+    }
+    r.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    r.output = capture.str(r.dropped_bytes);
+    r.output_bytes = capture.total();
+    return r;
+}
+
+// ── ShellPool ───────────────────────────────────────────────────────
+
+ShellPool::ShellPool(size_t max_shells, int idle_timeout)
+    : max_shells_(std::max<size_t>(max_shells, 1))
+    , idle_timeout_(std::max(idle_timeout, 1))
+    , reaper_([this] { reaper_loop(); }) {}
+
+ShellPool::~ShellPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    reaper_.join();
+    shells_.clear();
+}
+
+ExecResult ShellPool::run(const std::string& conversation, const std::string& cmd, const std::string& working_dir,
+                          int timeout_sec, size_t max_output, CancelToken* cancel) {
+    std::shared_ptr<ShellSession> shell;
+    std::vector<std::shared_ptr<ShellSession>> closing;  // killed after the lock is dropped
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = shells_.find(conversation);
+        if (it != shells_.end() && it->second.in_use == 0 && !it->second.shell->alive()) {
+            closing.push_back(std::move(it->second.shell));
+            shells_.erase(it);
+            it = shells_.end();
+        }
+        if (it == shells_.end()) {
+            while (shells_.size() >= max_shells_) {
+                auto lru = shells_.end();
+                for (auto i = shells_.begin(); i != shells_.end(); ++i) {
+                    if (i->second.in_use == 0 && (lru == shells_.end() || i->second.last_used < lru->second.last_used)) {
+                        lru = i;
+                    }
+                }
+                if (lru == shells_.end()) break;  // all busy: allow one over the cap
+                closing.push_back(std::move(lru->second.shell));
+                shells_.erase(lru);
+            }
+            auto fresh = std::make_shared<ShellSession>();
+            if (!fresh->alive()) {
+                ExecResult r;
+                r.output = "[error] Failed to start shell session";
+                return r;
+            }
+            it = shells_.emplace(conversation, Entry{std::move(fresh), std::chrono::steady_clock::now(), 0}).first;
+        }
+        it->second.in_use++;
+        shell = it->second.shell;
+    }
+    closing.clear();
+
+    ExecResult r;
+    {
+        std::lock_guard<std::mutex> run_lock(shell->mutex());
+        r = shell->run(cmd, working_dir, timeout_sec, max_output, cancel);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = shells_.find(conversation);
+    if (it != shells_.end() && it->second.shell == shell) {
+        it->second.in_use--;
+        it->second.last_used = std::chrono::steady_clock::now();
+    }
+    return r;
+}
+
+void ShellPool::reaper_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto period = std::min<std::chrono::seconds>(idle_timeout_, std::chrono::seconds(60));
+    while (!cv_.wait_for(lock, period, [&] { return stop_; })) {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<std::shared_ptr<ShellSession>> closing;
+        for (auto it = shells_.begin(); it != shells_.end();) {
+            if (it->second.in_use == 0 &&
+                (now - it->second.last_used >= idle_timeout_ || !it->second.shell->alive())) {
+                closing.push_back(std::move(it->second.shell));
+                it = shells_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        lock.unlock();
+        closing.clear();
+        lock.lock();
+    }
+}
+
+} // namespace minidragon
+
+#endif // _WIN32
@@ -0,0 +1,91 @@
+#pragma once
+
+namespace minidragon {
+class ShellPool;  // declared everywhere so callers can hold a (null) pool on Windows
+} // namespace minidragon
+
+#ifndef _WIN32
+#include "exec_output.hpp"
+#include "../cancel.hpp"
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <sys/types.h>
+
+namespace minidragon {
+
+// One long-lived bash (or sh) behind a pair of pipes. Commands are eval'd in
+// the shell itself, so cd, exports and `source venv/bin/activate` carry over
+// to the next command. Each command's output ends with a random sentinel
+// line carrying its exit status. Timeouts and cancellation kill the shell's
+// whole process group; the session is then dead and the pool starts a new
+// one. POSIX only.
+class ShellSession {
+public:
+    ShellSession();
+    ~ShellSession();
+
+    ShellSession(const ShellSession&) = delete;
+    ShellSession& operator=(const ShellSession&) = delete;
+
+    bool alive();
+
+    // One command at a time (callers hold mutex())
+    ExecResult run(const std::string& cmd, const std::string& working_dir, int timeout_sec,
+                   size_t max_output, CancelToken* cancel);
+
+    std::mutex& mutex() { return run_mutex_; }
+
+private:
+    pid_t pid_ = -1;
+    int in_ = -1;   // shell stdin
+    int out_ = -1;  // shell stdout + stderr
+    int status_ = 0;
+    bool reaped_ = false;
+    uint64_t seq_ = 0;
+    std::string token_;  // random per session, part of every sentinel
+    std::mutex run_mutex_;
+
+    bool write_all(const std::string& data);
+    void terminate();
+};
+
+// Shells keyed by conversation. Shells idle longer than idle_timeout are
+// reaped by a background thread; beyond max_shells the least recently used
+// idle shell is closed to make room. Thread-safe.
+class ShellPool {
+public:
+    ShellPool(size_t max_shells, int idle_timeout);
+    ~ShellPool();
+
+    ShellPool(const ShellPool&) = delete;
+    ShellPool& operator=(const ShellPool&) = delete;
+
+    ExecResult run(const std::string& conversation, const std::string& cmd, const std::string& working_dir,
+                   int timeout_sec, size_t max_output, CancelToken* cancel);
+
+private:
+    struct Entry {
+        std::shared_ptr<ShellSession> shell;
+        std::chrono::steady_clock::time_point last_used;
+        int in_use = 0;
+    };
+
+    size_t max_shells_;
+    std::chrono::seconds idle_timeout_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, Entry> shells_;
+    bool stop_ = false;
+    std::thread reaper_;
+
+    void reaper_loop();
+};
+
+} // namespace minidragon
+
+#endif // _WIN32
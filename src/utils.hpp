@@ -7,6 +7,7 @@
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <atomic>
 
 namespace minidragon {
 
@@ -65,7 +66,7 @@ inline int64_t epoch_now() {
 }
 
 inline std::string generate_tool_call_id() {
-    static int counter = 0;
+    static std::atomic<int> counter{0};
     return "call_" + std::to_string(epoch_now()) + "_" + std::to_string(counter++);
 }
 
@@ -0,0 +1,179 @@
+#include "vec_kernels.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MINIDRAGON_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang compile each kernel for its own ISA so the rest of the binary
+// keeps the baseline target; MSVC accepts the intrinsics anywhere.
+#if defined(MINIDRAGON_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MD_TARGET(isa)
+#endif
+
+namespace minidragon {
+
+// ── Scalar ──────────────────────────────────────────────────────────
+
+static float dot_scalar(const float* a, const float* b, size_t n) {
+    // Independent partial sums: fewer dependent adds, auto-vectorizable
+    float acc[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += a[i] * b[i];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+    }
+    float sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+#ifdef MINIDRAGON_X86
+
+// ── SSE2 ────────────────────────────────────────────────────────────
+
+MD_TARGET("sse2")
+static float dot_sse(const float* a, const float* b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+// ── AVX2 + FMA ──────────────────────────────────────────────────────
+
+MD_TARGET("avx2,fma")
+static float dot_avx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 0x55));
+    float sum = _mm_cvtss_f32(half);
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+// ── AVX-512F ────────────────────────────────────────────────────────
+
+MD_TARGET("avx512f")
+static float dot_avx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    if (i + 16 <= n) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        i += 16;
+    }
+    if (i < n) {
+        // Masked tail: no scalar loop for the last < 16 lanes
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+// ── CPU feature detection ───────────────────────────────────────────
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2_fma = false;
+    bool avx512f = false;
+};
+
+static CpuFeatures detect_cpu() {
+    CpuFeatures f;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    f.sse2 = (info[3] >> 26) & 1;
+    bool fma = (info[2] >> 12) & 1;
+    bool osxsave = (info[2] >> 27) & 1;
+    bool avx = (info[2] >> 28) & 1;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool ymm_os = (xcr0 & 0x6) == 0x6;
+    bool zmm_os = (xcr0 & 0xE6) == 0xE6;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        f.avx2_fma = avx && fma && ymm_os && ((info[1] >> 5) & 1);
+        f.avx512f = zmm_os && ((info[1] >> 16) & 1);
+    }
+#else
+    __builtin_cpu_init();
+    f.sse2 = __builtin_cpu_supports("sse2");
+    f.avx2_fma = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    f.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+    return f;
+}
+
+#endif // MINIDRAGON_X86
+
+// ── Dispatch ────────────────────────────────────────────────────────
+
+std::vector<DotKernel> available_dot_kernels() {
+    std::vector<DotKernel> kernels = {{"scalar", dot_scalar}};
+#ifdef MINIDRAGON_X86
+    static const CpuFeatures cpu = detect_cpu();
+    if (cpu.sse2) kernels.push_back({"sse2", dot_sse});
+    if (cpu.avx2_fma) kernels.push_back({"avx2", dot_avx2});
+    if (cpu.avx512f) kernels.push_back({"avx512f", dot_avx512});
+#endif
+    return kernels;
+}
+
+static const DotKernel& best_kernel() {
+    static const DotKernel best = available_dot_kernels().back();
+    return best;
+}
+
+float dot_product(const float* a, const float* b, size_t n) {
+    static const DotKernelFn fn = best_kernel().fn;
+    return fn(a, b, n);
+}
+
+const char* dot_kernel_name() {
+    return best_kernel().name;
+}
+
+bool normalize_vector(float* v, size_t n) {
+    float norm = std::sqrt(dot_product(v, v, n));
+    if (norm < 1e-8f) return false;
+    float inv = 1.0f / norm;
+    for (size_t i = 0; i < n; i++) v[i] *= inv;
+    return true;
+}
+
+} // namespace minidragon
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace minidragon {
+
+// ── Float32 vector kernels for embedding scoring ────────────────────
+// dot_product() dispatches once per process to the widest kernel the CPU
+// supports (AVX-512F, AVX2+FMA, SSE2, else scalar). Inputs must be valid
+// float arrays but need no alignment beyond that of float.
+
+using DotKernelFn = float (*)(const float* a, const float* b, size_t n);
+
+struct DotKernel {
+    const char* name;
+    DotKernelFn fn;
+};
+
+float dot_product(const float* a, const float* b, size_t n);
+
+// Scale v to unit length; returns false (leaving v untouched) for ~zero vectors
+bool normalize_vector(float* v, size_t n);
+
+// Name of the kernel dot_product() dispatched to
+const char* dot_kernel_name();
+
+// Every kernel usable on this CPU, scalar first (benchmarks)
+std::vector<DotKernel> available_dot_kernels();
+
+} // namespace minidragon
@@ -0,0 +1,806 @@
+#include "workspace_index.hpp"
+#include "thread_pool.hpp"
+#include "sha256.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace minidragon {
+
+// ── Trigrams ────────────────────────────────────────────────────────
+
+static constexpr size_t kSniffBytes = 8192;  // same binary test as grep_file
+static constexpr size_t kBatch = 256;        // files read between installs
+
+static inline uint32_t fold_byte(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+}
+
+// Distinct case-folded trigrams of data, ascending
+static void trigrams_of(const char* data, size_t n, std::vector<uint32_t>& out) {
+    thread_local std::vector<uint64_t> seen(size_t(1) << 18);  // one bit per trigram
+    out.clear();
+    uint32_t t = 0;
+    for (size_t i = 0; i < n; i++) {
+        t = ((t << 8) | fold_byte(static_cast<unsigned char>(data[i]))) & 0xFFFFFF;
+        if (i < 2) continue;
+        uint64_t bit = uint64_t(1) << (t & 63);
+        if (seen[t >> 6] & bit) continue;
+        seen[t >> 6] |= bit;
+        out.push_back(t);
+    }
+    for (uint32_t x : out) seen[x >> 6] &= ~(uint64_t(1) << (x & 63));
+    std::sort(out.begin(), out.end());
+}
+
+static std::string parent_of(const std::string& rel) {
+    size_t slash = rel.rfind('/');
+    return slash == std::string::npos ? "" : rel.substr(0, slash);
+}
+
+static bool under(const std::string& path, const std::string& prefix) {
+    return path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool WorkspaceIndex::PathLess::operator()(const std::string& a, const std::string& b) const {
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] == b[i]) continue;
+        if (a[i] == '/') return true;
+        if (b[i] == '/') return false;
+        return static_cast<unsigned char>(a[i]) < static_cast<unsigned char>(b[i]);
+    }
+    return a.size() < b.size();
+}
+
+static int64_t mtime_ns(const fs::file_time_type& t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+// ── Lifecycle ───────────────────────────────────────────────────────
+
+WorkspaceIndex::WorkspaceIndex(const std::string& root, WorkspaceIndexOptions opts) : opts_(std::move(opts)) {
+    std::error_code ec;
+    root_ = fs::weakly_canonical(fs::path(expand_path(root)), ec).generic_string();
+    if (ec || root_.empty()) root_ = fs::path(expand_path(root)).generic_string();
+    while (root_.size() > 1 && root_.back() == '/') root_.pop_back();
+    if (!opts_.snapshot_dir.empty()) {
+        snapshot_path_ = expand_path(opts_.snapshot_dir) + "/" + sha256_hex(root_).substr(0, 16) + ".idx";
+    }
+#ifdef __linux__
+    thread_ = std::thread([this] { run(); });
+#endif
+}
+
+WorkspaceIndex::~WorkspaceIndex() {
+    stop_ = true;
+    if (thread_.joinable()) thread_.join();
+}
+
+void WorkspaceIndex::run() {
+#ifdef __linux__
+    std::error_code ec;
+    if (!fs::is_directory(root_, ec)) return;
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        std::cerr << "[index] inotify unavailable (" << std::strerror(errno) << "), not indexing " << root_ << "\n";
+        return;
+    }
+    load();
+
+    using clock = std::chrono::steady_clock;
+    auto started = clock::now();
+    bool ok = rescan();
+    if (ok) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::cerr << "[index] " << root_ << ": " << ids_.size() << " files in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - started).count() << "ms\n";
+    }
+    auto last_scan = clock::now();
+    auto last_save = clock::time_point{};
+
+    while (ok && !stop_) {
+        pollfd pfd{inotify_fd_, POLLIN, 0};
+        poll(&pfd, 1, 250);
+        bool need_rescan;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            drain_events_locked();
+            need_rescan = rescan_needed_;
+        }
+        auto now = clock::now();
+        if (opts_.rescan_interval > 0 && now - last_scan >= std::chrono::seconds(opts_.rescan_interval)) {
+            need_rescan = true;
+        }
+        if (need_rescan) {
+            ok = rescan();
+            last_scan = clock::now();
+        } else {
+            ok = apply_pending();
+        }
+        // Snapshots cost a full write; changes are cheap to catch up on at start
+        bool changed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            changed = changed_;
+        }
+        if (ok && changed && now - last_save >= std::chrono::minutes(10)) {
+            save();
+            last_save = now;
+        }
+    }
+
+    if (ok) {
+        save();
+    } else if (!stop_) {
+        // A limit was hit: drop everything, queries keep returning false
+        std::lock_guard<std::mutex> lock(mutex_);
+        usable_ = false;
+        files_.clear();
+        ids_.clear();
+        postings_.clear();
+        unindexed_.clear();
+        dirs_.clear();
+    }
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+#endif
+}
+
+// ── Scanning ────────────────────────────────────────────────────────
+
+// A periodic rescan runs while queries keep being answered; the first
+// scan and one after lost events make them wait
+bool WorkspaceIndex::rescan() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rescan_needed_ || !usable_) {
+            scanning_ = true;
+            rescan_needed_ = false;
+            // Everything pending is covered by the walk; later changes raise new events
+            files_pending_.clear();
+            dirs_pending_.clear();
+        }
+    }
+
+    std::vector<Scanned> found;
+    DirMap dirs;
+    if (!walk("", IgnoreRules::for_root(root_), found, dirs)) return false;
+    if (!reconcile("", found)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+#ifdef __linux__
+    // Directories gone since the last scan: deleted ones lost their watch
+    // already, moved ones still report under their old name
+    for (auto it = watches_.begin(); it != watches_.end();) {
+        if (dirs.count(it->second)) {
+            ++it;
+            continue;
+        }
+        inotify_rm_watch(inotify_fd_, it->first);
+        it = watches_.erase(it);
+    }
+#endif
+    dirs_ = std::move(dirs);
+    scanning_ = false;
+    usable_ = true;
+    return true;
+}
+
+// Collects the files below rel (relative to root_, "" = root) the way
+// grep_file's walker does, watching every directory on the way.
+bool WorkspaceIndex::walk(const std::string& rel, const IgnoreRules::Ptr& rules, std::vector<Scanned>& out,
+                          DirMap& dirs) {
+    if (stop_) return false;
+    // Watch before listing, so nothing created in between goes unnoticed
+    if (!watch(rel)) return false;
+    dirs[rel] = rules;
+
+    std::string abs = rel.empty() ? root_ : root_ + "/" + rel;
+    std::error_code ec;
+    for (fs::directory_iterator it(abs, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name[0] == '.') continue;  // includes .git
+        std::string child = rel.empty() ? name : rel + "/" + name;
+        std::string child_abs = root_ + "/" + child;
+
+        std::error_code type_ec;
+        bool link = it->is_symlink(type_ec);
+        if (!link && it->is_directory(type_ec)) {
+            if (IgnoreRules::ignored(rules, child_abs, true)) continue;
+            if (!walk(child, IgnoreRules::load(child_abs, rules), out, dirs)) return false;
+            continue;
+        }
+        if (!it->is_regular_file(type_ec) || IgnoreRules::ignored(rules, child_abs, false)) continue;
+
+        Scanned s;
+        s.path = std::move(child);
+        s.mtime = mtime_ns(it->last_write_time(type_ec));
+        s.size = it->file_size(type_ec);
+        // A link's target can change without an event here: never narrow it away
+        if (link) s.flags |= kUnindexed;
+        out.push_back(std::move(s));
+        if (out.size() > opts_.max_files) {
+            std::cerr << "[index] " << root_ << " has more than " << opts_.max_files
+                      << " files (tools.index.max_files); not indexing it\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WorkspaceIndex::watch(const std::string& rel) {
+#ifdef __linux__
+    constexpr uint32_t kMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM |
+                               IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW |
+                               IN_EXCL_UNLINK;
+    std::string abs = rel.empty() ? root_ : root_ + "/" + rel;
+    int wd = inotify_add_watch(inotify_fd_, abs.c_str(), kMask);
+    if (wd < 0) {
+        if (errno != ENOSPC) return true;  // gone already: its parent reports that
+        std::cerr << "[index] inotify watch limit reached (fs.inotify.max_user_watches); not indexing " << root_
+                  << "\n";
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    watches_[wd] = rel;
+#else
+    (void)rel;
+#endif
+    return true;
+}
+
+void WorkspaceIndex::unwatch_below_locked(const std::string& rel, const DirMap& keep) {
+#ifdef __linux__
+    std::string prefix = rel + "/";
+    for (auto it = watches_.begin(); it != watches_.end();) {
+        if ((it->second == rel || under(it->second, prefix)) && !keep.count(it->second)) {
+            inotify_rm_watch(inotify_fd_, it->first);
+            it = watches_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#else
+    (void)rel;
+    (void)keep;
+#endif
+}
+
+// Reads each file and records its trigrams (binary and oversized files
+// get none)
+void WorkspaceIndex::scan_contents(std::vector<Scanned>& files) {
+    int workers = static_cast<int>(std::min(8u, std::max(1u, std::thread::hardware_concurrency() / 2)));
+    size_t limit = opts_.max_file_size;
+    parallel_for(files.size(), workers, [&](size_t i) {
+        Scanned& s = files[i];
+        if (stop_ || (s.flags & kUnindexed)) return;
+        if (s.size > limit) {
+            s.flags |= kUnindexed;
+            return;
+        }
+        thread_local std::string buffer;
+        std::ifstream f(root_ + "/" + s.path, std::ios::binary);
+        if (!f) {
+            s.flags |= kUnindexed;
+            return;
+        }
+        buffer.resize(limit + 1);
+        f.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+        size_t n = static_cast<size_t>(f.gcount());
+        if (n > limit) {
+            s.flags |= kUnindexed;  // grew since the stat
+            return;
+        }
+        if (std::memchr(buffer.data(), 0, std::min(n, kSniffBytes))) {
+            s.flags |= kBinary;
+            return;
+        }
+        trigrams_of(buffer.data(), n, s.trigrams);
+    });
+}
+
+// Brings the index in line with found, the complete file list below
+// `below` ("" = root): reads new and changed files, drops vanished ones.
+bool WorkspaceIndex::reconcile(const std::string& below, std::vector<Scanned>& found) {
+    PathLess less;
+    std::sort(found.begin(), found.end(), [&](const Scanned& a, const Scanned& b) { return less(a.path, b.path); });
+
+    std::vector<Scanned*> changed;
+    std::vector<std::string> gone;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string prefix = below.empty() ? "" : below + "/";
+        auto it = ids_.lower_bound(prefix);
+        auto in_range = [&] { return it != ids_.end() && it->first.compare(0, prefix.size(), prefix) == 0; };
+        for (auto& s : found) {
+            while (in_range() && less(it->first, s.path)) gone.push_back((it++)->first);
+            bool same = false;
+            if (in_range() && it->first == s.path) {
+                const File& f = files_[it->second];
+                same = f.mtime == s.mtime && f.size == s.size && (f.flags & kUnindexed) == (s.flags & kUnindexed);
+                ++it;
+            }
+            if (!same) changed.push_back(&s);
+        }
+        while (in_range()) gone.push_back((it++)->first);
+        for (auto& path : gone) remove_locked(path);
+    }
+
+    for (size_t from = 0; from < changed.size(); from += kBatch) {
+        if (stop_) return false;
+        std::vector<Scanned> batch;
+        for (size_t i = from; i < std::min(changed.size(), from + kBatch); i++) batch.push_back(std::move(*changed[i]));
+        scan_contents(batch);
+        if (stop_) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& s : batch) install_locked(s);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    compact_locked();
+    return true;
+}
+
+// ── Change events ───────────────────────────────────────────────────
+
+void WorkspaceIndex::drain_events_locked() {
+#ifdef __linux__
+    if (inotify_fd_ < 0) return;
+    alignas(struct inotify_event) char buf[64 * 1024];
+    for (;;) {
+        ssize_t n = read(inotify_fd_, buf, sizeof(buf));
+        if (n <= 0) break;  // EAGAIN: nothing queued
+        for (char* p = buf; p < buf + n;) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                rescan_needed_ = true;
+                continue;
+            }
+            auto w = watches_.find(ev->wd);
+            if (w == watches_.end()) continue;
+            if (ev->mask & IN_IGNORED) {
+                watches_.erase(w);
+                continue;
+            }
+            if (ev->len == 0) {
+                // The directory itself moved or went away. Its parent reports
+                // that as well, except for the root.
+                if (w->second.empty() && (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))) rescan_needed_ = true;
+                continue;
+            }
+            std::string name = ev->name;
+            if (name.empty()) continue;
+            if (name == ".gitignore") {
+                rescan_needed_ = true;  // which paths count may change anywhere below
+                continue;
+            }
+            if (name[0] == '.') continue;
+            std::string rel = w->second.empty() ? name : w->second + "/" + name;
+            if (ev->mask & IN_ISDIR) {
+                dirs_pending_[rel] = ++event_seq_;
+            } else {
+                files_pending_[rel] = ++event_seq_;
+            }
+        }
+    }
+#endif
+}
+
+bool WorkspaceIndex::apply_pending() {
+    std::vector<std::pair<std::string, uint64_t>> dirs, files;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirs.assign(dirs_pending_.begin(), dirs_pending_.end());
+        files.assign(files_pending_.begin(), files_pending_.end());
+    }
+
+    // Directories: walk the new or moved-in subtree, or drop the old one
+    for (auto& [rel, seq] : dirs) {
+        std::string abs = root_ + "/" + rel;
+        IgnoreRules::Ptr rules;
+        bool known;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = dirs_.find(parent_of(rel));
+            known = it != dirs_.end();
+            if (known) rules = it->second;
+        }
+        std::error_code ec;
+        bool present = known && !fs::is_symlink(abs, ec) && fs::is_directory(abs, ec) &&
+                       !IgnoreRules::ignored(rules, abs, true);
+        std::vector<Scanned> found;
+        DirMap walked;
+        if (present && !walk(rel, IgnoreRules::load(abs, rules), found, walked)) return false;
+        if (!reconcile(rel, found)) return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        unwatch_below_locked(rel, walked);
+        std::string prefix = rel + "/";
+        for (auto it = dirs_.begin(); it != dirs_.end();) {
+            if (it->first == rel || under(it->first, prefix)) {
+                it = dirs_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        dirs_.insert(walked.begin(), walked.end());
+        auto p = dirs_pending_.find(rel);
+        if (p != dirs_pending_.end() && p->second == seq) dirs_pending_.erase(p);
+    }
+
+    // Files: re-read the ones whose size or mtime moved
+    std::vector<Scanned> changed;
+    std::vector<std::string> gone;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [rel, seq] : files) {
+            std::string abs = root_ + "/" + rel;
+            auto d = dirs_.find(parent_of(rel));
+            std::error_code ec;
+            auto st = fs::symlink_status(abs, ec);
+            bool link = fs::is_symlink(st);
+            bool present = d != dirs_.end() && fs::is_regular_file(abs, ec) &&
+                           !IgnoreRules::ignored(d->second, abs, false);
+            if (!present) {
+                gone.push_back(rel);
+                continue;
+            }
+            Scanned s;
+            s.path = rel;
+            s.mtime = mtime_ns(fs::last_write_time(abs, ec));
+            s.size = fs::file_size(abs, ec);
+            if (link) s.flags |= kUnindexed;
+            auto id = ids_.find(rel);
+            if (id != ids_.end() && files_[id->second].mtime == s.mtime && files_[id->second].size == s.size &&
+                (files_[id->second].flags & kUnindexed) == (s.flags & kUnindexed)) {
+                continue;
+            }
+            changed.push_back(std::move(s));
+        }
+    }
+    scan_contents(changed);
+    if (stop_) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& path : gone) remove_locked(path);
+    for (auto& s : changed) install_locked(s);
+    for (auto& [rel, seq] : files) {
+        auto p = files_pending_.find(rel);
+        if (p != files_pending_.end() && p->second == seq) files_pending_.erase(p);
+    }
+    compact_locked();
+    return true;
+}
+
+// ── Postings ────────────────────────────────────────────────────────
+
+void WorkspaceIndex::install_locked(Scanned& s) {
+    remove_locked(s.path);
+    uint32_t id = static_cast<uint32_t>(files_.size());
+    files_.push_back({s.path, s.mtime, s.size, static_cast<uint8_t>(s.flags | kLive)});
+    ids_[s.path] = id;
+    // Ids only grow, so appending keeps every list sorted
+    for (uint32_t t : s.trigrams) postings_[t].push_back(id);
+    if (s.flags & kUnindexed) unindexed_.insert(id);
+    s.trigrams = {};
+    changed_ = true;
+}
+
+void WorkspaceIndex::remove_locked(const std::string& path) {
+    auto it = ids_.find(path);
+    if (it == ids_.end()) return;
+    files_[it->second].flags &= ~kLive;
+    unindexed_.erase(it->second);
+    ids_.erase(it);
+    dead_++;
+    changed_ = true;
+}
+
+// Renumbers live files densely once dead entries outnumber them
+void WorkspaceIndex::compact_locked() {
+    if (dead_ < 1024 || dead_ < ids_.size()) return;
+    std::vector<uint32_t> remap(files_.size(), UINT32_MAX);
+    std::vector<File> live;
+    live.reserve(ids_.size());
+    for (uint32_t id = 0; id < files_.size(); id++) {
+        if (!(files_[id].flags & kLive)) continue;
+        remap[id] = static_cast<uint32_t>(live.size());
+        live.push_back(std::move(files_[id]));
+    }
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        auto& list = it->second;
+        size_t k = 0;
+        for (uint32_t id : list) {
+            if (remap[id] != UINT32_MAX) list[k++] = remap[id];
+        }
+        list.resize(k);
+        if (list.empty()) {
+            it = postings_.erase(it);
+        } else {
+            list.shrink_to_fit();
+            ++it;
+        }
+    }
+    for (auto& [path, id] : ids_) id = remap[id];
+    std::set<uint32_t> unindexed;
+    for (uint32_t id : unindexed_) unindexed.insert(remap[id]);
+    unindexed_ = std::move(unindexed);
+    files_ = std::move(live);
+    dead_ = 0;
+}
+
+// ── Queries ─────────────────────────────────────────────────────────
+
+bool WorkspaceIndex::ready_locked() const {
+    return usable_ && !scanning_ && !rescan_needed_ && dirs_pending_.empty();
+}
+
+bool WorkspaceIndex::resolve_dir(const std::string& dir, std::string& rel) const {
+    std::error_code ec;
+    std::string path = fs::weakly_canonical(fs::path(dir), ec).generic_string();
+    if (ec) return false;
+    while (path.size() > 1 && path.back() == '/') path.pop_back();
+    if (path == root_) {
+        rel.clear();
+        return true;
+    }
+    if (!under(path, root_ + "/")) return false;
+    rel = path.substr(root_.size() + 1);
+    return true;
+}
+
+// Replaces the entries of files changed since they were indexed with what
+// is on disk now. out holds paths relative to rel_dir, sorted.
+void WorkspaceIndex::merge_pending_locked(const std::string& rel_dir, std::vector<std::string>& out) {
+    if (files_pending_.empty()) return;
+    std::string prefix = rel_dir.empty() ? "" : rel_dir + "/";
+    std::vector<std::string> present;
+    for (auto it = files_pending_.lower_bound(prefix);
+         it != files_pending_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        std::string shown = it->first.substr(prefix.size());
+        auto pos = std::lower_bound(out.begin(), out.end(), shown, PathLess());
+        if (pos != out.end() && *pos == shown) out.erase(pos);
+
+        std::string abs = root_ + "/" + it->first;
+        auto d = dirs_.find(parent_of(it->first));
+        std::error_code ec;
+        if (d != dirs_.end() && fs::is_regular_file(abs, ec) && !IgnoreRules::ignored(d->second, abs, false)) {
+            present.push_back(std::move(shown));
+        }
+    }
+    if (present.empty()) return;
+    out.insert(out.end(), present.begin(), present.end());
+    std::sort(out.begin(), out.end(), PathLess());
+}
+
+bool WorkspaceIndex::list(const std::string& dir, std::vector<std::string>& out) {
+    return candidates_impl(dir, nullptr, out);
+}
+
+bool WorkspaceIndex::candidates(const std::string& dir, const std::string& literal, std::vector<std::string>& out) {
+    return candidates_impl(dir, &literal, out);
+}
+
+bool WorkspaceIndex::candidates_impl(const std::string& dir, const std::string* literal,
+                                     std::vector<std::string>& out) {
+    std::string rel;
+    if (!resolve_dir(dir, rel)) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    drain_events_locked();
+    if (!ready_locked() || !dirs_.count(rel)) return false;
+
+    out.clear();
+    std::string prefix = rel.empty() ? "" : rel + "/";
+    std::vector<uint32_t> grams;
+    if (literal) trigrams_of(literal->data(), literal->size(), grams);
+
+    if (grams.empty()) {
+        for (auto it = ids_.lower_bound(prefix); it != ids_.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+             ++it) {
+            if (literal && (files_[it->second].flags & kBinary)) continue;
+            out.push_back(it->first.substr(prefix.size()));
+        }
+    } else {
+        // Intersect the posting lists, shortest first
+        std::vector<const std::vector<uint32_t>*> lists;
+        for (uint32_t g : grams) {
+            auto it = postings_.find(g);
+            if (it == postings_.end()) {
+                lists.clear();
+                break;
+            }
+            lists.push_back(&it->second);
+        }
+        std::vector<uint32_t> ids;
+        if (!lists.empty()) {
+            std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+            ids = *lists[0];
+            std::vector<uint32_t> next;
+            for (size_t i = 1; i < lists.size() && !ids.empty(); i++) {
+                next.clear();
+                std::set_intersection(ids.begin(), ids.end(), lists[i]->begin(), lists[i]->end(),
+                                      std::back_inserter(next));
+                ids.swap(next);
+            }
+        }
+        ids.insert(ids.end(), unindexed_.begin(), unindexed_.end());
+        for (uint32_t id : ids) {
+            const File& f = files_[id];
+            if (!(f.flags & kLive) || (f.flags & kBinary)) continue;
+            if (!prefix.empty() && !under(f.path, prefix)) continue;
+            out.push_back(f.path.substr(prefix.size()));
+        }
+        std::sort(out.begin(), out.end(), PathLess());
+    }
+    merge_pending_locked(rel, out);
+    return true;
+}
+
+// ── Persistence ─────────────────────────────────────────────────────
+
+static constexpr char kMagic[8] = {'M', 'D', 'W', 'I', 'D', 'X', '1', '\0'};
+
+template <typename T>
+static void put(std::string& out, const T& v) { out.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+template <typename T>
+static bool get(std::ifstream& f, T& v) { return static_cast<bool>(f.read(reinterpret_cast<char*>(&v), sizeof(T))); }
+
+static void put_varint(std::string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static bool get_varint(std::ifstream& f, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = f.get();
+        if (c == EOF) return false;
+        v |= static_cast<uint32_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// Live files only, renumbered densely; posting lists delta-encoded. Built
+// in memory under the lock and written after it, so queries never wait on
+// the disk.
+bool WorkspaceIndex::save() {
+    if (snapshot_path_.empty()) return false;
+    std::string bytes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes.append(kMagic, sizeof(kMagic));
+        put(bytes, static_cast<uint32_t>(root_.size()));
+        bytes += root_;
+
+        std::vector<uint32_t> remap(files_.size(), UINT32_MAX);
+        uint32_t next = 0;
+        for (uint32_t id = 0; id < files_.size(); id++) {
+            if (files_[id].flags & kLive) remap[id] = next++;
+        }
+        put(bytes, static_cast<uint64_t>(next));
+        for (auto& file : files_) {
+            if (!(file.flags & kLive)) continue;
+            put(bytes, static_cast<uint32_t>(file.path.size()));
+            bytes += file.path;
+            put(bytes, file.mtime);
+            put(bytes, file.size);
+            put(bytes, file.flags);
+        }
+
+        put(bytes, static_cast<uint64_t>(postings_.size()));
+        std::vector<uint32_t> ids;
+        for (auto& [gram, list] : postings_) {
+            ids.clear();
+            for (uint32_t id : list) {
+                if (remap[id] != UINT32_MAX) ids.push_back(remap[id]);
+            }
+            put(bytes, gram);
+            put(bytes, static_cast<uint32_t>(ids.size()));
+            uint32_t prev = 0;
+            for (uint32_t id : ids) {
+                put_varint(bytes, id - prev);
+                prev = id;
+            }
+        }
+        changed_ = false;
+    }
+
+    std::error_code ec;
+    fs::create_directories(fs::path(snapshot_path_).parent_path(), ec);
+    std::string tmp = snapshot_path_ + ".tmp";
+    bool ok = false;
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (f) {
+            f.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            ok = static_cast<bool>(f);
+        }
+    }
+    if (ok) {
+        fs::rename(tmp, snapshot_path_, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        // Try again at the next save
+        std::lock_guard<std::mutex> lock(mutex_);
+        changed_ = true;
+    }
+    return ok;
+}
+
+bool WorkspaceIndex::load() {
+    if (snapshot_path_.empty()) return false;
+    std::ifstream f(snapshot_path_, std::ios::binary);
+    if (!f) return false;
+
+    char magic[8];
+    uint32_t root_len = 0;
+    if (!f.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) return false;
+    if (!get(f, root_len) || root_len > 4096) return false;
+    std::string root(root_len, '\0');
+    if (!f.read(&root[0], root_len) || root != root_) return false;
+
+    uint64_t count = 0;
+    if (!get(f, count) || count > opts_.max_files) return false;
+    std::vector<File> files(count);
+    std::map<std::string, uint32_t, PathLess> ids;
+    std::set<uint32_t> unindexed;
+    for (uint32_t id = 0; id < count; id++) {
+        File& file = files[id];
+        uint32_t len = 0;
+        if (!get(f, len) || len > 4096) return false;
+        file.path.resize(len);
+        if (!f.read(&file.path[0], len) || !get(f, file.mtime) || !get(f, file.size) || !get(f, file.flags)) {
+            return false;
+        }
+        if (!(file.flags & kLive) || !ids.emplace(file.path, id).second) return false;
+        if (file.flags & kUnindexed) unindexed.insert(id);
+    }
+
+    uint64_t grams = 0;
+    if (!get(f, grams) || grams > (uint64_t(1) << 24)) return false;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+    postings.reserve(grams);
+    for (uint64_t g = 0; g < grams; g++) {
+        uint32_t gram = 0, n = 0;
+        if (!get(f, gram) || !get(f, n) || n > count) return false;
+        auto& list = postings[gram];
+        list.resize(n);
+        uint32_t id = 0;
+        for (uint32_t k = 0; k < n; k++) {
+            uint32_t delta = 0;
+            if (!get_varint(f, delta) || (k > 0 && delta == 0)) return false;
+            id += delta;
+            if (id >= count) return false;
+            list[k] = id;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_ = std::move(files);
+    ids_ = std::move(ids);
+    postings_ = std::move(postings);
+    unindexed_ = std::move(unindexed);
+    dead_ = 0;
+    changed_ = false;
+    return true;
+}
+
+} // namespace minidragon
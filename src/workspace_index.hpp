@@ -0,0 +1,133 @@
+#pragma once
+#include "gitignore.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace minidragon {
+
+struct WorkspaceIndexOptions {
+    size_t max_files = 200000;         // bigger trees are not indexed at all
+    size_t max_file_size = 1 << 20;    // larger files are listed, never narrowed away
+    int rescan_interval = 600;         // seconds between full rescans (0 = never)
+    std::string snapshot_dir;          // one file per root in here; "" = do not persist
+};
+
+// Path list and trigram index of one directory tree, so glob and grep_file
+// stop walking the same unchanged tree on every call. It holds the files
+// grep_file would search: hidden entries, .git and .gitignore'd paths are
+// left out.
+//
+// A background thread loads the last snapshot (or builds from scratch),
+// reconciles it with the tree, then follows changes through inotify and
+// rescans periodically to catch anything the kernel did not report.
+// Queries answer exactly or not at all: while building, with a directory
+// change still unprocessed, after an event queue overflow, or when the tree
+// cannot be watched completely, they return false and callers walk the
+// tree as before. Files changed but not yet re-indexed are reported as they
+// are on disk. Linux only; elsewhere queries always return false.
+class WorkspaceIndex {
+public:
+    WorkspaceIndex(const std::string& root, WorkspaceIndexOptions opts);
+    ~WorkspaceIndex();
+
+    WorkspaceIndex(const WorkspaceIndex&) = delete;
+    WorkspaceIndex& operator=(const WorkspaceIndex&) = delete;
+
+    // Files below dir (root or a directory under it), relative to dir, in
+    // the order grep_file walks them. false if dir is outside the root or
+    // the index cannot answer.
+    bool list(const std::string& dir, std::vector<std::string>& out);
+
+    // list() narrowed to files that may contain literal in any letter case.
+    // Binary files are left out; a literal under 3 bytes narrows nothing.
+    bool candidates(const std::string& dir, const std::string& literal, std::vector<std::string>& out);
+
+private:
+    enum : uint8_t { kLive = 1, kBinary = 2, kUnindexed = 4 };
+
+    struct File {
+        std::string path;   // relative to root_
+        int64_t mtime = 0;  // ns since epoch
+        uint64_t size = 0;
+        uint8_t flags = 0;
+    };
+
+    // A file as found on disk, with its trigrams once read
+    struct Scanned {
+        std::string path;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        uint8_t flags = kLive;
+        std::vector<uint32_t> trigrams;
+    };
+
+    using DirMap = std::unordered_map<std::string, IgnoreRules::Ptr>;
+
+    // The order grep_file's walker visits files in: '/' sorts before any
+    // other byte, so a directory's files follow its name directly
+    struct PathLess {
+        bool operator()(const std::string& a, const std::string& b) const;
+    };
+
+    std::string root_;  // canonical
+    WorkspaceIndexOptions opts_;
+    std::string snapshot_path_;
+
+    std::mutex mutex_;
+    std::vector<File> files_;                 // by id; dead entries stay until compaction
+    std::map<std::string, uint32_t, PathLess> ids_;  // live paths, in walk order
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings_;  // trigram -> ascending ids
+    std::set<uint32_t> unindexed_;            // live ids without trigrams (too big, symlinked)
+    size_t dead_ = 0;
+    bool changed_ = false;                    // since the last snapshot
+
+    // Directories walked so far (relative, "" = root) and the ignore rules
+    // in effect inside each
+    DirMap dirs_;
+
+    // inotify state. Pending paths were reported but not applied yet; the
+    // sequence numbers tell whether another event came in meanwhile.
+    int inotify_fd_ = -1;
+    std::unordered_map<int, std::string> watches_;  // wd -> directory
+    std::map<std::string, uint64_t> files_pending_;
+    std::map<std::string, uint64_t> dirs_pending_;
+    uint64_t event_seq_ = 0;
+    bool rescan_needed_ = false;  // queue overflow, root moved, a .gitignore changed
+    bool scanning_ = false;       // a rescan that queries must wait for is running
+    bool usable_ = false;         // scanned once, fully watched, within limits
+
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+
+    void run();
+    bool rescan();
+    bool walk(const std::string& rel, const IgnoreRules::Ptr& rules, std::vector<Scanned>& out, DirMap& dirs);
+    bool watch(const std::string& rel);
+    void unwatch_below_locked(const std::string& rel, const DirMap& keep);
+    void drain_events_locked();
+    bool apply_pending();
+    void scan_contents(std::vector<Scanned>& files);
+    bool reconcile(const std::string& below, std::vector<Scanned>& found);
+    void install_locked(Scanned& s);
+    void remove_locked(const std::string& path);
+    void compact_locked();
+
+    bool ready_locked() const;
+    bool resolve_dir(const std::string& dir, std::string& rel) const;
+    bool candidates_impl(const std::string& dir, const std::string* literal, std::vector<std::string>& out);
+    void merge_pending_locked(const std::string& rel_dir, std::vector<std::string>& out);
+
+    bool save();
+    bool load();
+};
+
+} // namespace minidragon